@@ -0,0 +1,80 @@
+#include <algorithm>
+
+#include "ack_filter.hh"
+
+using namespace std;
+
+/* The rate window can span at most this much receiver time */
+static const uint64_t MAX_RATE_WINDOW_MS = 2000;
+
+AckFilter::AckFilter( const float compression_gain )
+  : delivered_( MAX_RATE_WINDOW_MS + 2 ),
+    compression_gain_( compression_gain )
+{}
+
+void AckFilter::set_rate_window( const uint64_t window_ms )
+{
+  rate_window_ms_ = min( max<uint64_t>( window_ms, 1 ), MAX_RATE_WINDOW_MS );
+}
+
+/* One entry per ms of receiver time; old ones fall off the ring */
+void AckFilter::count_delivery( const uint64_t recv_timestamp )
+{
+  total_delivered_++;
+  if ( not delivered_.empty() and recv_timestamp <= delivered_.back_time() ) {
+    delivered_.back_value() = total_delivered_;
+  } else {
+    delivered_.push_back( recv_timestamp, total_delivered_ );
+  }
+}
+
+/* Turn the group in progress into samples */
+void AckFilter::close_group( void )
+{
+  const double rtt = group_min_rtt_;
+  rtt_change_ = rtt_ == 0 ? 0 : rtt - rtt_;
+  rtt_ = rtt;
+
+  const double ack_spread = last_ack_ - group_first_ack_ + 1;
+  const double recv_spread = last_recv_ - group_first_recv_ + 1;
+  compression_ = (1 - compression_gain_) * compression_
+    + compression_gain_ * min( 1.0, ack_spread / recv_spread );
+
+  /* delivered over the rate window, ending at the group's last delivery */
+  const uint64_t start = last_recv_ > rate_window_ms_ ? last_recv_ - rate_window_ms_ : 0;
+  const size_t after = delivered_.upper_bound( start );
+  const size_t from = after > 0 ? after - 1 : 0;
+  const uint64_t span = max<uint64_t>( last_recv_ - delivered_.time( from ), 1 );
+  delivery_rate_ = double( total_delivered_ - delivered_.value( from ) ) / span;
+}
+
+/* Add one ack */
+bool AckFilter::update( const uint64_t send_timestamp,
+			const uint64_t recv_timestamp,
+			const uint64_t ack_timestamp )
+{
+  const uint64_t rtt = ack_timestamp > send_timestamp ? ack_timestamp - send_timestamp : 0;
+  bool sample = false;
+
+  const bool compressed = started_ and recv_timestamp >= last_recv_
+    and ack_timestamp - last_ack_ < recv_timestamp - last_recv_;
+
+  if ( started_ and not compressed ) {
+    close_group();
+    sample = true;
+  }
+
+  if ( not compressed ) {
+    group_first_recv_ = recv_timestamp;
+    group_first_ack_ = ack_timestamp;
+    group_min_rtt_ = rtt;
+  }
+
+  group_min_rtt_ = min( group_min_rtt_, rtt );
+  last_recv_ = recv_timestamp;
+  last_ack_ = ack_timestamp;
+  started_ = true;
+
+  count_delivery( recv_timestamp );
+  return sample;
+}
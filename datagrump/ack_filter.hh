@@ -0,0 +1,68 @@
+#ifndef ACK_FILTER_HH
+#define ACK_FILTER_HH
+
+#include <cstdint>
+
+#include "ring_buffer.hh"
+
+/* Takes the ack path's jitter out of per-ack samples. Acks that an
+   aggregating link (LTE, Wi-Fi) or a busy ack queue holds and releases
+   together arrive closer together than the receiver got the datagrams.
+   An ack is "compressed" if it arrived sooner after the previous ack
+   than its datagram reached the receiver after the previous datagram.
+   A run of compressed acks forms one group, and the group yields one
+   sample when the next uncompressed ack arrives:
+   - rtt(): the lowest RTT in the group. Its ack was held the least.
+   - delivery_rate(): datagrams delivered per ms over the rate window,
+     counted on the receiver's clock, which the ack path cannot distort.
+   Without compression every ack is its own group and a sample. */
+class AckFilter
+{
+private:
+  /* cumulative datagrams delivered, keyed by receiver timestamp */
+  SampleRing<uint64_t> delivered_;
+  uint64_t total_delivered_ {0};
+  uint64_t rate_window_ms_ {100};
+
+  /* the group in progress */
+  bool started_ {false};
+  uint64_t last_recv_ {0}, last_ack_ {0};
+  uint64_t group_first_recv_ {0}, group_first_ack_ {0};
+  uint64_t group_min_rtt_ {0};
+
+  /* the last finished group */
+  double rtt_ {0};
+  double rtt_change_ {0};
+  double delivery_rate_ {0};
+  double compression_ {1};
+  float compression_gain_;
+
+  void close_group( void );
+  void count_delivery( const uint64_t recv_timestamp );
+
+public:
+  /* compression_gain weights each group's spread ratio in its EWMA */
+  AckFilter( const float compression_gain = 0.1 );
+
+  /* Add one ack; true if it completed a group (new samples are ready) */
+  bool update( const uint64_t send_timestamp,
+	       const uint64_t recv_timestamp,
+	       const uint64_t ack_timestamp );
+
+  /* Span of receiver time the delivery rate is measured over (ms) */
+  void set_rate_window( const uint64_t window_ms );
+
+  /* Lowest RTT in the last group (ms), and its change from the group before */
+  double rtt( void ) const { return rtt_; }
+  double rtt_change( void ) const { return rtt_change_; }
+
+  /* Receiver-side delivery rate (pkts/ms) */
+  double delivery_rate( void ) const { return delivery_rate_; }
+
+  /* Smoothed ratio of how far apart a group's acks arrived to how far
+     apart its datagrams reached the receiver: 1 means no compression,
+     and values near 0 mean the acks arrive in bursts */
+  double compression( void ) const { return compression_; }
+};
+
+#endif /* ACK_FILTER_HH */
@@ -15,8 +15,8 @@ AimdController::AimdController( const bool debug )
 
 AimdController::AimdController( const bool debug,
     const float cwnd,
-    const int aimd_inc_param,
-    const int aimd_dec_param)
+    const float aimd_inc_param,
+    const float aimd_dec_param)
   : Controller ( debug ),
     cwnd_ (cwnd),
     aimd_inc_param_ (aimd_inc_param),
@@ -44,7 +44,7 @@ void AimdController::datagram_was_sent( const uint64_t sequence_number,
 				    const uint64_t send_timestamp )
                                     /* in milliseconds */
 {
-  /* Default: take no action */
+  next_sequence_number_ = sequence_number + 1;
 
   if ( debug_ ) {
     cerr << "At time " << send_timestamp
@@ -74,6 +74,27 @@ void AimdController::ack_received( const uint64_t sequence_number_acked,
   }
 }
 
+/* A datagram was declared lost */
+void AimdController::datagram_lost( const uint64_t sequence_number,
+				    const uint64_t send_timestamp,
+				    const uint64_t timestamp )
+{
+  /* Multiplicative decrease, once per window of losses */
+  if (sequence_number >= recovery_end_) {
+    if (cwnd_ > 1) {
+      cwnd_ /= aimd_dec_param_;
+    }
+    recovery_end_ = next_sequence_number_;
+  }
+
+  if ( debug_ ) {
+    cerr << "At time " << timestamp
+	 << " datagram " << sequence_number
+	 << " (send @ time " << send_timestamp << ") was lost"
+	 << ", cwnd " << cwnd_ << endl;
+  }
+}
+
 /* An ack was received */
 void AimdController::timed_out()
   /* when time put happens */
@@ -88,9 +109,3 @@ void AimdController::timed_out()
   }
 }
 
-/* How long to wait (in milliseconds) if there are no acks
-   before sending one more datagram */
-unsigned int AimdController::timeout_ms( void )
-{
-  return 1000; /* timeout of one second */
-}
@@ -12,6 +12,8 @@ private:
   float cwnd_; /* Congestion window */
   float aimd_inc_param_; /* Increase cwnd by this per RTT */
   float aimd_dec_param_; /* Decrease cwnd by this factor per timeout */
+  uint64_t next_sequence_number_ {0};
+  uint64_t recovery_end_ {0}; /* losses before this are part of the last decrease */
 
   /* Add member variables here */
 
@@ -24,8 +26,8 @@ public:
 
   AimdController( const bool debug,
       const float cwnd,
-      const int aimd_inc_param,
-      const int aimd_dec_param);
+      const float aimd_inc_param,
+      const float aimd_dec_param);
 
   /* Timeout occured*/
   void timed_out( void );
@@ -42,9 +44,10 @@ public:
 		     const uint64_t recv_timestamp_acked,
 		     const uint64_t timestamp_ack_received );
 
-  /* How long to wait (in milliseconds) if there are no acks
-     before sending one more datagram */
-  unsigned int timeout_ms( void );
+  /* A datagram was declared lost */
+  void datagram_lost( const uint64_t sequence_number,
+		      const uint64_t send_timestamp,
+		      const uint64_t timestamp );
 
 };
 
@@ -0,0 +1,77 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "alloc_counter.hh"
+
+using namespace std;
+
+static atomic<uint64_t> allocations_ { 0 };
+
+uint64_t AllocCounter::allocations( void )
+{
+  return allocations_.load( memory_order_relaxed );
+}
+
+/* the replaceable allocation functions; the others (nothrow, arrays)
+   come to these */
+void * operator new( size_t size )
+{
+  allocations_.fetch_add( 1, memory_order_relaxed );
+
+  while ( true ) {
+    void * const ptr = malloc( size ? size : 1 );
+    if ( ptr ) {
+      return ptr;
+    }
+
+    const new_handler handler = get_new_handler();
+    if ( not handler ) {
+      throw bad_alloc();
+    }
+    handler();
+  }
+}
+
+void * operator new[]( size_t size )
+{
+  return operator new( size );
+}
+
+void * operator new( size_t size, const nothrow_t & ) noexcept
+{
+  try {
+    return operator new( size );
+  } catch ( const bad_alloc & ) {
+    return nullptr;
+  }
+}
+
+void * operator new[]( size_t size, const nothrow_t & ) noexcept
+{
+  try {
+    return operator new( size );
+  } catch ( const bad_alloc & ) {
+    return nullptr;
+  }
+}
+
+void operator delete( void * ptr ) noexcept
+{
+  free( ptr );
+}
+
+void operator delete[]( void * ptr ) noexcept
+{
+  free( ptr );
+}
+
+void operator delete( void * ptr, const nothrow_t & ) noexcept
+{
+  free( ptr );
+}
+
+void operator delete[]( void * ptr, const nothrow_t & ) noexcept
+{
+  free( ptr );
+}
@@ -0,0 +1,17 @@
+#ifndef ALLOC_COUNTER_HH
+#define ALLOC_COUNTER_HH
+
+#include <cstdint>
+
+/* Counts the program's heap allocations, by replacing the global
+   operator new (every std::string, container and std::function
+   allocates through it). Only programs that link alloc_counter.cc
+   count: the sender and receiver publish the count as the
+   heap_allocations metric, which should stop rising once they are
+   warmed up, and alloccheck fails if it does not. */
+namespace AllocCounter {
+  /* allocations so far, by all threads */
+  uint64_t allocations( void );
+}
+
+#endif /* ALLOC_COUNTER_HH */
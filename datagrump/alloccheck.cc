@@ -0,0 +1,217 @@
+/* check that the sender's and receiver's packet paths do not allocate:
+   run both over loopback, let them warm up, then watch the
+   heap_allocations metric each publishes while datagrams flow */
+
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "file_descriptor.hh"
+#include "metrics.hh"
+#include "mmap_region.hh"
+#include "socket.hh"
+#include "util.hh"
+
+using namespace std;
+using namespace MetricsLayout;
+
+static void usage( const char * const argv0 )
+{
+  cerr << "Usage: " << argv0 << " [options]" << endl
+       << "  -c, --controller=NAME    the sender's controller (default latte)" << endl
+       << "  -f, --fec=SCHEME         have the sender send repairs (xor or rs)" << endl
+       << "  -w, --warmup=MS          let them run this long first (default 1000)" << endl
+       << "  -m, --measure=MS         then count allocations this long (default 3000)" << endl
+       << "Runs the sender and receiver from the same directory. They publish their" << endl
+       << "metrics as usual, so do not run another sender or receiver meanwhile." << endl;
+}
+
+/* a counter's total in another process's metrics segment */
+static uint64_t read_counter( const string & segment_name, const string & metric )
+{
+  FileDescriptor shm_fd( SystemCall( "shm_open " + segment_name,
+				     shm_open( segment_name.c_str(), O_RDONLY, 0 ) ) );
+  MMapRegion region( sizeof( Segment ), PROT_READ, MAP_SHARED, shm_fd.fd_num() );
+  const Segment & segment = *reinterpret_cast<const Segment *>( region.addr() );
+
+  if ( segment.magic.load( memory_order_acquire ) != MAGIC ) {
+    throw runtime_error( segment_name + " has not published its metrics" );
+  }
+
+  for ( unsigned int i = 0; i < segment.num_metrics and i < MAX_METRICS; i++ ) {
+    const Slot & slot = segment.slots[ i ];
+    if ( slot.kind == Kind::Counter and metric == slot.name ) {
+      uint64_t total = 0;
+      for ( unsigned int j = 0; j < SHARDS; j++ ) {
+	total += slot.shards[ j ].value.load( memory_order_relaxed );
+      }
+      return total;
+    }
+  }
+
+  throw runtime_error( segment_name + " has no counter " + metric );
+}
+
+/* run a program with its output discarded */
+static pid_t spawn( const vector<string> & arguments )
+{
+  const pid_t pid = SystemCall( "fork", fork() );
+  if ( pid == 0 ) {
+    const int null_fd = open( "/dev/null", O_WRONLY );
+    if ( null_fd >= 0 ) {
+      dup2( null_fd, STDOUT_FILENO );
+      dup2( null_fd, STDERR_FILENO );
+    }
+
+    vector<char *> argv;
+    for ( const auto & argument : arguments ) {
+      argv.push_back( const_cast<char *>( argument.c_str() ) );
+    }
+    argv.push_back( nullptr );
+    execv( argv[ 0 ], &argv[ 0 ] );
+    _exit( EXIT_FAILURE );
+  }
+
+  return pid;
+}
+
+/* a datagram count and the allocations that went with it */
+struct Tally
+{
+  uint64_t datagrams;
+  uint64_t allocations;
+};
+
+static Tally tally( const string & segment_name, const string & datagram_metric )
+{
+  return { read_counter( segment_name, datagram_metric ),
+	   read_counter( segment_name, "heap_allocations" ) };
+}
+
+/* Print one program's allocations over the measurement; true if none */
+static bool report( const string & name, const Tally & before, const Tally & after )
+{
+  const uint64_t datagrams = after.datagrams - before.datagrams;
+  const uint64_t allocations = after.allocations - before.allocations;
+
+  cout << "  " << left << setw( 10 ) << name << right
+       << setw( 12 ) << datagrams << setw( 14 ) << allocations
+       << setw( 15 ) << fixed << setprecision( 3 ) << double( allocations ) / max<uint64_t>( datagrams, 1 )
+       << endl;
+
+  return allocations == 0;
+}
+
+int main( int argc, char *argv[] )
+{
+  /* check the command-line arguments */
+  if ( argc < 1 ) { /* for sticklers */
+    abort();
+  }
+
+  const option options[] = {
+    { "controller", required_argument, nullptr, 'c' },
+    { "fec",        required_argument, nullptr, 'f' },
+    { "warmup",     required_argument, nullptr, 'w' },
+    { "measure",    required_argument, nullptr, 'm' },
+    { nullptr,      0,                 nullptr, 0 }
+  };
+
+  string controller = "latte", fec;
+  unsigned int warmup_ms = 1000, measure_ms = 3000;
+
+  int opt;
+  while ( (opt = getopt_long( argc, argv, "c:f:w:m:", options, nullptr )) != -1 ) {
+    switch ( opt ) {
+    case 'c': controller = optarg; break;
+    case 'f': fec = optarg; break;
+    case 'w': warmup_ms = strtoul( optarg, nullptr, 10 ); break;
+    case 'm': measure_ms = strtoul( optarg, nullptr, 10 ); break;
+    default:
+      usage( argv[ 0 ] );
+      return EXIT_FAILURE;
+    }
+  }
+  if ( optind != argc or measure_ms == 0 ) {
+    usage( argv[ 0 ] );
+    return EXIT_FAILURE;
+  }
+
+  const string program = argv[ 0 ];
+  const string directory = program.find( '/' ) == string::npos
+    ? "." : program.substr( 0, program.rfind( '/' ) );
+
+  /* a free port for the receiver */
+  string port;
+  {
+    UDPSocket probe;
+    probe.bind( Address( "::0", 0 ) );
+    port = to_string( probe.local_address().port() );
+  }
+
+  /* keep the sender's path cache out of the user's */
+  const string path_cache = "/tmp/alloccheck-paths." + to_string( getpid() );
+  setenv( "DATAGRUMP_PATH_CACHE", path_cache.c_str(), true );
+
+  vector<string> sender = { directory + "/sender" };
+  if ( not fec.empty() ) {
+    sender.insert( sender.end(), { "-f", fec } );
+  }
+  sender.insert( sender.end(), { "::1", port, controller } );
+
+  const pid_t receiver_pid = spawn( { directory + "/receiver", port } );
+  this_thread::sleep_for( chrono::milliseconds( 100 ) );
+  const pid_t sender_pid = spawn( sender );
+
+  int exit_status = EXIT_FAILURE;
+  try {
+    this_thread::sleep_for( chrono::milliseconds( warmup_ms ) );
+    const Tally sender_before = tally( "/datagrump-sender", "datagrams_sent" );
+    const Tally receiver_before = tally( "/datagrump-receiver", "datagrams_received" );
+
+    this_thread::sleep_for( chrono::milliseconds( measure_ms ) );
+    const Tally sender_after = tally( "/datagrump-sender", "datagrams_sent" );
+    const Tally receiver_after = tally( "/datagrump-receiver", "datagrams_received" );
+
+    /* both must still be running for the counts to mean anything */
+    if ( waitpid( sender_pid, nullptr, WNOHANG ) != 0
+	 or waitpid( receiver_pid, nullptr, WNOHANG ) != 0 ) {
+      throw runtime_error( "sender or receiver exited early" );
+    }
+    if ( sender_after.datagrams == sender_before.datagrams ) {
+      throw runtime_error( "no datagrams were sent" );
+    }
+
+    cout << "After " << warmup_ms << " ms warm-up, over " << measure_ms << " ms ("
+	 << controller << (fec.empty() ? "" : ", FEC " + fec) << "):" << endl
+	 << "  " << left << setw( 10 ) << "" << right << setw( 12 ) << "datagrams"
+	 << setw( 14 ) << "allocations" << setw( 15 ) << "per datagram" << endl;
+
+    const bool sender_ok = report( "sender", sender_before, sender_after );
+    const bool receiver_ok = report( "receiver", receiver_before, receiver_after );
+    exit_status = (sender_ok and receiver_ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+    cout << (exit_status == EXIT_SUCCESS ? "PASS" : "FAIL: the packet path allocates") << endl;
+  } catch ( const exception & e ) {
+    print_exception( e );
+  }
+
+  kill( sender_pid, SIGTERM );
+  kill( receiver_pid, SIGTERM );
+  waitpid( sender_pid, nullptr, 0 );
+  waitpid( receiver_pid, nullptr, 0 );
+  unlink( path_cache.c_str() );
+
+  return exit_status;
+}
@@ -0,0 +1,320 @@
+#include <algorithm>
+#include <iostream>
+
+#include "bbrcontroller.hh"
+#include "timestamp.hh"
+
+using namespace std;
+
+/* ProbeBw pacing gains: phase 0 probes up, phase 1 drains, then cruise */
+static const unsigned int GAIN_CYCLE_LENGTH = 8;
+
+static const char * state_name( const BbrController::State state )
+{
+  switch ( state ) {
+  case BbrController::State::Startup: return "Startup";
+  case BbrController::State::Drain: return "Drain";
+  case BbrController::State::ProbeBw: return "ProbeBw";
+  case BbrController::State::ProbeRtt: return "ProbeRtt";
+  }
+  return "?";
+}
+
+BbrController::BbrController( const bool debug )
+  : BbrController( debug, Params() )
+{}
+
+BbrController::BbrController( const bool debug,
+    const Params & params )
+  : Controller ( debug ),
+    params_ ( params ),
+    pacing_gain_ ( params.high_gain ),
+    cwnd_gain_ ( params.high_gain ),
+    rtt_window_ ( RttWindow(debug) ),
+    delivery_window_ ( DeliveryWindow(debug) ),
+    bw_window_ ( BwWindow(debug) )
+{}
+
+/* Set a parameter by name */
+bool BbrController::Params::set( const string & name, const float value )
+{
+  if (name == "high_gain") { high_gain = value; }
+  else if (name == "cwnd_gain") { cwnd_gain = value; }
+  else if (name == "probe_up_gain") { probe_up_gain = value; }
+  else if (name == "probe_down_gain") { probe_down_gain = value; }
+  else if (name == "full_bw_thresh") { full_bw_thresh = value; }
+  else if (name == "full_bw_rounds") { full_bw_rounds = value; }
+  else if (name == "bw_window_rounds") { bw_window_rounds = value; }
+  else if (name == "probe_rtt_interval_ms") { probe_rtt_interval_ms = value; }
+  else if (name == "probe_rtt_duration_ms") { probe_rtt_duration_ms = value; }
+  else if (name == "min_cwnd") { min_cwnd = value; }
+  else { return false; }
+  return true;
+}
+
+/* Datagrams sent but not yet acked */
+uint64_t BbrController::inflight( void ) const
+{
+  return next_sequence_number_ > largest_acked_ + 1
+    ? next_sequence_number_ - largest_acked_ - 1 : 0;
+}
+
+/* Estimated bandwidth-delay product, in datagrams */
+float BbrController::bdp( void ) const
+{
+  return max_bw_ * min_rtt_;
+}
+
+void BbrController::enter_state( const State state, const uint64_t now )
+{
+  if ( debug_ ) {
+    cerr << "At time " << now << " BBR " << state_name( state_ )
+	 << " -> " << state_name( state ) << endl;
+  }
+
+  state_ = state;
+
+  switch ( state ) {
+  case State::Startup:
+    pacing_gain_ = cwnd_gain_ = params_.high_gain;
+    break;
+  case State::Drain:
+    pacing_gain_ = 1 / params_.high_gain;
+    cwnd_gain_ = params_.high_gain;
+    break;
+  case State::ProbeBw:
+    /* start anywhere in the cycle except the draining phase,
+       so flows sharing a bottleneck probe at different times */
+    cycle_index_ = (next_sequence_number_ % (GAIN_CYCLE_LENGTH - 1) + 2) % GAIN_CYCLE_LENGTH;
+    cycle_stamp_ = now;
+    pacing_gain_ = cycle_index_ == 0 ? params_.probe_up_gain : 1;
+    cwnd_gain_ = params_.cwnd_gain;
+    break;
+  case State::ProbeRtt:
+    pacing_gain_ = cwnd_gain_ = 1;
+    prior_cwnd_ = max( prior_cwnd_, cwnd_ );
+    probe_rtt_done_stamp_ = 0;
+    break;
+  }
+}
+
+/* Count round trips by sequence number */
+void BbrController::update_round( const uint64_t sequence_number_acked )
+{
+  round_start_ = false;
+  if ( sequence_number_acked >= round_end_ ) {
+    round_end_ = next_sequence_number_;
+    round_count_++;
+    round_start_ = true;
+  }
+}
+
+/* Startup is over once max_bw stops growing for a few rounds */
+void BbrController::check_full_pipe( void )
+{
+  if ( filled_pipe_ or not round_start_ ) {
+    return;
+  }
+
+  if ( max_bw_ >= full_bw_ * params_.full_bw_thresh ) {
+    full_bw_ = max_bw_;
+    full_bw_count_ = 0;
+    return;
+  }
+
+  if ( ++full_bw_count_ >= params_.full_bw_rounds ) {
+    filled_pipe_ = true;
+  }
+}
+
+/* Advance the ProbeBw gain cycle about once per min RTT */
+void BbrController::update_gain_cycle( const uint64_t now )
+{
+  bool advance = now - cycle_stamp_ > min_rtt_;
+
+  if ( cycle_index_ == 0 ) {
+    /* keep probing until the extra inflight has actually been sent */
+    advance = advance and inflight() >= params_.probe_up_gain * bdp();
+  } else if ( cycle_index_ == 1 ) {
+    /* stop draining early once the queue is gone */
+    advance = advance or inflight() <= bdp();
+  }
+
+  if ( advance ) {
+    cycle_index_ = (cycle_index_ + 1) % GAIN_CYCLE_LENGTH;
+    cycle_stamp_ = now;
+  }
+
+  pacing_gain_ = cycle_index_ == 0 ? params_.probe_up_gain
+    : cycle_index_ == 1 ? params_.probe_down_gain : 1;
+}
+
+/* Drain the queue for a moment to remeasure min RTT when it is stale */
+void BbrController::update_probe_rtt( const uint64_t now )
+{
+  if ( state_ != State::ProbeRtt ) {
+    if ( min_rtt_stamp_ and now > min_rtt_stamp_ + params_.probe_rtt_interval_ms ) {
+      enter_state( State::ProbeRtt, now );
+    }
+    return;
+  }
+
+  if ( probe_rtt_done_stamp_ == 0 ) {
+    if ( inflight() <= params_.min_cwnd ) {
+      /* hold the small window for the duration and at least one round */
+      probe_rtt_done_stamp_ = now + params_.probe_rtt_duration_ms;
+      probe_rtt_round_done_ = false;
+      round_end_ = next_sequence_number_;
+    }
+    return;
+  }
+
+  if ( round_start_ ) {
+    probe_rtt_round_done_ = true;
+  }
+
+  if ( probe_rtt_round_done_ and now >= probe_rtt_done_stamp_ ) {
+    min_rtt_stamp_ = now;
+    cwnd_ = max( cwnd_, prior_cwnd_ );
+    prior_cwnd_ = 0;
+    enter_state( filled_pipe_ ? State::ProbeBw : State::Startup, now );
+  }
+}
+
+/* Grow cwnd toward cwnd_gain * bdp, one datagram per ack */
+void BbrController::update_cwnd( void )
+{
+  if ( prior_cwnd_ > 0 and state_ != State::ProbeRtt ) {
+    /* first ack after a timeout: restore the window */
+    cwnd_ = max( cwnd_, prior_cwnd_ );
+    prior_cwnd_ = 0;
+  }
+
+  const float target = cwnd_gain_ * bdp();
+  if ( filled_pipe_ ) {
+    cwnd_ = min( cwnd_ + 1, target );
+  } else if ( cwnd_ < target or target == 0 ) {
+    cwnd_ += 1;
+  }
+
+  cwnd_ = max( cwnd_, params_.min_cwnd );
+
+  if ( state_ == State::ProbeRtt ) {
+    cwnd_ = min( cwnd_, params_.min_cwnd );
+  }
+}
+
+/* Get current window size, in datagrams */
+unsigned int BbrController::window_size( void )
+{
+  unsigned int the_window_size = static_cast<unsigned int>(cwnd_);
+
+  if ( debug_ ) {
+    cerr << "At time " << timestamp_ms()
+	 << " window size is " << the_window_size << endl;
+  }
+  return the_window_size;
+}
+
+/* A datagram was sent */
+void BbrController::datagram_was_sent( const uint64_t sequence_number,
+				    /* of the sent datagram */
+				    const uint64_t send_timestamp )
+                                    /* in milliseconds */
+{
+  next_sequence_number_ = max( next_sequence_number_, sequence_number + 1 );
+
+  if ( debug_ ) {
+    cerr << "At time " << send_timestamp
+	 << " sent datagram " << sequence_number << endl;
+  }
+}
+
+/* An ack was received */
+void BbrController::ack_received( const uint64_t sequence_number_acked,
+			       /* what sequence number was acknowledged */
+			       const uint64_t send_timestamp_acked,
+			       /* when the acknowledged datagram was sent (sender's clock) */
+			       const uint64_t recv_timestamp_acked,
+			       /* when the acknowledged datagram was received (receiver's clock)*/
+			       const uint64_t timestamp_ack_received )
+                               /* when the ack was received (by sender) */
+{
+  const uint64_t now = timestamp_ack_received;
+  largest_acked_ = max( largest_acked_, sequence_number_acked );
+
+  /* Min RTT, and when it was last confirmed */
+  const uint64_t rtt_t = now - send_timestamp_acked;
+  srtt_ = 0.875 * srtt_ + 0.125 * rtt_t;
+  rtt_window_.update_rtt_samples(now, rtt_t);
+  min_rtt_ = rtt_window_.min_rtt();
+  if (rtt_t <= min_rtt_ or min_rtt_stamp_ == 0) {
+    min_rtt_stamp_ = now;
+  }
+
+  /* Delivery rate over the acked datagram's flight */
+  auto total_delivered = delivery_window_.get_curr_delivered() + 1;
+  delivery_window_.update_delivery_data(now, total_delivered);
+  auto delivered_at_sendts = delivery_window_.get_delivered(send_timestamp_acked);
+  if (now > delivered_at_sendts.first) {
+    auto bw_t = (float)(total_delivered - delivered_at_sendts.second)/
+      (now - delivered_at_sendts.first);
+    bw_window_.update_bw_window_size(params_.bw_window_rounds * max<uint64_t>(min_rtt_, 1));
+    bw_window_.update_bw_samples(now, bw_t);
+  }
+  max_bw_ = bw_window_.max_bw();
+
+  /* State machine */
+  update_round( sequence_number_acked );
+  check_full_pipe();
+
+  if ( state_ == State::Startup and filled_pipe_ ) {
+    enter_state( State::Drain, now );
+  }
+  if ( state_ == State::Drain and inflight() <= bdp() ) {
+    enter_state( State::ProbeBw, now );
+  }
+  if ( state_ == State::ProbeBw ) {
+    update_gain_cycle( now );
+  }
+  update_probe_rtt( now );
+
+  update_cwnd();
+
+  if ( debug_ ) {
+    cerr << "At time " << timestamp_ack_received
+	 << " received ack for datagram " << sequence_number_acked
+	 << " (send @ time " << send_timestamp_acked
+	 << ", received @ time " << recv_timestamp_acked << " by receiver's clock)"
+	 << ", " << state_name( state_ )
+	 << " max_bw " << max_bw_ << " pkts/ms"
+	 << " min_rtt " << min_rtt_ << " ms"
+	 << " pacing_gain " << pacing_gain_
+	 << " inflight " << inflight()
+	 << ", cwnd " << cwnd_ << endl;
+  }
+}
+
+/* Timeout occured */
+void BbrController::timed_out( void )
+{
+  /* fall back to a minimal window until the next ack, then restore it */
+  if ( state_ != State::ProbeRtt ) {
+    prior_cwnd_ = max( prior_cwnd_, cwnd_ );
+  }
+  cwnd_ = params_.min_cwnd;
+
+  if ( debug_ ) {
+    cerr << "Timed out. cwnd: " << cwnd_ << endl;
+  }
+}
+
+/* Pace at pacing_gain * max_bw (no pacing before the first estimate) */
+float BbrController::get_interpkt_delay( void )
+{
+  if (max_bw_ <= 0) {
+    return 0;
+  }
+  return 1./(pacing_gain_ * max_bw_) * 1000;
+}
+
@@ -0,0 +1,113 @@
+#ifndef BBRCONTROLLER_HH
+#define BBRCONTROLLER_HH
+
+#include <cstdint>
+#include <string>
+
+#include "controller.hh"
+#include "metacontroller.hh"
+
+/* Model-based congestion controller after BBR (Cardwell et al., 2016):
+   estimates bottleneck bandwidth (windowed max of delivery rate) and
+   round-trip propagation time (windowed min RTT), then paces at
+   pacing_gain * max_bw and caps inflight at cwnd_gain * bdp, moving
+   through Startup, Drain, ProbeBw and ProbeRtt. */
+class BbrController : public Controller
+{
+public:
+  /* Tunable parameters */
+  struct Params {
+    float high_gain {2.885};         /* 2/ln(2): Startup doubles each round */
+    float cwnd_gain {2.0};           /* ProbeBw cwnd, in units of bdp */
+    float probe_up_gain {1.25};      /* ProbeBw gain cycle: one phase up, */
+    float probe_down_gain {0.75};    /* one phase down, six cruising at 1 */
+    float full_bw_thresh {1.25};     /* Startup ends when bw grows less than */
+    float full_bw_rounds {3};        /* this factor for this many rounds */
+    float bw_window_rounds {10};     /* max-bandwidth window, in min RTTs */
+    float probe_rtt_interval_ms {10000}; /* ProbeRtt if min RTT this stale */
+    float probe_rtt_duration_ms {200};
+    float min_cwnd {4};
+
+    /* Set a parameter by name; false if there is no such parameter */
+    bool set( const std::string & name, const float value );
+  };
+
+  enum class State { Startup, Drain, ProbeBw, ProbeRtt };
+
+protected:
+  Params params_ {};
+
+  State state_ {State::Startup};
+  float pacing_gain_ {2.885};
+  float cwnd_gain_ {2.885};
+
+  float cwnd_ {10}; /* Congestion window */
+  float prior_cwnd_ {0}; /* saved across ProbeRtt and timeouts */
+  float max_bw_ {0}; /* pkts/ms */
+  uint64_t min_rtt_ {0}; /* ms */
+  uint64_t min_rtt_stamp_ {0};
+  float srtt_ {500};
+
+  /* Round-trip counting: a round ends when a datagram sent after
+     the round began is acked */
+  uint64_t next_sequence_number_ {0};
+  uint64_t largest_acked_ {0};
+  uint64_t round_end_ {0};
+  uint64_t round_count_ {0};
+  bool round_start_ {false};
+
+  /* Startup: has the pipe filled? */
+  float full_bw_ {0};
+  unsigned int full_bw_count_ {0};
+  bool filled_pipe_ {false};
+
+  /* ProbeBw gain cycling */
+  unsigned int cycle_index_ {0};
+  uint64_t cycle_stamp_ {0};
+
+  /* ProbeRtt */
+  uint64_t probe_rtt_done_stamp_ {0};
+  bool probe_rtt_round_done_ {false};
+
+  RttWindow rtt_window_;
+  DeliveryWindow delivery_window_;
+  BwWindow bw_window_;
+
+  uint64_t inflight( void ) const;
+  float bdp( void ) const;
+  void enter_state( const State state, const uint64_t now );
+  void update_round( const uint64_t sequence_number_acked );
+  void check_full_pipe( void );
+  void update_gain_cycle( const uint64_t now );
+  void update_probe_rtt( const uint64_t now );
+  void update_cwnd( void );
+
+public:
+  BbrController( const bool debug );
+
+  BbrController( const bool debug,
+      const Params & params );
+
+  /* Timeout occured*/
+  void timed_out( void );
+
+  /* Wait between packets */
+  float get_interpkt_delay( void );
+
+  /* Get current window size, in datagrams */
+  unsigned int window_size( void );
+
+  /* A datagram was sent */
+  void datagram_was_sent( const uint64_t sequence_number,
+			  const uint64_t send_timestamp );
+
+  /* An ack was received */
+  void ack_received( const uint64_t sequence_number_acked,
+		     const uint64_t send_timestamp_acked,
+		     const uint64_t recv_timestamp_acked,
+		     const uint64_t timestamp_ack_received );
+
+  State state( void ) const { return state_; }
+};
+
+#endif
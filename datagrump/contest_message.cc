@@ -1,3 +1,4 @@
+#include <cstring>
 #include <stdexcept>
 
 #include "contest_message.hh"
@@ -40,45 +41,69 @@ void ContestMessage::set_send_timestamp( void )
   header.send_timestamp = timestamp_ms();
 }
 
-/* helper to put a uint64_t field (in network byte order) */
-string put_header_field( const uint64_t n )
+/* helper to put the nth uint64_t field (in network byte order) */
+static void put_header_field( const size_t n, const uint64_t value, char * const wire )
 {
-  const uint64_t network_order = htobe64( n );
-  return string( reinterpret_cast<const char *>( &network_order ),
-		 sizeof( network_order ) );
+  const uint64_t network_order = htobe64( value );
+  memcpy( wire + n * sizeof( network_order ), &network_order, sizeof( network_order ) );
 }
 
 /* Make wire representation of header */
+void ContestMessage::Header::serialize( char * const wire ) const
+{
+  put_header_field( 0, sequence_number, wire );
+  put_header_field( 1, send_timestamp, wire );
+  put_header_field( 2, ack_sequence_number, wire );
+  put_header_field( 3, ack_send_timestamp, wire );
+  put_header_field( 4, ack_recv_timestamp, wire );
+  put_header_field( 5, ack_payload_length, wire );
+}
+
 string ContestMessage::Header::to_string( void ) const
 {
-  return put_header_field( sequence_number )
-    + put_header_field( send_timestamp )
-    + put_header_field( ack_sequence_number )
-    + put_header_field( ack_send_timestamp )
-    + put_header_field( ack_recv_timestamp )
-    + put_header_field( ack_payload_length );
+  string ret( sizeof( Header ), 0 );
+  serialize( &ret[ 0 ] );
+  return ret;
 }
 
 /* Make wire representation of message */
+void ContestMessage::serialize( const Header & header, const string & payload,
+				string & wire )
+{
+  wire.resize( sizeof( Header ) + payload.size() );
+  header.serialize( &wire[ 0 ] );
+  payload.copy( &wire[ sizeof( Header ) ], payload.size() );
+}
+
 string ContestMessage::to_string( void ) const
 {
-  return header.to_string() + payload;
+  string ret;
+  serialize( header, payload, ret );
+  return ret;
 }
 
-/* Transform into an ack of the ContestMessage */
-void ContestMessage::transform_into_ack( const uint64_t sequence_number,
-					 const uint64_t recv_timestamp )
+/* Transform into an ack of the datagram */
+void ContestMessage::Header::transform_into_ack( const uint64_t s_sequence_number,
+						 const uint64_t recv_timestamp,
+						 const uint64_t payload_length )
 {
   /* ack the old sequence number */
-  header.ack_sequence_number = header.sequence_number;
+  ack_sequence_number = sequence_number;
 
   /* now assign a new sequence number for the outgoing ack */
-  header.sequence_number = sequence_number;
+  sequence_number = s_sequence_number;
 
   /* ack the other fields */
-  header.ack_send_timestamp = header.send_timestamp;
-  header.ack_recv_timestamp = recv_timestamp;
-  header.ack_payload_length = payload.length();
+  ack_send_timestamp = send_timestamp;
+  ack_recv_timestamp = recv_timestamp;
+  ack_payload_length = payload_length;
+}
+
+/* Transform into an ack of the ContestMessage */
+void ContestMessage::transform_into_ack( const uint64_t sequence_number,
+					 const uint64_t recv_timestamp )
+{
+  header.transform_into_ack( sequence_number, recv_timestamp, payload.length() );
 
   /* delete the payload */
   payload.clear();
@@ -23,6 +23,15 @@ struct ContestMessage
 
     /* Make wire representation of header */
     std::string to_string( void ) const;
+
+    /* Same, into the first sizeof( Header ) bytes at `wire` */
+    void serialize( char * const wire ) const;
+
+    /* Turn into the header of an ack of this datagram, whose payload
+       was payload_length bytes */
+    void transform_into_ack( const uint64_t sequence_number,
+			     const uint64_t recv_timestamp,
+			     const uint64_t payload_length );
   } header;
 
   std::string payload;
@@ -40,6 +49,11 @@ struct ContestMessage
   /* Make wire representation of datagram */
   std::string to_string( void ) const;
 
+  /* Same, for any header and payload, into `wire`: its storage is
+     reused, so once it has held a datagram this big nothing allocates */
+  static void serialize( const Header & header, const std::string & payload,
+			 std::string & wire );
+
   /* Transform into an ack of the ContestMessage */
   void transform_into_ack( const uint64_t sequence_number,
 			   const uint64_t recv_timestamp );
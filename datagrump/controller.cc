@@ -59,9 +59,72 @@ void Controller::ack_received( const uint64_t sequence_number_acked,
   }
 }
 
-/* How long to wait (in milliseconds) if there are no acks
-   before sending one more datagram */
-unsigned int Controller::timeout_ms( void )
+/* A burst of acks was received */
+void Controller::acks_received( const Ack * const acks, const size_t count )
 {
-  return 1000; /* timeout of one second */
+  for ( size_t i = 0; i < count; i++ ) {
+    ack_received( acks[ i ].sequence_number_acked, acks[ i ].send_timestamp_acked,
+		  acks[ i ].recv_timestamp_acked, acks[ i ].timestamp_ack_received );
+  }
+}
+
+/* A datagram was declared lost */
+void Controller::datagram_lost( const uint64_t sequence_number,
+				/* of the lost datagram */
+				const uint64_t send_timestamp,
+				/* when it was sent */
+				const uint64_t timestamp )
+                                /* when the loss was detected */
+{
+  /* Default: take no action */
+
+  if ( debug_ ) {
+    cerr << "At time " << timestamp
+	 << " datagram " << sequence_number
+	 << " (send @ time " << send_timestamp << ") was lost" << endl;
+  }
+}
+
+/* An ack arrived for a datagram declared lost */
+void Controller::reordering_detected( const uint64_t sequence_number,
+				      const uint64_t timestamp )
+{
+  /* Default: take no action */
+
+  if ( debug_ ) {
+    cerr << "At time " << timestamp
+	 << " datagram " << sequence_number << " turned out to be reordered, not lost" << endl;
+  }
+}
+
+/* Timeout occured */
+void Controller::timed_out( void )
+{
+  /* Default: take no action */
+
+  if ( debug_ ) {
+    cerr << "Timed out." << endl;
+  }
+}
+
+/* Wait between packets (in microseconds) */
+float Controller::get_interpkt_delay( void )
+{
+  return 0; /* no pacing */
+}
+
+/* Start from what an earlier run learned about the path */
+void Controller::warm_start( const PathEstimate & estimate )
+{
+  /* Default: take no action */
+
+  if ( debug_ ) {
+    cerr << "Warm start ignored (min_rtt " << estimate.min_rtt_ms << " ms)" << endl;
+  }
+}
+
+/* What this controller has learned about the path */
+bool Controller::path_estimate( PathEstimate & )
+{
+  return false; /* nothing */
 }
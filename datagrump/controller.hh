@@ -1,8 +1,27 @@
 #ifndef CONTROLLER_HH
 #define CONTROLLER_HH
 
+#include <cstddef>
 #include <cstdint>
 
+/* What is known about a network path, for warm-starting a controller */
+struct PathEstimate
+{
+  float min_rtt_ms {0};
+  float max_bw {0};      /* pkts/ms */
+  float loss_rate {0};
+  float confidence {1};  /* 0..1: how much to trust it (it may be stale) */
+};
+
+/* One ack, with the arguments ack_received() takes */
+struct Ack
+{
+  uint64_t sequence_number_acked;
+  uint64_t send_timestamp_acked;    /* sender's clock */
+  uint64_t recv_timestamp_acked;    /* receiver's clock */
+  uint64_t timestamp_ack_received;  /* sender's clock */
+};
+
 /* Congestion controller interface */
 
 class Controller
@@ -20,22 +39,45 @@ public:
   /* Default constructor */
   Controller( const bool debug );
 
+  virtual ~Controller() {}
+
   /* Get current window size, in datagrams */
-  unsigned int window_size( void );
+  virtual unsigned int window_size( void );
 
   /* A datagram was sent */
-  void datagram_was_sent( const uint64_t sequence_number,
-			  const uint64_t send_timestamp );
+  virtual void datagram_was_sent( const uint64_t sequence_number,
+				  const uint64_t send_timestamp );
 
   /* An ack was received */
-  void ack_received( const uint64_t sequence_number_acked,
-		     const uint64_t send_timestamp_acked,
-		     const uint64_t recv_timestamp_acked,
-		     const uint64_t timestamp_ack_received );
-
-  /* How long to wait (in milliseconds) if there are no acks
-     before sending one more datagram */
-  unsigned int timeout_ms( void );
+  virtual void ack_received( const uint64_t sequence_number_acked,
+			     const uint64_t send_timestamp_acked,
+			     const uint64_t recv_timestamp_acked,
+			     const uint64_t timestamp_ack_received );
+
+  /* A burst of acks read together, oldest first (default: ack_received()
+     for each; controllers can instead settle the window once per burst) */
+  virtual void acks_received( const Ack * const acks, const size_t count );
+
+  /* A datagram was declared lost (see LossDetector) */
+  virtual void datagram_lost( const uint64_t sequence_number,
+			      const uint64_t send_timestamp,
+			      const uint64_t timestamp );
+
+  /* An ack arrived for a datagram declared lost: it was reordered */
+  virtual void reordering_detected( const uint64_t sequence_number,
+				    const uint64_t timestamp );
+
+  /* Timeout occured */
+  virtual void timed_out( void );
+
+  /* Wait between packets (in microseconds) */
+  virtual float get_interpkt_delay( void );
+
+  /* Start from what an earlier run learned about the path */
+  virtual void warm_start( const PathEstimate & estimate );
+
+  /* What this controller has learned about the path; false if nothing */
+  virtual bool path_estimate( PathEstimate & estimate );
 };
 
 #endif
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "controller_factory.hh"
+#include "aimdcontroller.hh"
+#include "bbrcontroller.hh"
+#include "copacontroller.hh"
+#include "lattecontroller.hh"
+#include "metacontroller.hh"
+#include "remycontroller.hh"
+#include "rttaimdcontroller.hh"
+#include "rttcontroller.hh"
+#include "shadowcontroller.hh"
+#include "sproutcontroller.hh"
+#include "vivacecontroller.hh"
+
+using namespace std;
+
+/* Apply settings to a controller's Params */
+template <typename Params>
+static Params make_params( const string & controller, const ControllerSettings & settings )
+{
+  Params params;
+  for ( const auto & setting : settings ) {
+    if ( not params.set( setting.first, setting.second ) ) {
+      throw runtime_error( controller + " has no parameter " + setting.first );
+    }
+  }
+  return params;
+}
+
+/* Look up settings for controllers built from plain constructor arguments */
+class SettingsReader
+{
+private:
+  const string & controller_;
+  const ControllerSettings & settings_;
+  vector<string> used_ {};
+
+public:
+  SettingsReader( const string & controller, const ControllerSettings & settings )
+    : controller_( controller ), settings_( settings )
+  {}
+
+  float get( const string & name, const float default_value )
+  {
+    for ( const auto & setting : settings_ ) {
+      if ( setting.first == name ) {
+	used_.push_back( name );
+	return setting.second;
+      }
+    }
+    return default_value;
+  }
+
+  /* throw if any setting was not consumed */
+  void check( void ) const
+  {
+    for ( const auto & setting : settings_ ) {
+      if ( find( used_.begin(), used_.end(), setting.first ) == used_.end() ) {
+	throw runtime_error( controller_ + " has no parameter " + setting.first );
+      }
+    }
+  }
+};
+
+/* Construct a controller by name */
+unique_ptr<Controller> make_controller( const string & name, const bool debug,
+					const ControllerSettings & settings )
+{
+  SettingsReader reader( name, settings );
+  unique_ptr<Controller> ret;
+
+  if ( name == "latte" ) {
+    return unique_ptr<Controller>( new LatteController( debug,
+      make_params<LatteController::Params>( name, settings ) ) );
+  } else if ( name == "meta" ) {
+    return unique_ptr<Controller>( new MetaController( debug,
+      make_params<MetaController::Params>( name, settings ) ) );
+  } else if ( name == "bbr" ) {
+    return unique_ptr<Controller>( new BbrController( debug,
+      make_params<BbrController::Params>( name, settings ) ) );
+  } else if ( name == "copa" ) {
+    return unique_ptr<Controller>( new CopaController( debug,
+      make_params<CopaController::Params>( name, settings ) ) );
+  } else if ( name == "sprout" ) {
+    return unique_ptr<Controller>( new SproutController( debug,
+      make_params<SproutController::Params>( name, settings ) ) );
+  } else if ( name == "vivace" ) {
+    return unique_ptr<Controller>( new VivaceController( debug,
+      make_params<VivaceController::Params>( name, settings ) ) );
+  } else if ( name == "shadow" ) {
+    return unique_ptr<Controller>( new ShadowController( debug,
+      make_params<ShadowController::Params>( name, settings ) ) );
+  } else if ( name == "remy" ) {
+    return unique_ptr<Controller>( new RemyController( debug,
+      make_params<RemyController::Params>( name, settings ) ) );
+  } else if ( name.compare( 0, 5, "remy:" ) == 0 ) {
+    return unique_ptr<Controller>( new RemyController( debug,
+      make_params<RemyController::Params>( "remy", settings ),
+      RemyTable::load( name.substr( 5 ) ) ) );
+  } else if ( name == "aimd" ) {
+    ret.reset( new AimdController( debug, reader.get( "cwnd", 50 ),
+				   reader.get( "inc", 0 ), reader.get( "dec", 1 ) ) );
+  } else if ( name == "rtt" ) {
+    ret.reset( new RttController( debug, reader.get( "cwnd", 50 ),
+				  reader.get( "rtt_thresh", 500 ) ) );
+  } else if ( name == "rttaimd" ) {
+    ret.reset( new RttAimdController( debug, reader.get( "cwnd", 50 ),
+				      reader.get( "rtt_thresh", 500 ) ) );
+  } else if ( name == "fixed" ) {
+    ret.reset( new Controller( debug ) );
+  } else {
+    throw runtime_error( "unknown controller: " + name );
+  }
+
+  reader.check();
+  return ret;
+}
+
+/* Names accepted by make_controller() */
+vector<string> controller_names( void )
+{
+  return { "latte", "meta", "bbr", "copa", "sprout", "vivace", "remy", "shadow", "aimd", "rtt", "rttaimd", "fixed" };
+}
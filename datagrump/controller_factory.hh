@@ -0,0 +1,23 @@
+#ifndef CONTROLLER_FACTORY_HH
+#define CONTROLLER_FACTORY_HH
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "controller.hh"
+
+/* Parameter overrides, as (name, value) pairs */
+typedef std::vector<std::pair<std::string, float>> ControllerSettings;
+
+/* Construct a controller by name, applying any parameter overrides
+   (throws on an unknown controller or parameter name) */
+std::unique_ptr<Controller> make_controller( const std::string & name,
+					     const bool debug,
+					     const ControllerSettings & settings = {} );
+
+/* Names accepted by make_controller() */
+std::vector<std::string> controller_names( void );
+
+#endif /* CONTROLLER_FACTORY_HH */
@@ -0,0 +1,239 @@
+/* microbenchmark and replay harness for congestion controllers:
+   drives each controller with synthetic or recorded ack streams and
+   reports CPU cost per ack, heap allocations per ack and cwnd */
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "aimdcontroller.hh"
+#include "alloc_counter.hh"
+#include "bbrcontroller.hh"
+#include "copacontroller.hh"
+#include "lattecontroller.hh"
+#include "metacontroller.hh"
+#include "remycontroller.hh"
+#include "rttcontroller.hh"
+#include "shadowcontroller.hh"
+#include "sproutcontroller.hh"
+#include "vivacecontroller.hh"
+
+using namespace std;
+
+/* four acks per ms at a fixed 50 ms RTT */
+static vector<Ack> steady_acks( const uint64_t count )
+{
+  const uint64_t rtt = 50;
+  vector<Ack> ret;
+  for ( uint64_t i = 0; i < count; i++ ) {
+    const uint64_t now = 1000 + i / 4; /* 4 acks per ms */
+    ret.push_back( { i, now - rtt, now - rtt / 2, now } );
+  }
+  return ret;
+}
+
+/* acks delivered in aggregated bursts of 20 every 5 ms */
+static vector<Ack> bursty_acks( const uint64_t count )
+{
+  const uint64_t rtt = 50, burst = 20, gap = 5;
+  vector<Ack> ret;
+  for ( uint64_t i = 0; i < count; i++ ) {
+    const uint64_t now = 1000 + (i / burst) * gap;
+    const uint64_t sent = now - rtt - gap + (i % burst) * gap / burst;
+    ret.push_back( { i, sent, sent + rtt / 2, now } );
+  }
+  return ret;
+}
+
+/* RTT ramping from 40 to 240 ms and back down, repeatedly */
+static vector<Ack> ramp_acks( const uint64_t count )
+{
+  vector<Ack> ret;
+  for ( uint64_t i = 0; i < count; i++ ) {
+    const uint64_t now = 1000 + i / 4;
+    const uint64_t phase = (now / 10) % 400;
+    const uint64_t rtt = 40 + (phase < 200 ? phase : 400 - phase);
+    ret.push_back( { i, now - rtt, now - rtt / 2, now } );
+  }
+  return ret;
+}
+
+/* acks recorded by a controller's debug output, e.g. from
+   "./sender HOST PORT debug 2> trace" */
+static vector<Ack> recorded_acks( const string & filename )
+{
+  ifstream trace( filename );
+  if ( not trace.is_open() ) {
+    throw runtime_error( "cannot open trace " + filename );
+  }
+
+  vector<Ack> ret;
+  string line;
+  while ( getline( trace, line ) ) {
+    Ack ack;
+    if ( sscanf( line.c_str(),
+		 "At time %" SCNu64 " received ack for datagram %" SCNu64
+		 " (send @ time %" SCNu64 ", received @ time %" SCNu64,
+		 &ack.timestamp_ack_received, &ack.sequence_number_acked,
+		 &ack.send_timestamp_acked, &ack.recv_timestamp_acked ) == 4 ) {
+      ret.push_back( ack );
+    }
+  }
+
+  if ( ret.empty() ) {
+    throw runtime_error( "no acks found in " + filename );
+  }
+
+  return ret;
+}
+
+struct Result
+{
+  double ns_per_ack;
+  double allocations_per_ack;
+  double mean_cwnd;
+  unsigned int final_cwnd;
+};
+
+/* feed the acks to a fresh controller the way DatagrumpSender does:
+   in bursts of up to `burst` acks that arrived in the same ms (as one
+   read might return them), or one ack_received() per ack if burst is 1 */
+template <typename ControllerType>
+static Result run( const vector<Ack> & acks, const size_t burst, ostream * const trajectory )
+{
+  ControllerType controller( false );
+  double cwnd_sum = 0;
+  unsigned int cwnd = 0;
+  uint64_t last_sample = 0;
+
+  const uint64_t allocations_before = AllocCounter::allocations();
+  const auto start = chrono::steady_clock::now();
+
+  for ( size_t i = 0; i < acks.size(); ) {
+    const Ack & ack = acks[ i ];
+    size_t count = 1;
+    if ( burst == 1 ) {
+      controller.ack_received( ack.sequence_number_acked, ack.send_timestamp_acked,
+			       ack.recv_timestamp_acked, ack.timestamp_ack_received );
+    } else {
+      while ( count < burst and i + count < acks.size()
+	      and acks[ i + count ].timestamp_ack_received == ack.timestamp_ack_received ) {
+	count++;
+      }
+      controller.acks_received( &ack, count );
+    }
+    i += count;
+
+    cwnd = controller.window_size();
+    cwnd_sum += cwnd * count;
+
+    if ( trajectory and ack.timestamp_ack_received >= last_sample + 10 ) {
+      *trajectory << ack.timestamp_ack_received << " " << cwnd << "\n";
+      last_sample = ack.timestamp_ack_received;
+    }
+  }
+
+  const auto end = chrono::steady_clock::now();
+
+  return { chrono::duration<double, nano>( end - start ).count() / acks.size(),
+	   double( AllocCounter::allocations() - allocations_before ) / acks.size(),
+	   cwnd_sum / acks.size(),
+	   cwnd };
+}
+
+template <typename ControllerType>
+static void report( const string & controller_name, const string & scenario_name,
+		    const vector<Ack> & acks, const size_t burst, const string & trajectory_dir )
+{
+  unique_ptr<ofstream> trajectory;
+  if ( not trajectory_dir.empty() ) {
+    trajectory.reset( new ofstream( trajectory_dir + "/" + controller_name
+				    + "-" + scenario_name + ".dat" ) );
+  }
+
+  run<ControllerType>( acks, burst, nullptr ); /* warm up */
+  const Result result = run<ControllerType>( acks, burst, trajectory.get() );
+
+  cout << left << setw( 12 ) << controller_name << setw( 12 ) << scenario_name << right
+       << setw( 10 ) << acks.size()
+       << fixed << setprecision( 1 ) << setw( 10 ) << result.ns_per_ack
+       << setprecision( 3 ) << setw( 12 ) << result.allocations_per_ack
+       << setprecision( 1 ) << setw( 10 ) << result.mean_cwnd
+       << setw( 8 ) << result.final_cwnd << endl;
+}
+
+int main( int argc, char *argv[] )
+{
+  /* check the command-line arguments */
+  if ( argc < 1 ) { /* for sticklers */
+    abort();
+  }
+
+  string trajectory_dir;
+  size_t burst = 1;
+  vector<string> scenarios;
+  for ( int i = 1; i < argc; i++ ) {
+    const string arg = argv[ i ];
+    if ( arg == "-t" and i + 1 < argc ) {
+      trajectory_dir = argv[ ++i ];
+    } else if ( arg == "-b" and i + 1 < argc ) {
+      burst = max( 1, atoi( argv[ ++i ] ) );
+    } else if ( arg[ 0 ] == '-' ) {
+      cerr << "Usage: " << argv[ 0 ] << " [-t TRAJECTORY_DIR] [-b BURST] [steady|bursty|ramp|TRACE]..." << endl;
+      return EXIT_FAILURE;
+    } else {
+      scenarios.push_back( arg );
+    }
+  }
+
+  if ( scenarios.empty() ) {
+    scenarios = { "steady", "bursty", "ramp" };
+  }
+
+  try {
+    const uint64_t count = 200000;
+
+    cout << left << setw( 12 ) << "controller" << setw( 12 ) << "scenario" << right
+	 << setw( 10 ) << "acks" << setw( 10 ) << "ns/ack" << setw( 12 ) << "allocs/ack"
+	 << setw( 10 ) << "mean cwnd" << setw( 8 ) << "cwnd" << endl;
+
+    for ( const auto & scenario : scenarios ) {
+      vector<Ack> acks;
+      string name = scenario;
+      if ( scenario == "steady" ) {
+	acks = steady_acks( count );
+      } else if ( scenario == "bursty" ) {
+	acks = bursty_acks( count );
+      } else if ( scenario == "ramp" ) {
+	acks = ramp_acks( count );
+      } else {
+	acks = recorded_acks( scenario );
+	name = scenario.substr( scenario.find_last_of( '/' ) + 1 );
+      }
+
+      report<LatteController>( "latte", name, acks, burst, trajectory_dir );
+      report<MetaController>( "meta", name, acks, burst, trajectory_dir );
+      report<BbrController>( "bbr", name, acks, burst, trajectory_dir );
+      report<CopaController>( "copa", name, acks, burst, trajectory_dir );
+      report<SproutController>( "sprout", name, acks, burst, trajectory_dir );
+      report<VivaceController>( "vivace", name, acks, burst, trajectory_dir );
+      report<RemyController>( "remy", name, acks, burst, trajectory_dir );
+      report<ShadowController>( "shadow", name, acks, burst, trajectory_dir );
+      report<AimdController>( "aimd", name, acks, burst, trajectory_dir );
+      report<RttController>( "rtt", name, acks, burst, trajectory_dir );
+    }
+  } catch ( const exception & e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <iostream>
+
+#include "copacontroller.hh"
+#include "timestamp.hh"
+
+using namespace std;
+
+CopaController::CopaController( const bool debug )
+  : CopaController( debug, Params() )
+{}
+
+CopaController::CopaController( const bool debug,
+    const Params & params )
+  : Controller ( debug ),
+    params_ ( params ),
+    delta_ ( params.delta ),
+    rtt_window_ ( RttWindow(debug) )
+{}
+
+/* Set a parameter by name */
+bool CopaController::Params::set( const string & name, const float value )
+{
+  if (name == "delta") { delta = value; }
+  else if (name == "velocity_rounds") { velocity_rounds = value; }
+  else if (name == "empty_thresh") { empty_thresh = value; }
+  else if (name == "competitive_rtts") { competitive_rtts = value; }
+  else if (name == "competitive") { competitive = value; }
+  else if (name == "min_cwnd") { min_cwnd = value; }
+  else { return false; }
+  return true;
+}
+
+/* Once per RTT: speed up window changes that keep going the same way */
+void CopaController::update_velocity( const uint64_t now )
+{
+  if ( now - round_stamp_ < srtt_ ) {
+    return;
+  }
+
+  const int direction = cwnd_ > cwnd_at_round_start_ ? 1 : -1;
+  if ( direction == direction_ ) {
+    if ( ++same_direction_rounds_ >= params_.velocity_rounds ) {
+      velocity_ = min( 2 * velocity_, cwnd_ );
+    }
+  } else {
+    direction_ = direction;
+    same_direction_rounds_ = 0;
+    velocity_ = 1;
+  }
+
+  cwnd_at_round_start_ = cwnd_;
+  round_stamp_ = now;
+
+  /* competitive mode: grow 1/delta by one packet per RTT */
+  if ( competitive_mode_ ) {
+    delta_ = min( params_.delta, 1 / (1 / delta_ + 1) );
+  }
+}
+
+/* Has the queue drained recently? If not, some other flow keeps it full */
+void CopaController::update_mode( const uint64_t now, const uint64_t rtt )
+{
+  max_rtt_filter_.set_window( 4 * max<uint64_t>( srtt_, 1 ) );
+  max_rtt_filter_.update( now, rtt );
+
+  const float max_queueing = max_rtt_filter_.best() - min_rtt_;
+  if ( standing_rtt_ - min_rtt_ <= params_.empty_thresh * max_queueing ) {
+    last_empty_stamp_ = now;
+  }
+
+  const bool competitive = params_.competitive != 0
+    and now - last_empty_stamp_ > params_.competitive_rtts * srtt_;
+
+  if ( competitive != competitive_mode_ ) {
+    if ( debug_ ) {
+      cerr << "At time " << now << " Copa "
+	   << (competitive ? "competitive" : "default") << " mode" << endl;
+    }
+    competitive_mode_ = competitive;
+    delta_ = params_.delta;
+  }
+}
+
+/* Get current window size, in datagrams */
+unsigned int CopaController::window_size( void )
+{
+  unsigned int the_window_size = static_cast<unsigned int>(cwnd_);
+
+  if ( debug_ ) {
+    cerr << "At time " << timestamp_ms()
+	 << " window size is " << the_window_size << endl;
+  }
+  return the_window_size;
+}
+
+/* An ack was received */
+void CopaController::ack_received( const uint64_t sequence_number_acked,
+			       /* what sequence number was acknowledged */
+			       const uint64_t send_timestamp_acked,
+			       /* when the acknowledged datagram was sent (sender's clock) */
+			       const uint64_t recv_timestamp_acked,
+			       /* when the acknowledged datagram was received (receiver's clock)*/
+			       const uint64_t timestamp_ack_received )
+                               /* when the ack was received (by sender) */
+{
+  const uint64_t now = timestamp_ack_received;
+  const uint64_t rtt_t = max<uint64_t>( now - send_timestamp_acked, 1 );
+
+  srtt_ = srtt_ == 0 ? rtt_t : 0.875 * srtt_ + 0.125 * rtt_t;
+
+  /* RTTmin over the long window, RTTstanding over half an RTT */
+  rtt_window_.update_rtt_samples(now, rtt_t);
+  min_rtt_ = rtt_window_.min_rtt();
+  standing_rtt_ = rtt_window_.standing_rtt(max<uint64_t>(srtt_ / 2, 1));
+
+  update_mode( now, rtt_t );
+
+  /* target rate 1/(delta * dq) against current rate cwnd/RTTstanding */
+  const float queueing_delay = standing_rtt_ - min_rtt_;
+  const bool increase = queueing_delay == 0
+    or cwnd_ / standing_rtt_ <= 1 / (delta_ * queueing_delay);
+
+  if ( slow_start_ ) {
+    if ( increase ) {
+      cwnd_ += 1; /* doubles every RTT */
+    } else {
+      slow_start_ = false;
+    }
+  }
+
+  if ( not slow_start_ ) {
+    update_velocity( now );
+    const float step = velocity_ / (delta_ * cwnd_);
+    cwnd_ = increase ? cwnd_ + step : cwnd_ - step;
+  }
+
+  cwnd_ = max( cwnd_, params_.min_cwnd );
+
+  if ( debug_ ) {
+    cerr << "At time " << timestamp_ack_received
+	 << " received ack for datagram " << sequence_number_acked
+	 << " (send @ time " << send_timestamp_acked
+	 << ", received @ time " << recv_timestamp_acked << " by receiver's clock)"
+	 << ", min_rtt " << min_rtt_
+	 << " standing_rtt " << standing_rtt_
+	 << " delta " << delta_
+	 << " velocity " << velocity_
+	 << ", cwnd " << cwnd_ << endl;
+  }
+}
+
+/* Timeout occured */
+void CopaController::timed_out( void )
+{
+  /* treat as loss: halve the window, restart velocity, and in
+     competitive mode halve 1/delta */
+  cwnd_ = max( cwnd_ / 2, params_.min_cwnd );
+  velocity_ = 1;
+  same_direction_rounds_ = 0;
+  if ( competitive_mode_ ) {
+    delta_ = min( params_.delta, 2 * delta_ );
+  }
+
+  if ( debug_ ) {
+    cerr << "Timed out. cwnd: " << cwnd_ << endl;
+  }
+}
+
+/* Pace at twice cwnd per RTTstanding, so bursts do not fill the queue */
+float CopaController::get_interpkt_delay( void )
+{
+  if (standing_rtt_ == 0) {
+    return 0;
+  }
+  return standing_rtt_ / (2 * cwnd_) * 1000;
+}
+
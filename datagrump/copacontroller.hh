@@ -0,0 +1,82 @@
+#ifndef COPACONTROLLER_HH
+#define COPACONTROLLER_HH
+
+#include <cstdint>
+#include <string>
+
+#include "controller.hh"
+#include "metacontroller.hh"
+#include "windowed_filter.hh"
+
+/* Delay-based congestion controller after Copa (Arun and Balakrishnan,
+   NSDI 2018): steers the sending rate cwnd / RTTstanding toward
+   1 / (delta * queueing delay), so a smaller delta buys throughput with
+   delay. Window changes accelerate (velocity) while they keep going
+   the same way, and delta backs off in competitive mode when the
+   queue never drains (i.e. a buffer-filling flow shares the link). */
+class CopaController : public Controller
+{
+public:
+  /* Tunable parameters */
+  struct Params {
+    float delta {0.5};            /* default mode: target 1/delta packets queued */
+    float velocity_rounds {3};    /* double velocity after this many RTTs one way */
+    float empty_thresh {0.1};     /* queue "empty" below this share of max delay */
+    float competitive_rtts {5};   /* competitive if not empty for this many RTTs */
+    float competitive {1};        /* nonzero enables competitive mode */
+    float min_cwnd {2};
+
+    /* Set a parameter by name; false if there is no such parameter */
+    bool set( const std::string & name, const float value );
+  };
+
+protected:
+  Params params_ {};
+
+  float cwnd_ {10}; /* Congestion window */
+  float delta_ {0.5};
+  float srtt_ {0};
+  uint64_t min_rtt_ {0};
+  uint64_t standing_rtt_ {0};
+  bool slow_start_ {true};
+
+  /* velocity, updated once per RTT */
+  float velocity_ {1};
+  int direction_ {0}; /* +1 increasing, -1 decreasing */
+  unsigned int same_direction_rounds_ {0};
+  float cwnd_at_round_start_ {10};
+  uint64_t round_stamp_ {0};
+
+  /* competitive-mode detection */
+  bool competitive_mode_ {false};
+  uint64_t last_empty_stamp_ {0};
+  WindowedMaxFilter<uint64_t> max_rtt_filter_ {400, 10000};
+
+  RttWindow rtt_window_;
+
+  void update_velocity( const uint64_t now );
+  void update_mode( const uint64_t now, const uint64_t rtt );
+
+public:
+  CopaController( const bool debug );
+
+  CopaController( const bool debug,
+      const Params & params );
+
+  /* Timeout occured*/
+  void timed_out( void );
+
+  /* Wait between packets */
+  float get_interpkt_delay( void );
+
+  /* Get current window size, in datagrams */
+  unsigned int window_size( void );
+
+  /* An ack was received */
+  void ack_received( const uint64_t sequence_number_acked,
+		     const uint64_t send_timestamp_acked,
+		     const uint64_t recv_timestamp_acked,
+		     const uint64_t timestamp_ack_received );
+};
+
+#endif
@@ -0,0 +1,47 @@
+#include "cpu_features.hh"
+
+using namespace std;
+
+typedef CpuFeatures::Implementation Implementation;
+
+bool CpuFeatures::supported( const Implementation implementation )
+{
+  switch ( implementation ) {
+  case Implementation::Scalar:
+    return true;
+#ifdef CPU_FEATURES_X86
+  case Implementation::SSSE3:
+    __builtin_cpu_init();
+    return __builtin_cpu_supports( "ssse3" );
+  case Implementation::AVX2:
+    __builtin_cpu_init();
+    return __builtin_cpu_supports( "avx2" );
+#else
+  default:
+    return false;
+#endif
+  }
+
+  return false;
+}
+
+Implementation CpuFeatures::best_implementation( void )
+{
+  static const Implementation best
+    = supported( Implementation::AVX2 ) ? Implementation::AVX2
+    : supported( Implementation::SSSE3 ) ? Implementation::SSSE3
+    : Implementation::Scalar;
+
+  return best;
+}
+
+string CpuFeatures::name( const Implementation implementation )
+{
+  switch ( implementation ) {
+  case Implementation::Scalar: return "scalar";
+  case Implementation::SSSE3: return "ssse3";
+  case Implementation::AVX2: return "avx2";
+  }
+
+  return "unknown";
+}
@@ -0,0 +1,25 @@
+#ifndef CPU_FEATURES_HH
+#define CPU_FEATURES_HH
+
+#include <string>
+
+/* x86 kernels are built with GCC's target attributes, so one binary
+   carries them all and picks at run time */
+#if defined( __x86_64__ ) && defined( __GNUC__ )
+#define CPU_FEATURES_X86
+#endif
+
+/* The instruction sets the SIMD kernels (HeaderBatch, GF256) come in,
+   and which of them this CPU has */
+namespace CpuFeatures {
+  enum class Implementation { Scalar, SSSE3, AVX2 };
+
+  bool supported( const Implementation implementation );
+
+  /* the best this CPU supports (checked once) */
+  Implementation best_implementation( void );
+
+  std::string name( const Implementation implementation );
+}
+
+#endif /* CPU_FEATURES_HH */
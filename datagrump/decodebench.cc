@@ -0,0 +1,153 @@
+/* microbenchmark: per-ack cost of decoding ack headers, one ContestMessage
+   at a time vs. a HeaderBatch per burst */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "contest_message.hh"
+#include "header_batch.hh"
+
+using namespace std;
+
+typedef vector<UDPSocket::received_datagram> Burst;
+
+/* timings are the best of this many runs */
+static const unsigned int ROUNDS = 5;
+
+template <typename Run>
+static double best_of( const Run & run )
+{
+  double best = run();
+  for ( unsigned int i = 1; i < ROUNDS; i++ ) {
+    best = min( best, run() );
+  }
+  return best;
+}
+
+/* the original path: parse each ack into a ContestMessage */
+static double run_messages( const vector<Burst> & bursts, uint64_t & checksum )
+{
+  uint64_t acks = 0;
+  const auto start = chrono::steady_clock::now();
+  for ( const auto & burst : bursts ) {
+    for ( const auto & datagram : burst ) {
+      const ContestMessage ack = datagram.payload;
+      checksum += ack.header.ack_sequence_number + ack.header.ack_send_timestamp
+	+ ack.header.ack_recv_timestamp + ack.header.ack_payload_length;
+      acks++;
+    }
+  }
+  const auto end = chrono::steady_clock::now();
+
+  return chrono::duration<double, nano>( end - start ).count() / acks;
+}
+
+static double run_batch( const HeaderBatch::Implementation implementation,
+			 const vector<Burst> & bursts, uint64_t & checksum )
+{
+  HeaderBatch batch( implementation );
+
+  uint64_t acks = 0;
+  const auto start = chrono::steady_clock::now();
+  for ( const auto & burst : bursts ) {
+    batch.decode( burst, burst.size() );
+    for ( size_t i = 0; i < batch.size(); i++ ) {
+      checksum += batch.ack_sequence_number[ i ] + batch.ack_send_timestamp[ i ]
+	+ batch.ack_recv_timestamp[ i ] + batch.ack_payload_length[ i ];
+    }
+    acks += batch.size();
+  }
+  const auto end = chrono::steady_clock::now();
+
+  return chrono::duration<double, nano>( end - start ).count() / acks;
+}
+
+/* every implementation must agree with ContestMessage field for field */
+static void check( const HeaderBatch::Implementation implementation, const Burst & burst )
+{
+  HeaderBatch batch( implementation );
+  batch.decode( burst, burst.size() );
+
+  for ( size_t i = 0; i < burst.size(); i++ ) {
+    const ContestMessage message = burst[ i ].payload;
+    if ( not batch.valid[ i ]
+	 or batch.sequence_number[ i ] != message.header.sequence_number
+	 or batch.send_timestamp[ i ] != message.header.send_timestamp
+	 or batch.ack_sequence_number[ i ] != message.header.ack_sequence_number
+	 or batch.ack_send_timestamp[ i ] != message.header.ack_send_timestamp
+	 or batch.ack_recv_timestamp[ i ] != message.header.ack_recv_timestamp
+	 or batch.ack_payload_length[ i ] != message.header.ack_payload_length ) {
+      throw runtime_error( CpuFeatures::name( implementation ) + " decoder disagrees at ack "
+			   + to_string( i ) );
+    }
+  }
+}
+
+int main( int argc, char *argv[] )
+{
+  /* check the command-line arguments */
+  if ( argc < 1 ) { /* for sticklers */
+    abort();
+  }
+
+  if ( argc > 2 ) {
+    cerr << "Usage: " << argv[ 0 ] << " [ACKS]" << endl;
+    return EXIT_FAILURE;
+  }
+
+  const uint64_t acks = argc == 2 ? strtoull( argv[ 1 ], nullptr, 10 ) : 1000000;
+
+  /* acks as the receiver sends them, with random fields */
+  mt19937_64 prng( 6829 );
+  vector<string> payloads;
+  for ( uint64_t i = 0; i < acks; i++ ) {
+    ContestMessage message( prng(), string( 1424, 'x' ) );
+    message.header.send_timestamp = prng();
+    message.transform_into_ack( prng(), prng() );
+    payloads.push_back( message.to_string() );
+  }
+
+  const vector<HeaderBatch::Implementation> implementations
+    = { HeaderBatch::Implementation::Scalar, HeaderBatch::Implementation::SSSE3,
+	HeaderBatch::Implementation::AVX2 };
+
+  cout << setw( 8 ) << "burst" << setw( 18 ) << "message ns/ack";
+  for ( const auto implementation : implementations ) {
+    if ( CpuFeatures::supported( implementation ) ) {
+      cout << setw( 18 ) << CpuFeatures::name( implementation ) + " ns/ack";
+    }
+  }
+  cout << endl;
+
+  uint64_t checksum = 0;
+
+  for ( const size_t burst_size : { 1, 2, 4, 8, 16 } ) {
+    vector<Burst> bursts;
+    for ( uint64_t i = 0; i < acks; i++ ) {
+      if ( i % burst_size == 0 ) {
+	bursts.emplace_back();
+      }
+      bursts.back().push_back( { Address(), i, payloads[ i ] } );
+    }
+
+    cout << setw( 8 ) << burst_size << fixed << setprecision( 1 )
+	 << setw( 18 ) << best_of( [&] () { return run_messages( bursts, checksum ); } );
+    for ( const auto implementation : implementations ) {
+      if ( CpuFeatures::supported( implementation ) ) {
+	check( implementation, bursts.front() );
+	cout << setw( 18 ) << best_of( [&] () { return run_batch( implementation, bursts, checksum ); } );
+      }
+    }
+    cout << endl;
+  }
+
+  cerr << "(checksum " << checksum << ")" << endl;
+
+  return EXIT_SUCCESS;
+}
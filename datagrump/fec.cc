@@ -0,0 +1,443 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include <endian.h>
+
+#include "fec.hh"
+#include "gf256.hh"
+
+using namespace std;
+
+static uint8_t * bytes( string & str ) { return reinterpret_cast<uint8_t *>( &str[ 0 ] ); }
+
+/*************** FecHeader ******************/
+bool FecHeader::parse( const char * const payload, const size_t length, FecHeader & header )
+{
+  if ( length <= SIZE ) {
+    return false;
+  }
+
+  const uint8_t type = payload[ 0 ];
+  const uint8_t scheme = payload[ 1 ];
+  if ( (type != uint8_t( Type::Source ) and type != uint8_t( Type::Repair ))
+       or (scheme != uint8_t( Scheme::Xor ) and scheme != uint8_t( Scheme::ReedSolomon )) ) {
+    return false;
+  }
+
+  uint16_t count;
+  uint32_t repair_id;
+  uint64_t source_id;
+  memcpy( &count, payload + 2, sizeof( count ) );
+  memcpy( &repair_id, payload + 4, sizeof( repair_id ) );
+  memcpy( &source_id, payload + 8, sizeof( source_id ) );
+
+  header = { Type( type ), Scheme( scheme ), be16toh( count ), be32toh( repair_id ), be64toh( source_id ) };
+  return true;
+}
+
+void FecHeader::write( string & payload ) const
+{
+  if ( payload.size() < SIZE ) {
+    throw runtime_error( "FecHeader: payload too small" );
+  }
+
+  const uint16_t network_count = htobe16( count );
+  const uint32_t network_repair_id = htobe32( repair_id );
+  const uint64_t network_source_id = htobe64( source_id );
+
+  payload[ 0 ] = char( type );
+  payload[ 1 ] = char( scheme );
+  memcpy( &payload[ 2 ], &network_count, sizeof( network_count ) );
+  memcpy( &payload[ 4 ], &network_repair_id, sizeof( network_repair_id ) );
+  memcpy( &payload[ 8 ], &network_source_id, sizeof( network_source_id ) );
+}
+
+FecHeader::Scheme FecHeader::scheme_from_name( const string & name )
+{
+  if ( name == "xor" ) {
+    return Scheme::Xor;
+  } else if ( name == "rs" ) {
+    return Scheme::ReedSolomon;
+  }
+
+  throw runtime_error( "unknown FEC scheme " + name + " (xor or rs)" );
+}
+
+string FecHeader::name( const Scheme scheme )
+{
+  switch ( scheme ) {
+  case Scheme::Xor: return "xor";
+  case Scheme::ReedSolomon: return "rs";
+  }
+
+  return "unknown";
+}
+
+uint8_t fec_coefficient( const FecHeader::Scheme scheme, const uint32_t repair_id,
+			 const uint64_t source_id )
+{
+  if ( scheme == FecHeader::Scheme::Xor ) {
+    return 1;
+  }
+
+  return GF256::inv( (128 | (repair_id & 127)) ^ (source_id & 127) );
+}
+
+/*************** FecEncoder ******************/
+FecEncoder::FecEncoder( const FecHeader::Scheme scheme, const size_t payload_size )
+  : scheme_( scheme ),
+    symbol_size_( payload_size - FecHeader::SIZE ),
+    history_( MAX_WINDOW, string( payload_size - FecHeader::SIZE, 0 ) )
+{
+  if ( payload_size <= FecHeader::SIZE ) {
+    throw runtime_error( "FecEncoder: payload too small for FEC" );
+  }
+}
+
+unsigned int FecEncoder::repair_interval( void ) const
+{
+  const double ratio = 2 * loss_rate_ + 1.0 / MAX_INTERVAL;
+  return max<long>( MIN_INTERVAL, min<long>( MAX_INTERVAL, lround( 1 / ratio ) ) );
+}
+
+void FecEncoder::delivery_observed( const bool lost )
+{
+  static const double GAIN = 1.0 / 64;
+  loss_rate_ += GAIN * ((lost ? 1 : 0) - loss_rate_);
+}
+
+const string & FecEncoder::next_payload( const string & data )
+{
+  payload_.resize( FecHeader::SIZE + symbol_size_ );
+
+  if ( next_source_id_ - first_uncovered_ >= repair_interval() ) {
+    build_repair();
+    return payload_;
+  }
+
+  const uint64_t source_id = next_source_id_++;
+  FecHeader { FecHeader::Type::Source, scheme_, 0, 0, source_id }.write( payload_ );
+
+  string & symbol = history_[ source_id % MAX_WINDOW ];
+  const size_t copied = min( data.size(), symbol_size_ );
+  symbol.replace( 0, copied, data, 0, copied );
+  fill( symbol.begin() + copied, symbol.end(), 0 );
+  payload_.replace( FecHeader::SIZE, symbol_size_, symbol );
+
+  return payload_;
+}
+
+/* A repair over the sources since the last one (XOR), or over a window
+   reaching back twice the interval (Reed-Solomon), so bursts spanning
+   two repairs can still be rebuilt */
+void FecEncoder::build_repair( void )
+{
+  uint64_t count = next_source_id_ - first_uncovered_;
+  if ( scheme_ == FecHeader::Scheme::ReedSolomon ) {
+    count = max<uint64_t>( count, 2 * repair_interval() );
+  }
+  count = min<uint64_t>( { count, MAX_WINDOW, next_source_id_ } );
+
+  const uint64_t first = next_source_id_ - count;
+  const uint32_t repair_id = next_repair_id_++;
+  FecHeader { FecHeader::Type::Repair, scheme_, uint16_t( count ), repair_id, first }.write( payload_ );
+
+  uint8_t * const repair = bytes( payload_ ) + FecHeader::SIZE;
+  memset( repair, 0, symbol_size_ );
+  for ( uint64_t id = first; id < next_source_id_; id++ ) {
+    GF256::mul_add_region( repair, bytes( history_[ id % MAX_WINDOW ] ),
+			   fec_coefficient( scheme_, repair_id, id ), symbol_size_ );
+  }
+
+  first_uncovered_ = next_source_id_;
+}
+
+/*************** FecDecoder ******************/
+FecDecoder::FecDecoder()
+  : slots_( HISTORY, { uint64_t( -1 ), false, string() } )
+{
+  /* room for the largest burst to rebuild (HISTORY sources, as many
+     repairs), so it does not allocate after the first datagram, which
+     gives the symbols' size */
+  pending_.resize( HISTORY, { FecHeader::Scheme::Xor, 0, 0, {}, string() } );
+  for ( auto & repair : pending_ ) {
+    repair.missing.reserve( HISTORY );
+  }
+  unknowns_.reserve( HISTORY );
+  rows_.resize( HISTORY );
+  for ( auto & row : rows_ ) {
+    row.reserve( HISTORY );
+  }
+  residuals_.resize( HISTORY );
+  pivot_row_.reserve( HISTORY );
+}
+
+/* The symbols' size is known: make room for that many bytes wherever
+   one is kept */
+void FecDecoder::reserve_symbols( void )
+{
+  for ( auto & s : slots_ ) {
+    s.symbol.reserve( symbol_size_ );
+  }
+  for ( auto & repair : pending_ ) {
+    repair.residual.reserve( symbol_size_ );
+  }
+  for ( auto & residual : residuals_ ) {
+    residual.reserve( symbol_size_ );
+  }
+}
+
+bool FecDecoder::known( const uint64_t source_id ) const
+{
+  const Slot & s = slots_[ source_id % HISTORY ];
+  return source_id >= floor_ and s.source_id == source_id and s.known;
+}
+
+bool FecDecoder::source( const uint64_t source_id, string & symbol ) const
+{
+  if ( not known( source_id ) ) {
+    return false;
+  }
+  symbol = slots_[ source_id % HISTORY ].symbol;
+  return true;
+}
+
+/* Move the pending repairs that have settled behind the rest */
+template <typename Predicate>
+void FecDecoder::settle_if( const Predicate & settled )
+{
+  for ( size_t i = 0; i < pending_count_; ) {
+    if ( settled( pending_[ i ] ) ) {
+      swap( pending_[ i ], pending_[ --pending_count_ ] );
+    } else {
+      i++;
+    }
+  }
+}
+
+/* Track the HISTORY sources up to the newest one; give up on any
+   older ones still missing */
+void FecDecoder::advance_floor( const uint64_t newest )
+{
+  if ( newest + 1 < HISTORY or newest + 1 - HISTORY <= floor_ ) {
+    return;
+  }
+
+  const uint64_t new_floor = newest + 1 - HISTORY;
+  if ( new_floor > floor_ + HISTORY ) { /* a long gap: none of it can be known */
+    unrecoverable_ += new_floor - HISTORY - floor_;
+    floor_ = new_floor - HISTORY;
+  }
+  for ( ; floor_ < new_floor; floor_++ ) {
+    if ( not known( floor_ ) ) {
+      unrecoverable_++;
+    }
+  }
+
+  /* repairs reaching below the floor can no longer be used */
+  settle_if( [&] ( const PendingRepair & repair ) { return repair.first < floor_; } );
+}
+
+/* A source is known: keep it, and take it out of the repairs waiting on it */
+void FecDecoder::learn( const uint64_t source_id, const uint8_t * const symbol )
+{
+  Slot & s = slot( source_id );
+  s.source_id = source_id;
+  s.known = true;
+  s.symbol.assign( reinterpret_cast<const char *>( symbol ), symbol_size_ );
+
+  /* (from the copy, as `symbol` may be a pending repair's residual) */
+  for ( size_t i = 0; i < pending_count_; i++ ) {
+    PendingRepair & repair = pending_[ i ];
+    const auto it = find( repair.missing.begin(), repair.missing.end(), source_id );
+    if ( it != repair.missing.end() ) {
+      GF256::mul_add_region( bytes( repair.residual ), bytes( s.symbol ),
+			     fec_coefficient( repair.scheme, repair.repair_id, source_id ),
+			     symbol_size_ );
+      repair.missing.erase( it );
+    }
+  }
+}
+
+bool FecDecoder::receive( const char * const payload, const size_t length )
+{
+  FecHeader header;
+  if ( not FecHeader::parse( payload, length, header ) ) {
+    return false;
+  }
+
+  if ( symbol_size_ == 0 ) {
+    symbol_size_ = length - FecHeader::SIZE;
+    reserve_symbols();
+  } else if ( length - FecHeader::SIZE != symbol_size_ ) {
+    return true; /* not from the same stream */
+  }
+  const uint8_t * const symbol = reinterpret_cast<const uint8_t *>( payload ) + FecHeader::SIZE;
+
+  if ( not started_ ) {
+    floor_ = header.source_id;
+    started_ = true;
+  }
+
+  if ( header.type == FecHeader::Type::Source ) {
+    advance_floor( header.source_id );
+    received_++;
+    if ( header.source_id >= floor_ and not known( header.source_id ) ) {
+      learn( header.source_id, symbol );
+      solve();
+    }
+    return true;
+  }
+
+  repairs_++;
+  if ( header.count == 0 ) {
+    return true;
+  }
+  advance_floor( header.source_id + header.count - 1 );
+  if ( header.source_id < floor_ ) {
+    return true; /* too late to help */
+  }
+
+  /* a repair for sources that all arrived has nothing to add */
+  uint64_t id = header.source_id;
+  while ( id < header.source_id + header.count and known( id ) ) {
+    id++;
+  }
+  if ( id == header.source_id + header.count ) {
+    return true;
+  }
+
+  if ( pending_count_ == pending_.size() ) {
+    pending_.push_back( { FecHeader::Scheme::Xor, 0, 0, {}, string() } );
+  }
+  PendingRepair & repair = pending_[ pending_count_++ ];
+  repair.scheme = header.scheme;
+  repair.repair_id = header.repair_id;
+  repair.first = header.source_id;
+  repair.missing.clear();
+  repair.residual.assign( reinterpret_cast<const char *>( symbol ), symbol_size_ );
+  for ( id = header.source_id; id < header.source_id + header.count; id++ ) {
+    if ( known( id ) ) {
+      GF256::mul_add_region( bytes( repair.residual ), bytes( slot( id ).symbol ),
+			     fec_coefficient( repair.scheme, repair.repair_id, id ), symbol_size_ );
+    } else {
+      repair.missing.push_back( id );
+    }
+  }
+
+  solve();
+
+  return true;
+}
+
+/* Rebuild what the pending repairs allow */
+void FecDecoder::solve( void )
+{
+  while ( true ) {
+    settle_if( [] ( const PendingRepair & repair ) { return repair.missing.empty(); } );
+
+    /* a repair missing one source is that source, scaled */
+    const auto end = pending_.begin() + pending_count_;
+    const auto single = find_if( pending_.begin(), end,
+				 [] ( const PendingRepair & repair ) { return repair.missing.size() == 1; } );
+    if ( single != end ) {
+      const uint64_t source_id = single->missing.front();
+      GF256::mul_region( bytes( single->residual ),
+			 GF256::inv( fec_coefficient( single->scheme, single->repair_id, source_id ) ),
+			 symbol_size_ );
+      recovered_++;
+      learn( source_id, bytes( single->residual ) );
+      continue;
+    }
+
+    if ( not eliminate() ) {
+      return;
+    }
+  }
+}
+
+/* Solve the pending repairs together, if there are as many as the
+   sources they are missing; learns what it can and says if anything */
+bool FecDecoder::eliminate( void )
+{
+  const size_t rows = pending_count_;
+
+  unknowns_.clear();
+  for ( size_t i = 0; i < rows; i++ ) {
+    unknowns_.insert( unknowns_.end(), pending_[ i ].missing.begin(), pending_[ i ].missing.end() );
+  }
+  sort( unknowns_.begin(), unknowns_.end() );
+  unknowns_.erase( unique( unknowns_.begin(), unknowns_.end() ), unknowns_.end() );
+  const size_t columns = unknowns_.size();
+
+  if ( columns == 0 or rows < columns ) {
+    return false;
+  }
+
+  /* rows: one per repair, over the unknowns, with its residual */
+  if ( rows_.size() < rows ) {
+    rows_.resize( rows );
+    residuals_.resize( rows );
+  }
+  for ( size_t i = 0; i < rows; i++ ) {
+    const PendingRepair & repair = pending_[ i ];
+    rows_[ i ].assign( columns, 0 );
+    for ( const uint64_t id : repair.missing ) {
+      const size_t column = lower_bound( unknowns_.begin(), unknowns_.end(), id ) - unknowns_.begin();
+      rows_[ i ][ column ] = fec_coefficient( repair.scheme, repair.repair_id, id );
+    }
+    residuals_[ i ].assign( repair.residual );
+  }
+
+  /* Gauss-Jordan */
+  pivot_row_.assign( columns, rows );
+  size_t rank = 0;
+  for ( size_t column = 0; column < columns and rank < rows; column++ ) {
+    size_t r = rank;
+    while ( r < rows and rows_[ r ][ column ] == 0 ) {
+      r++;
+    }
+    if ( r == rows ) {
+      continue;
+    }
+    swap( rows_[ r ], rows_[ rank ] );
+    swap( residuals_[ r ], residuals_[ rank ] );
+
+    const uint8_t scale = GF256::inv( rows_[ rank ][ column ] );
+    for ( auto & entry : rows_[ rank ] ) {
+      entry = GF256::mul( entry, scale );
+    }
+    GF256::mul_region( bytes( residuals_[ rank ] ), scale, symbol_size_ );
+
+    for ( size_t other = 0; other < rows; other++ ) {
+      const uint8_t factor = rows_[ other ][ column ];
+      if ( other == rank or factor == 0 ) {
+	continue;
+      }
+      for ( size_t c = 0; c < columns; c++ ) {
+	rows_[ other ][ c ] ^= GF256::mul( factor, rows_[ rank ][ c ] );
+      }
+      GF256::mul_add_region( bytes( residuals_[ other ] ), bytes( residuals_[ rank ] ),
+			     factor, symbol_size_ );
+    }
+
+    pivot_row_[ column ] = rank++;
+  }
+
+  /* a pivot row with nothing else left is solved */
+  bool progress = false;
+  for ( size_t column = 0; column < columns; column++ ) {
+    const size_t r = pivot_row_[ column ];
+    if ( r == rows
+	 or count( rows_[ r ].begin(), rows_[ r ].end(), 0 ) != long( columns - 1 ) ) {
+      continue;
+    }
+    recovered_++;
+    learn( unknowns_[ column ], bytes( residuals_[ r ] ) );
+    progress = true;
+  }
+
+  return progress;
+}
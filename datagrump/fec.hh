@@ -0,0 +1,177 @@
+#ifndef FEC_HH
+#define FEC_HH
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Forward error correction for the datagram stream, so a receiver
+   can rebuild lost datagrams without waiting an RTT for them.
+
+   The sender's payloads become source symbols, and every so often it
+   sends a repair symbol instead: a combination of recent source
+   symbols over GF(256). Both kinds are ordinary datagrams to the
+   controller (repairs take a slot in the window), and the contest
+   header is unchanged; the FEC header starts the payload. */
+
+/* The first SIZE bytes of the payload of a datagram carrying FEC */
+struct FecHeader
+{
+  enum class Type : uint8_t { Source = 0xf1, Repair = 0xf2 };
+
+  /* XOR: each repair is the parity of the sources since the last one.
+     ReedSolomon: each repair covers a sliding window of the latest
+     sources with Cauchy coefficients, so any k losses within the
+     windows of k repairs can be rebuilt. */
+  enum class Scheme : uint8_t { Xor = 1, ReedSolomon = 2 };
+
+  static const size_t SIZE = 16;
+
+  Type type;
+  Scheme scheme;
+  uint16_t count;         /* repair: how many sources it covers */
+  uint32_t repair_id;     /* repair: picks its coefficients */
+  uint64_t source_id;     /* source: its own; repair: the first it covers */
+
+  /* Parse from a payload; false if it does not carry FEC */
+  static bool parse( const char * const payload, const size_t length, FecHeader & header );
+  static bool parse( const std::string & payload, FecHeader & header )
+  {
+    return parse( payload.data(), payload.size(), header );
+  }
+
+  /* Write over the first SIZE bytes of a payload */
+  void write( std::string & payload ) const;
+
+  static Scheme scheme_from_name( const std::string & name );
+  static std::string name( const Scheme scheme );
+};
+
+/* The coefficient of a source in a repair: 1 for XOR, else the Cauchy
+   entry 1 / (x + y) with x = 128 + (repair_id mod 128) and
+   y = source_id mod 128, so the sources in a window (at most 128) and
+   the repairs pending at a receiver each have distinct x and y. */
+uint8_t fec_coefficient( const FecHeader::Scheme scheme, const uint32_t repair_id,
+			 const uint64_t source_id );
+
+/* Builds the sender's payloads, with a repair after every
+   repair_interval() sources. The interval follows the loss rate the
+   sender observes (an EWMA over acks and losses): twice the loss
+   rate, plus a floor, is sent as repairs. */
+class FecEncoder
+{
+public:
+  static const unsigned int MIN_INTERVAL = 2;    /* at most 1 repair per 2 sources */
+  static const unsigned int MAX_INTERVAL = 32;   /* at least 1 per 32 */
+  static const unsigned int MAX_WINDOW = 64;     /* sources per Reed-Solomon repair */
+
+private:
+  FecHeader::Scheme scheme_;
+  size_t symbol_size_;
+
+  /* the latest MAX_WINDOW source symbols, by id modulo MAX_WINDOW */
+  std::vector<std::string> history_;
+  uint64_t next_source_id_ {0};
+  uint64_t first_uncovered_ {0};     /* the oldest source since the last repair */
+  uint32_t next_repair_id_ {0};
+
+  double loss_rate_ {0};
+  std::string payload_ {};           /* the last one built, reused */
+
+  void build_repair( void );
+
+public:
+  FecEncoder( const FecHeader::Scheme scheme, const size_t payload_size );
+
+  /* The payload of the next datagram: a repair if one is due, else a
+     source carrying the start of data (padded or cut to fit) */
+  const std::string & next_payload( const std::string & data );
+
+  /* Was the last payload a repair? */
+  bool last_was_repair( void ) const
+  {
+    return not payload_.empty() and payload_[ 0 ] == char( FecHeader::Type::Repair );
+  }
+
+  /* A datagram was acked, or declared lost */
+  void delivery_observed( const bool lost );
+
+  double loss_rate( void ) const { return loss_rate_; }
+  unsigned int repair_interval( void ) const;
+  size_t symbol_size( void ) const { return symbol_size_; }
+};
+
+/* Rebuilds lost sources at the receiver. Each repair is kept, less the
+   sources it covers that are already known, until every source in it
+   is known: one with a single source missing yields it (and that may
+   free others); when enough repairs are stuck on the same missing
+   sources, Gaussian elimination solves them together. A source not
+   known by the time HISTORY later sources have arrived is given up.
+   Settled repairs and the elimination's matrices keep their storage
+   for the next ones, so once warmed up nothing allocates. */
+class FecDecoder
+{
+public:
+  static const unsigned int HISTORY = 128;
+
+private:
+  struct Slot {
+    uint64_t source_id;
+    bool known;
+    std::string symbol;
+  };
+
+  struct PendingRepair {
+    FecHeader::Scheme scheme;
+    uint32_t repair_id;
+    uint64_t first;                    /* first source covered */
+    std::vector<uint64_t> missing;     /* sources not yet known */
+    std::string residual;              /* repair less the known sources */
+  };
+
+  std::vector<Slot> slots_;
+
+  /* the first pending_count_ are waiting; the rest are settled, kept
+     for their storage */
+  std::vector<PendingRepair> pending_ {};
+  size_t pending_count_ {0};
+  size_t symbol_size_ {0};
+
+  /* eliminate()'s working space */
+  std::vector<uint64_t> unknowns_ {};
+  std::vector<std::vector<uint8_t>> rows_ {};
+  std::vector<std::string> residuals_ {};
+  std::vector<size_t> pivot_row_ {};
+
+  bool started_ {false};
+  uint64_t floor_ {0};                 /* oldest source still tracked */
+  uint64_t received_ {0}, recovered_ {0}, unrecoverable_ {0}, repairs_ {0};
+
+  Slot & slot( const uint64_t source_id ) { return slots_[ source_id % HISTORY ]; }
+  bool known( const uint64_t source_id ) const;
+  void reserve_symbols( void );
+  void advance_floor( const uint64_t newest );
+  void learn( const uint64_t source_id, const uint8_t * const symbol );
+  template <typename Predicate> void settle_if( const Predicate & settled );
+  void solve( void );
+  bool eliminate( void );
+
+public:
+  FecDecoder();
+
+  /* A datagram's payload arrived; false if it does not carry FEC.
+     Nothing allocates after the first one, unless more than HISTORY
+     repairs are pending at once. */
+  bool receive( const char * const payload, const size_t length );
+  bool receive( const std::string & payload ) { return receive( payload.data(), payload.size() ); }
+
+  /* A source's symbol, if it arrived or was rebuilt (and is recent) */
+  bool source( const uint64_t source_id, std::string & symbol ) const;
+
+  uint64_t received( void ) const { return received_; }           /* sources */
+  uint64_t repairs_received( void ) const { return repairs_; }
+  uint64_t recovered( void ) const { return recovered_; }
+  uint64_t unrecoverable( void ) const { return unrecoverable_; }
+};
+
+#endif /* FEC_HH */
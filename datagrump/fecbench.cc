@@ -0,0 +1,208 @@
+/* microbenchmark: GF(256) region kernels and FEC encoding against line
+   rate, and a check that decoding rebuilds what was lost */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "fec.hh"
+#include "gf256.hh"
+
+using namespace std;
+
+/* the contest's payload: 1424 bytes, FEC header included */
+static const size_t PAYLOAD_SIZE = 1424;
+
+/* timings are the best of this many runs */
+static const unsigned int ROUNDS = 5;
+
+template <typename Run>
+static double best_of( const Run & run )
+{
+  double best = run();
+  for ( unsigned int i = 1; i < ROUNDS; i++ ) {
+    best = min( best, run() );
+  }
+  return best;
+}
+
+static string random_bytes( mt19937 & prng, const size_t length )
+{
+  string ret( length, 0 );
+  for ( auto & c : ret ) {
+    c = prng();
+  }
+  return ret;
+}
+
+/* GB/s of dst ^= c * src over one symbol at a time */
+static double run_region( const GF256::Implementation implementation,
+			  vector<string> & symbols, uint64_t & checksum )
+{
+  const size_t length = symbols.front().size();
+  const auto start = chrono::steady_clock::now();
+  for ( size_t i = 1; i < symbols.size(); i++ ) {
+    GF256::mul_add_region( implementation, reinterpret_cast<uint8_t *>( &symbols[ i ][ 0 ] ),
+			   reinterpret_cast<const uint8_t *>( symbols[ i - 1 ].data() ),
+			   uint8_t( i | 1 ), length );
+  }
+  const auto end = chrono::steady_clock::now();
+  checksum += uint8_t( symbols.back()[ 0 ] );
+
+  return length * (symbols.size() - 1) / chrono::duration<double, nano>( end - start ).count();
+}
+
+/* every kernel must agree with GF256::mul byte for byte */
+static void check( const GF256::Implementation implementation, mt19937 & prng )
+{
+  const string src = random_bytes( prng, 1000 + 37 );
+  for ( unsigned int c = 0; c < 256; c++ ) {
+    string dst = random_bytes( prng, src.size() );
+    string expected = dst;
+    for ( size_t i = 0; i < src.size(); i++ ) {
+      expected[ i ] ^= GF256::mul( c, src[ i ] );
+    }
+    GF256::mul_add_region( implementation, reinterpret_cast<uint8_t *>( &dst[ 0 ] ),
+			   reinterpret_cast<const uint8_t *>( src.data() ), c, src.size() );
+    if ( dst != expected ) {
+      throw runtime_error( CpuFeatures::name( implementation ) + " kernel disagrees for c = "
+			   + to_string( c ) );
+    }
+  }
+}
+
+/* an encoder that has seen this loss rate, spread evenly */
+static void observe_loss_rate( FecEncoder & encoder, const double loss_rate )
+{
+  for ( unsigned int i = 0; i < 1000; i++ ) {
+    encoder.delivery_observed( unsigned( (i + 1) * loss_rate ) > unsigned( i * loss_rate ) );
+  }
+}
+
+/* Gbit/s of source payload the encoder can take at a given loss rate */
+static double run_encoder( const FecHeader::Scheme scheme, const double loss_rate,
+			   const vector<string> & data, uint64_t & checksum )
+{
+  FecEncoder encoder( scheme, PAYLOAD_SIZE );
+  observe_loss_rate( encoder, loss_rate );
+
+  const auto start = chrono::steady_clock::now();
+  for ( const auto & datum : data ) {
+    checksum += uint8_t( encoder.next_payload( datum )[ FecHeader::SIZE ] );
+  }
+  const auto end = chrono::steady_clock::now();
+
+  return data.size() * encoder.symbol_size() * 8 / chrono::duration<double, nano>( end - start ).count();
+}
+
+/* Send a stream through random losses (and a burst); count what the
+   receiver rebuilds, and check it is right */
+static void run_decoder( const FecHeader::Scheme scheme, const double loss_rate,
+			 const vector<string> & data )
+{
+  mt19937 prng( 344 );
+  bernoulli_distribution lost( loss_rate );
+
+  FecEncoder encoder( scheme, PAYLOAD_SIZE );
+  FecDecoder decoder;
+  uint64_t sources = 0, dropped = 0, wrong = 0;
+
+  for ( size_t i = 0; sources < data.size(); i++ ) {
+    const string & payload = encoder.next_payload( data[ sources ] );
+    const bool repair = encoder.last_was_repair();
+    const bool drop = lost( prng ) or (i >= 5000 and i < 5004); /* one 4-datagram burst */
+
+    encoder.delivery_observed( drop );
+    if ( not repair ) {
+      sources++;
+      dropped += drop;
+    }
+    if ( not drop ) {
+      decoder.receive( payload );
+    }
+  }
+
+  /* every source the decoder knows must match what was sent */
+  for ( uint64_t id = 0; id < sources; id++ ) {
+    string symbol;
+    if ( decoder.source( id, symbol ) and symbol != data[ id ].substr( 0, symbol.size() ) ) {
+      wrong++;
+    }
+  }
+  if ( wrong ) {
+    throw runtime_error( FecHeader::name( scheme ) + " decoder rebuilt " + to_string( wrong )
+			 + " sources wrongly" );
+  }
+
+  cout << setw( 8 ) << FecHeader::name( scheme ) << setw( 8 ) << 100 * loss_rate << "%"
+       << setw( 12 ) << dropped << setw( 12 ) << decoder.repairs_received()
+       << setw( 12 ) << decoder.recovered()
+       << setw( 11 ) << 100.0 * decoder.recovered() / max<uint64_t>( dropped, 1 ) << "%" << endl;
+}
+
+int main( int argc, char *argv[] )
+{
+  /* check the command-line arguments */
+  if ( argc < 1 ) { /* for sticklers */
+    abort();
+  }
+
+  if ( argc > 2 ) {
+    cerr << "Usage: " << argv[ 0 ] << " [SYMBOLS]" << endl;
+    return EXIT_FAILURE;
+  }
+
+  const size_t count = argc == 2 ? strtoull( argv[ 1 ], nullptr, 10 ) : 20000;
+
+  mt19937 prng( 6829 );
+  vector<string> data;
+  for ( size_t i = 0; i < count; i++ ) {
+    data.push_back( random_bytes( prng, PAYLOAD_SIZE - FecHeader::SIZE ) );
+  }
+
+  uint64_t checksum = 0;
+
+  cout << "GF(256) multiply-add over " << PAYLOAD_SIZE - FecHeader::SIZE << "-byte symbols:" << endl;
+  for ( const auto implementation : { GF256::Implementation::Scalar, GF256::Implementation::SSSE3,
+				      GF256::Implementation::AVX2 } ) {
+    if ( not CpuFeatures::supported( implementation ) ) {
+      continue;
+    }
+    check( implementation, prng );
+    vector<string> symbols = data;
+    cout << setw( 8 ) << CpuFeatures::name( implementation ) << fixed << setprecision( 2 )
+	 << setw( 10 ) << best_of( [&] () { return run_region( implementation, symbols, checksum ); } )
+	 << " GB/s" << endl;
+  }
+
+  cout << endl << "Encoding (" << CpuFeatures::name( CpuFeatures::best_implementation() ) << "), Gbit/s of source data:" << endl
+       << setw( 8 ) << "scheme" << setw( 9 ) << "loss" << setw( 12 ) << "interval" << setw( 12 ) << "Gbit/s" << endl;
+  for ( const auto scheme : { FecHeader::Scheme::Xor, FecHeader::Scheme::ReedSolomon } ) {
+    for ( const double loss_rate : { 0.0, 0.05, 0.2 } ) {
+      FecEncoder encoder( scheme, PAYLOAD_SIZE );
+      observe_loss_rate( encoder, loss_rate );
+      cout << setw( 8 ) << FecHeader::name( scheme ) << setprecision( 0 ) << setw( 8 ) << 100 * loss_rate << "%"
+	   << setw( 12 ) << encoder.repair_interval() << setprecision( 2 )
+	   << setw( 12 ) << best_of( [&] () { return run_encoder( scheme, loss_rate, data, checksum ); } )
+	   << endl;
+    }
+  }
+
+  cout << endl << "Decoding, with one 4-datagram burst:" << endl
+       << setw( 8 ) << "scheme" << setw( 9 ) << "loss" << setw( 12 ) << "lost" << setw( 12 ) << "repairs"
+       << setw( 12 ) << "rebuilt" << setw( 12 ) << "rebuilt" << endl << setprecision( 1 );
+  for ( const auto scheme : { FecHeader::Scheme::Xor, FecHeader::Scheme::ReedSolomon } ) {
+    for ( const double loss_rate : { 0.01, 0.05, 0.2 } ) {
+      run_decoder( scheme, loss_rate, data );
+    }
+  }
+
+  cerr << "(checksum " << checksum << ")" << endl;
+
+  return EXIT_SUCCESS;
+}
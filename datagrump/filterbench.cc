@@ -0,0 +1,99 @@
+/* microbenchmark: per-ack cost of windowed min filters vs. window length */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "windowed_filter.hh"
+
+using namespace std;
+
+/* the original approach: keep every sample, scan for the minimum */
+class LinearScanMin
+{
+private:
+  deque<pair<uint64_t, uint64_t>> samples_ {};
+  uint64_t window_;
+
+public:
+  LinearScanMin( const uint64_t window ) : window_( window ) {}
+
+  void update( const uint64_t tick, const uint64_t value )
+  {
+    samples_.emplace_back( tick, value );
+    if ( tick < window_ ) {
+      return;
+    }
+    while ( samples_.front().first < tick - window_ ) {
+      samples_.pop_front();
+    }
+  }
+
+  uint64_t best( void ) const
+  {
+    return min_element( samples_.begin(), samples_.end(),
+			[] ( const pair<uint64_t, uint64_t> & left,
+			     const pair<uint64_t, uint64_t> & right ) {
+			  return left.second < right.second; } )->second;
+  }
+};
+
+/* feed one sample per tick, query after each, return ns per ack */
+template <typename Filter>
+double run( const uint64_t window, const vector<uint64_t> & rtts, uint64_t & checksum )
+{
+  Filter filter( window );
+
+  const auto start = chrono::steady_clock::now();
+  for ( uint64_t tick = 0; tick < rtts.size(); tick++ ) {
+    filter.update( tick, rtts[ tick ] );
+    checksum += filter.best();
+  }
+  const auto end = chrono::steady_clock::now();
+
+  return chrono::duration<double, nano>( end - start ).count() / rtts.size();
+}
+
+int main( int argc, char *argv[] )
+{
+  /* check the command-line arguments */
+  if ( argc < 1 ) { /* for sticklers */
+    abort();
+  }
+
+  if ( argc > 2 ) {
+    cerr << "Usage: " << argv[ 0 ] << " [ACKS]" << endl;
+    return EXIT_FAILURE;
+  }
+
+  const uint64_t acks = argc == 2 ? strtoull( argv[ 1 ], nullptr, 10 ) : 200000;
+
+  /* RTT samples: slowly drifting base delay plus queueing noise */
+  mt19937 prng( 6829 );
+  uniform_int_distribution<uint64_t> noise( 0, 40 );
+  vector<uint64_t> rtts;
+  for ( uint64_t i = 0; i < acks; i++ ) {
+    rtts.push_back( 40 + (i / 5000) % 20 + noise( prng ) );
+  }
+
+  uint64_t checksum = 0;
+
+  cout << setw( 10 ) << "window" << setw( 16 ) << "linear ns/ack"
+       << setw( 16 ) << "deque ns/ack" << setw( 16 ) << "nichols ns/ack" << endl;
+
+  for ( const uint64_t window : { 10, 100, 1000, 10000, 100000 } ) {
+    cout << setw( 10 ) << window << fixed << setprecision( 1 )
+	 << setw( 16 ) << run<LinearScanMin>( window, rtts, checksum )
+	 << setw( 16 ) << run<WindowedMinFilter<uint64_t>>( window, rtts, checksum )
+	 << setw( 16 ) << run<NicholsMinFilter<uint64_t>>( window, rtts, checksum ) << endl;
+  }
+
+  cerr << "(checksum " << checksum << ")" << endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,197 @@
+#include <stdexcept>
+
+#include "gf256.hh"
+
+#ifdef CPU_FEATURES_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+typedef GF256::Implementation Implementation;
+
+/* log and antilog tables of the generator 2 */
+struct Tables
+{
+  uint8_t exp[ 512 ];   /* doubled, so exp[ log a + log b ] needs no modulo */
+  uint8_t log[ 256 ];
+
+  Tables() : exp(), log()
+  {
+    unsigned int x = 1;
+    for ( unsigned int i = 0; i < 255; i++ ) {
+      exp[ i ] = exp[ i + 255 ] = x;
+      log[ x ] = i;
+      x <<= 1;
+      if ( x & 0x100 ) {
+	x ^= 0x11d;
+      }
+    }
+  }
+};
+
+static const Tables & tables( void )
+{
+  static const Tables t;
+  return t;
+}
+
+uint8_t GF256::mul( const uint8_t a, const uint8_t b )
+{
+  if ( a == 0 or b == 0 ) {
+    return 0;
+  }
+  const Tables & t = tables();
+  return t.exp[ t.log[ a ] + t.log[ b ] ];
+}
+
+uint8_t GF256::inv( const uint8_t a )
+{
+  if ( a == 0 ) {
+    throw runtime_error( "GF256: 0 has no inverse" );
+  }
+  const Tables & t = tables();
+  return t.exp[ 255 - t.log[ a ] ];
+}
+
+/* c times each low nibble, and c times each high nibble */
+struct NibbleTables
+{
+  uint8_t low[ 16 ];
+  uint8_t high[ 16 ];
+};
+
+/* for every c (8 KB), so a region costs no table setup */
+static const NibbleTables & nibble_tables( const uint8_t c )
+{
+  struct AllTables
+  {
+    NibbleTables by_constant[ 256 ];
+
+    AllTables() : by_constant()
+    {
+      for ( unsigned int c = 0; c < 256; c++ ) {
+	for ( unsigned int x = 0; x < 16; x++ ) {
+	  by_constant[ c ].low[ x ] = GF256::mul( c, x );
+	  by_constant[ c ].high[ x ] = GF256::mul( c, x << 4 );
+	}
+      }
+    }
+  };
+
+  static const AllTables all;
+  return all.by_constant[ c ];
+}
+
+/* Each kernel sets dst[ i ] = c * src[ i ] (or XORs it in, if
+   accumulate) for first <= i < length */
+
+static void region_scalar( uint8_t * const dst, const uint8_t * const src, const size_t first,
+			   const size_t length, const NibbleTables & c, const bool accumulate )
+{
+  for ( size_t i = first; i < length; i++ ) {
+    const uint8_t product = c.low[ src[ i ] & 0x0f ] ^ c.high[ src[ i ] >> 4 ];
+    dst[ i ] = accumulate ? dst[ i ] ^ product : product;
+  }
+}
+
+#ifdef CPU_FEATURES_X86
+
+__attribute__(( target( "ssse3" ) ))
+static void region_ssse3( uint8_t * const dst, const uint8_t * const src, const size_t length,
+			  const NibbleTables & c, const bool accumulate )
+{
+  const __m128i low = _mm_loadu_si128( reinterpret_cast<const __m128i *>( c.low ) );
+  const __m128i high = _mm_loadu_si128( reinterpret_cast<const __m128i *>( c.high ) );
+  const __m128i mask = _mm_set1_epi8( 0x0f );
+
+  size_t i = 0;
+  for ( ; i + 16 <= length; i += 16 ) {
+    const __m128i s = _mm_loadu_si128( reinterpret_cast<const __m128i *>( src + i ) );
+    __m128i product = _mm_xor_si128(
+      _mm_shuffle_epi8( low, _mm_and_si128( s, mask ) ),
+      _mm_shuffle_epi8( high, _mm_and_si128( _mm_srli_epi64( s, 4 ), mask ) ) );
+    if ( accumulate ) {
+      product = _mm_xor_si128( product, _mm_loadu_si128( reinterpret_cast<const __m128i *>( dst + i ) ) );
+    }
+    _mm_storeu_si128( reinterpret_cast<__m128i *>( dst + i ), product );
+  }
+
+  region_scalar( dst, src, i, length, c, accumulate );
+}
+
+__attribute__(( target( "avx2" ) ))
+static void region_avx2( uint8_t * const dst, const uint8_t * const src, const size_t length,
+			 const NibbleTables & c, const bool accumulate )
+{
+  /* pshufb looks up within each 128-bit lane, so both lanes get the tables */
+  const __m256i low = _mm256_broadcastsi128_si256(
+    _mm_loadu_si128( reinterpret_cast<const __m128i *>( c.low ) ) );
+  const __m256i high = _mm256_broadcastsi128_si256(
+    _mm_loadu_si128( reinterpret_cast<const __m128i *>( c.high ) ) );
+  const __m256i mask = _mm256_set1_epi8( 0x0f );
+
+  size_t i = 0;
+  for ( ; i + 32 <= length; i += 32 ) {
+    const __m256i s = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( src + i ) );
+    __m256i product = _mm256_xor_si256(
+      _mm256_shuffle_epi8( low, _mm256_and_si256( s, mask ) ),
+      _mm256_shuffle_epi8( high, _mm256_and_si256( _mm256_srli_epi64( s, 4 ), mask ) ) );
+    if ( accumulate ) {
+      product = _mm256_xor_si256( product, _mm256_loadu_si256( reinterpret_cast<const __m256i *>( dst + i ) ) );
+    }
+    _mm256_storeu_si256( reinterpret_cast<__m256i *>( dst + i ), product );
+  }
+
+  region_scalar( dst, src, i, length, c, accumulate );
+}
+
+#endif /* CPU_FEATURES_X86 */
+
+static void region( const Implementation implementation, uint8_t * const dst,
+		    const uint8_t * const src, const uint8_t c, const size_t length,
+		    const bool accumulate )
+{
+  const NibbleTables & tables = nibble_tables( c );
+
+  switch ( implementation ) {
+#ifdef CPU_FEATURES_X86
+  case Implementation::AVX2:
+    region_avx2( dst, src, length, tables, accumulate );
+    break;
+  case Implementation::SSSE3:
+    region_ssse3( dst, src, length, tables, accumulate );
+    break;
+#endif
+  default:
+    region_scalar( dst, src, 0, length, tables, accumulate );
+    break;
+  }
+}
+
+void GF256::mul_add_region( const Implementation implementation, uint8_t * const dst,
+			    const uint8_t * const src, const uint8_t c, const size_t length )
+{
+  if ( not CpuFeatures::supported( implementation ) ) {
+    throw runtime_error( "GF256: " + CpuFeatures::name( implementation ) + " not supported on this CPU" );
+  }
+
+  if ( c != 0 ) {
+    region( implementation, dst, src, c, length, true );
+  }
+}
+
+void GF256::mul_add_region( uint8_t * const dst, const uint8_t * const src,
+			    const uint8_t c, const size_t length )
+{
+  if ( c != 0 ) {
+    region( CpuFeatures::best_implementation(), dst, src, c, length, true );
+  }
+}
+
+void GF256::mul_region( uint8_t * const dst, const uint8_t c, const size_t length )
+{
+  if ( c != 1 ) {
+    region( CpuFeatures::best_implementation(), dst, dst, c, length, false );
+  }
+}
@@ -0,0 +1,36 @@
+#ifndef GF256_HH
+#define GF256_HH
+
+#include <cstddef>
+#include <cstdint>
+
+#include "cpu_features.hh"
+
+/* Arithmetic in GF(2^8) with the polynomial x^8 + x^4 + x^3 + x^2 + 1
+   (0x11d, as in most Reed-Solomon codes), and the operation erasure
+   codes spend their time in: multiplying a region of bytes by a
+   constant and adding (XOR-ing) it into another. The region kernels
+   split each byte into nibbles and look both up in 16-entry product
+   tables, 16 (SSSE3) or 32 (AVX2) bytes per pshufb; the scalar kernel
+   does the same one byte at a time. */
+namespace GF256 {
+  typedef CpuFeatures::Implementation Implementation;
+
+  uint8_t mul( const uint8_t a, const uint8_t b );
+
+  /* the multiplicative inverse of a (which must not be 0) */
+  uint8_t inv( const uint8_t a );
+
+  /* dst[ i ] ^= c * src[ i ] for i < length */
+  void mul_add_region( uint8_t * const dst, const uint8_t * const src,
+		       const uint8_t c, const size_t length );
+
+  /* dst[ i ] = c * dst[ i ] for i < length */
+  void mul_region( uint8_t * const dst, const uint8_t c, const size_t length );
+
+  /* the same, with a given kernel (for benchmarks and checks) */
+  void mul_add_region( const Implementation implementation, uint8_t * const dst,
+		       const uint8_t * const src, const uint8_t c, const size_t length );
+}
+
+#endif /* GF256_HH */
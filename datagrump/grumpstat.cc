@@ -0,0 +1,161 @@
+/* watch the live metrics of a running sender or receiver */
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include "file_descriptor.hh"
+#include "metrics.hh"
+#include "mmap_region.hh"
+#include "util.hh"
+
+using namespace std;
+using namespace MetricsLayout;
+
+/* totals of one metric, summed over its shards */
+struct MetricSnapshot
+{
+  uint64_t value;
+  vector<uint64_t> buckets;
+
+  MetricSnapshot() : value( 0 ), buckets( BUCKETS, 0 ) {}
+};
+
+static MetricSnapshot take_snapshot( const Slot & slot )
+{
+  MetricSnapshot ret;
+
+  if ( slot.kind == Kind::Gauge ) {
+    ret.value = slot.shards[ 0 ].value.load( memory_order_relaxed );
+    return ret;
+  }
+
+  for ( unsigned int i = 0; i < SHARDS; i++ ) {
+    ret.value += slot.shards[ i ].value.load( memory_order_relaxed );
+    if ( slot.kind == Kind::Histogram ) {
+      for ( unsigned int j = 0; j < BUCKETS; j++ ) {
+	ret.buckets[ j ] += slot.shards[ i ].buckets[ j ].load( memory_order_relaxed );
+      }
+    }
+  }
+
+  return ret;
+}
+
+/* largest value in the bucket holding the given quantile */
+static uint64_t quantile( const vector<uint64_t> & buckets, const uint64_t count,
+			  const double q )
+{
+  const uint64_t rank = q * count;
+  uint64_t seen = 0;
+  for ( unsigned int i = 0; i < BUCKETS; i++ ) {
+    seen += buckets[ i ];
+    if ( seen > rank ) {
+      return i + 1 < BUCKETS ? bucket_floor( i + 1 ) - 1 : bucket_floor( i );
+    }
+  }
+  return 0;
+}
+
+static void print_metric( const Slot & slot, const MetricSnapshot & now,
+			  const MetricSnapshot & before, const double seconds )
+{
+  cout << "  " << left << setw( 24 ) << slot.name << right;
+
+  switch ( slot.kind ) {
+  case Kind::Counter:
+    cout << setw( 12 ) << now.value
+	 << setw( 12 ) << fixed << setprecision( 1 ) << (now.value - before.value) / seconds << "/s";
+    break;
+  case Kind::Gauge: {
+    double value;
+    memcpy( &value, &now.value, sizeof( value ) );
+    cout << setw( 12 ) << fixed << setprecision( 2 ) << value;
+    break;
+  }
+  case Kind::Histogram: {
+    vector<uint64_t> delta( BUCKETS );
+    uint64_t count = 0;
+    for ( unsigned int i = 0; i < BUCKETS; i++ ) {
+      delta[ i ] = now.buckets[ i ] - before.buckets[ i ];
+      count += delta[ i ];
+    }
+    cout << "  n=" << count;
+    if ( count ) {
+      cout << " mean=" << fixed << setprecision( 1 ) << double( now.value - before.value ) / count
+	   << " p50=" << quantile( delta, count, 0.50 )
+	   << " p95=" << quantile( delta, count, 0.95 )
+	   << " p99=" << quantile( delta, count, 0.99 );
+    }
+    break;
+  }
+  default:
+    break;
+  }
+
+  cout << "\n";
+}
+
+int main( int argc, char *argv[] )
+{
+  /* check the command-line arguments */
+  if ( argc < 1 ) { /* for sticklers */
+    abort();
+  }
+
+  if ( argc > 3 ) {
+    cerr << "Usage: " << argv[ 0 ] << " [SEGMENT] [INTERVAL_MS]" << endl
+	 << "  (SEGMENT is /datagrump-sender or /datagrump-receiver)" << endl;
+    return EXIT_FAILURE;
+  }
+
+  const string segment_name = argc >= 2 ? argv[ 1 ] : "/datagrump-sender";
+  const unsigned int interval_ms = argc >= 3 ? atoi( argv[ 2 ] ) : 1000;
+
+  try {
+    FileDescriptor shm_fd( SystemCall( "shm_open",
+				       shm_open( segment_name.c_str(), O_RDONLY, 0 ) ) );
+    MMapRegion region( sizeof( Segment ), PROT_READ, MAP_SHARED, shm_fd.fd_num() );
+    const Segment & segment = *reinterpret_cast<const Segment *>( region.addr() );
+
+    vector<MetricSnapshot> before( MAX_METRICS );
+    auto last_poll = chrono::steady_clock::now();
+
+    while ( true ) {
+      this_thread::sleep_for( chrono::milliseconds( interval_ms ) );
+
+      if ( segment.magic.load( memory_order_acquire ) != MAGIC ) {
+	cout << "(waiting for " << segment_name << ")" << endl;
+	continue;
+      }
+
+      const auto now = chrono::steady_clock::now();
+      const double seconds = chrono::duration<double>( now - last_poll ).count();
+      last_poll = now;
+
+      cout << segment_name << "\n";
+      for ( unsigned int i = 0; i < segment.num_metrics and i < MAX_METRICS; i++ ) {
+	const MetricSnapshot snapshot = take_snapshot( segment.slots[ i ] );
+	if ( segment.slots[ i ].kind != Kind::Gauge
+	     and snapshot.value < before[ i ].value ) { /* writer restarted */
+	  before[ i ] = MetricSnapshot();
+	}
+	print_metric( segment.slots[ i ], snapshot, before[ i ], seconds );
+	before[ i ] = snapshot;
+      }
+      cout << endl;
+    }
+  } catch ( const exception & e ) {
+    print_exception( e );
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <endian.h>
+
+#include "header_batch.hh"
+
+#ifdef CPU_FEATURES_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+typedef HeaderBatch::Implementation Implementation;
+
+/* Each kernel reads HEADER_SIZE bytes at headers[ i ] and writes field f
+   of datagram i to fields[ f ][ i ], for first <= i < count */
+
+static void decode_scalar( const char * const * headers, const size_t first,
+			   const size_t count, uint64_t * const * fields )
+{
+  for ( size_t i = first; i < count; i++ ) {
+    for ( size_t f = 0; f < HeaderBatch::FIELDS; f++ ) {
+      uint64_t network_order;
+      memcpy( &network_order, headers[ i ] + f * sizeof( uint64_t ), sizeof( network_order ) );
+      fields[ f ][ i ] = be64toh( network_order );
+    }
+  }
+}
+
+#ifdef CPU_FEATURES_X86
+
+/* Two datagrams at a time: each 16-byte load holds two fields of one
+   datagram; byte-swap both, then pair them up with the same fields of
+   the other datagram */
+__attribute__(( target( "ssse3" ) ))
+static void decode_ssse3( const char * const * headers, const size_t first,
+			  const size_t count, uint64_t * const * fields )
+{
+  const __m128i swap = _mm_set_epi8( 8, 9, 10, 11, 12, 13, 14, 15,
+				     0, 1, 2, 3, 4, 5, 6, 7 );
+
+  size_t i = first;
+  for ( ; i + 2 <= count; i += 2 ) {
+    const __m128i * const a = reinterpret_cast<const __m128i *>( headers[ i ] );
+    const __m128i * const b = reinterpret_cast<const __m128i *>( headers[ i + 1 ] );
+
+    for ( size_t pair = 0; pair < HeaderBatch::FIELDS / 2; pair++ ) {
+      const __m128i a_fields = _mm_shuffle_epi8( _mm_loadu_si128( a + pair ), swap );
+      const __m128i b_fields = _mm_shuffle_epi8( _mm_loadu_si128( b + pair ), swap );
+
+      _mm_storeu_si128( reinterpret_cast<__m128i *>( fields[ 2 * pair ] + i ),
+			_mm_unpacklo_epi64( a_fields, b_fields ) );
+      _mm_storeu_si128( reinterpret_cast<__m128i *>( fields[ 2 * pair + 1 ] + i ),
+			_mm_unpackhi_epi64( a_fields, b_fields ) );
+    }
+  }
+
+  decode_scalar( headers, i, count, fields );
+}
+
+/* Four datagrams at a time: fields 0-3 of each in one 32-byte load,
+   byte-swapped and transposed 4x4; fields 4-5 of two datagrams per
+   32 bytes, transposed 4x2 */
+__attribute__(( target( "avx2" ) ))
+static void decode_avx2( const char * const * headers, const size_t first,
+			 const size_t count, uint64_t * const * fields )
+{
+  const __m256i swap = _mm256_set_epi8( 8, 9, 10, 11, 12, 13, 14, 15,
+					0, 1, 2, 3, 4, 5, 6, 7,
+					8, 9, 10, 11, 12, 13, 14, 15,
+					0, 1, 2, 3, 4, 5, 6, 7 );
+
+  size_t i = first;
+  for ( ; i + 4 <= count; i += 4 ) {
+    __m256i head[ 4 ];
+    __m128i tail[ 4 ];
+    for ( size_t d = 0; d < 4; d++ ) {
+      head[ d ] = _mm256_shuffle_epi8( _mm256_loadu_si256( reinterpret_cast<const __m256i *>( headers[ i + d ] ) ), swap );
+      tail[ d ] = _mm_loadu_si128( reinterpret_cast<const __m128i *>( headers[ i + d ] + 32 ) );
+    }
+
+    /* (d0.f0, d1.f0, d0.f2, d1.f2) and so on */
+    const __m256i even01 = _mm256_unpacklo_epi64( head[ 0 ], head[ 1 ] );
+    const __m256i odd01 = _mm256_unpackhi_epi64( head[ 0 ], head[ 1 ] );
+    const __m256i even23 = _mm256_unpacklo_epi64( head[ 2 ], head[ 3 ] );
+    const __m256i odd23 = _mm256_unpackhi_epi64( head[ 2 ], head[ 3 ] );
+
+    _mm256_storeu_si256( reinterpret_cast<__m256i *>( fields[ 0 ] + i ),
+			 _mm256_permute2x128_si256( even01, even23, 0x20 ) );
+    _mm256_storeu_si256( reinterpret_cast<__m256i *>( fields[ 1 ] + i ),
+			 _mm256_permute2x128_si256( odd01, odd23, 0x20 ) );
+    _mm256_storeu_si256( reinterpret_cast<__m256i *>( fields[ 2 ] + i ),
+			 _mm256_permute2x128_si256( even01, even23, 0x31 ) );
+    _mm256_storeu_si256( reinterpret_cast<__m256i *>( fields[ 3 ] + i ),
+			 _mm256_permute2x128_si256( odd01, odd23, 0x31 ) );
+
+    /* (d0.f4, d0.f5, d2.f4, d2.f5) and (d1.f4, d1.f5, d3.f4, d3.f5) */
+    const __m256i tail02 = _mm256_shuffle_epi8(
+      _mm256_inserti128_si256( _mm256_castsi128_si256( tail[ 0 ] ), tail[ 2 ], 1 ), swap );
+    const __m256i tail13 = _mm256_shuffle_epi8(
+      _mm256_inserti128_si256( _mm256_castsi128_si256( tail[ 1 ] ), tail[ 3 ], 1 ), swap );
+
+    _mm256_storeu_si256( reinterpret_cast<__m256i *>( fields[ 4 ] + i ),
+			 _mm256_unpacklo_epi64( tail02, tail13 ) );
+    _mm256_storeu_si256( reinterpret_cast<__m256i *>( fields[ 5 ] + i ),
+			 _mm256_unpackhi_epi64( tail02, tail13 ) );
+  }
+
+  decode_scalar( headers, i, count, fields );
+}
+
+#endif /* CPU_FEATURES_X86 */
+
+HeaderBatch::HeaderBatch()
+  : HeaderBatch( CpuFeatures::best_implementation() )
+{}
+
+HeaderBatch::HeaderBatch( const Implementation implementation )
+  : implementation_( implementation )
+{
+  if ( not CpuFeatures::supported( implementation ) ) {
+    throw runtime_error( "HeaderBatch: " + CpuFeatures::name( implementation ) + " not supported on this CPU" );
+  }
+}
+
+void HeaderBatch::decode( const vector<UDPSocket::received_datagram> & datagrams,
+			  const size_t count )
+{
+  static const char zero_header[ HEADER_SIZE ] = {};
+
+  if ( count > datagrams.size() ) {
+    throw runtime_error( "HeaderBatch: more datagrams requested than given" );
+  }
+
+  /* grow (never shrink) the arrays, at once to a full batch, so a
+     steady stream of bursts does not allocate */
+  if ( sequence_number.size() < count ) {
+    const size_t capacity = max( count, UDPSocket::MAX_BATCH );
+    for ( auto field : { &sequence_number, &send_timestamp, &ack_sequence_number,
+			 &ack_send_timestamp, &ack_recv_timestamp, &ack_payload_length } ) {
+      field->resize( capacity );
+    }
+    valid.resize( capacity );
+    headers_.resize( capacity );
+  }
+  size_ = count;
+
+  for ( size_t i = 0; i < count; i++ ) {
+    const string & payload = datagrams[ i ].payload;
+    valid[ i ] = payload.size() >= HEADER_SIZE;
+    headers_[ i ] = valid[ i ] ? payload.data() : zero_header;
+  }
+
+  uint64_t * const fields[ FIELDS ] = { sequence_number.data(), send_timestamp.data(),
+					ack_sequence_number.data(), ack_send_timestamp.data(),
+					ack_recv_timestamp.data(), ack_payload_length.data() };
+
+  switch ( implementation_ ) {
+#ifdef CPU_FEATURES_X86
+  case Implementation::AVX2:
+    decode_avx2( headers_.data(), 0, count, fields );
+    break;
+  case Implementation::SSSE3:
+    decode_ssse3( headers_.data(), 0, count, fields );
+    break;
+#endif
+  default:
+    decode_scalar( headers_.data(), 0, count, fields );
+    break;
+  }
+}
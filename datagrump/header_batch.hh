@@ -0,0 +1,61 @@
+#ifndef HEADER_BATCH_HH
+#define HEADER_BATCH_HH
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cpu_features.hh"
+#include "socket.hh"
+
+/* The headers of a burst of received datagrams, decoded together into
+   one array per field (the six big-endian uint64_t fields that open
+   every ContestMessage). The byte swaps and the transpose into fields
+   run four datagrams at a time with AVX2, two at a time with SSSE3, or
+   one field at a time, whichever is best on this CPU (checked once, at
+   run time). */
+class HeaderBatch
+{
+public:
+  typedef CpuFeatures::Implementation Implementation;
+
+  static const size_t FIELDS = 6;
+  static const size_t HEADER_SIZE = FIELDS * sizeof( uint64_t );
+
+private:
+  Implementation implementation_;
+  size_t size_ {0};
+
+  /* where each datagram's header starts (or a zero header if it had none) */
+  std::vector<const char *> headers_ {};
+
+  /* no copying: headers_ points into the datagrams last decoded */
+  HeaderBatch( const HeaderBatch & other ) = delete;
+  HeaderBatch & operator=( const HeaderBatch & other ) = delete;
+
+public:
+  /* one entry per datagram */
+  std::vector<uint64_t> sequence_number {};
+  std::vector<uint64_t> send_timestamp {};
+  std::vector<uint64_t> ack_sequence_number {};
+  std::vector<uint64_t> ack_send_timestamp {};
+  std::vector<uint64_t> ack_recv_timestamp {};
+  std::vector<uint64_t> ack_payload_length {};
+
+  /* whether each datagram was long enough to hold a header */
+  std::vector<uint8_t> valid {};
+
+  /* the best implementation this CPU supports */
+  HeaderBatch();
+
+  /* a particular implementation (throws if this CPU lacks it) */
+  HeaderBatch( const Implementation implementation );
+
+  /* Decode the headers of the first `count` datagrams */
+  void decode( const std::vector<UDPSocket::received_datagram> & datagrams,
+	       const size_t count );
+
+  size_t size( void ) const { return size_; }
+};
+
+#endif /* HEADER_BATCH_HH */
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 
 #include "lattecontroller.hh"
@@ -12,6 +13,38 @@ LatteController::LatteController( const bool debug )
     bw_window_ ( BwWindow(debug) )
 {}
 
+LatteController::LatteController( const bool debug,
+    const Params & params)
+  : Controller ( debug ),
+    params_ ( params ),
+    rtt_window_ ( RttWindow(debug) ),
+    delivery_window_ ( DeliveryWindow(debug) ),
+    bw_window_ ( BwWindow(debug) ),
+    startup_ ( params.startup_gain )
+{
+  if (params_.startup == 0) {
+    startup_.end("disabled");
+  }
+}
+
+/* Set a parameter by name */
+bool LatteController::Params::set( const string & name, const float value )
+{
+  if (name == "lambda_base") { lambda_base = value; }
+  else if (name == "lambda_boost") { lambda_boost = value; }
+  else if (name == "lambda_knee") { lambda_knee = value; }
+  else if (name == "gamma") { gamma = value; }
+  else if (name == "rtt_grad_gain") { rtt_grad_gain = value; }
+  else if (name == "rtt_grad_thresh") { rtt_grad_thresh = value; }
+  else if (name == "sbw_gain") { sbw_gain = value; }
+  else if (name == "use_owd") { use_owd = value; }
+  else if (name == "ack_filter") { ack_filter = value; }
+  else if (name == "startup") { startup = value; }
+  else if (name == "startup_gain") { startup_gain = value; }
+  else { return false; }
+  return true;
+}
+
 LatteController::LatteController( const bool debug,
     const float lambda)
   : Controller ( debug ),
@@ -34,6 +67,20 @@ unsigned int LatteController::window_size( void )
   return the_window_size;
 }
 
+/* A datagram was sent */
+void LatteController::datagram_was_sent( const uint64_t sequence_number,
+				    /* of the sent datagram */
+				    const uint64_t send_timestamp )
+                                    /* in milliseconds */
+{
+  startup_.datagram_was_sent(sequence_number);
+
+  if ( debug_ ) {
+    cerr << "At time " << send_timestamp
+	 << " sent datagram " << sequence_number << endl;
+  }
+}
+
 /* An ack was received */
 void LatteController::ack_received( const uint64_t sequence_number_acked,
 			       /* what sequence number was acknowledged */
@@ -44,68 +91,139 @@ void LatteController::ack_received( const uint64_t sequence_number_acked,
 			       const uint64_t timestamp_ack_received )
                                /* when the ack was received (by sender) */
 {
-  // auto prev_cwnd = cwnd_;
+  const Ack ack {sequence_number_acked, send_timestamp_acked,
+                 recv_timestamp_acked, timestamp_ack_received};
+  acks_received(&ack, 1);
+}
+
+/* A burst of acks: every ack updates the estimators (and startup), but
+   the window is set once, from the state after the last one */
+void LatteController::acks_received( const Ack * const acks, const size_t count )
+{
+  if (count == 0) {
+    return;
+  }
+
+  const float prev_cwnd = cwnd_;
+  const bool starting = startup_.active();
+
+  float delay_t = 0;
+  for (size_t i = 0; i < count; i++) {
+    delay_t = update_samples(acks[i]);
+    if (startup_.active()) {
+      startup_.ack_received(acks[i].sequence_number_acked, curr_max_bw_, delay_t, min_rtt_);
+    }
+  }
 
+  update_window(prev_cwnd, delay_t, starting);
+
+  if ( debug_ ) {
+    cerr << "At time " << acks[count - 1].timestamp_ack_received
+	 << " after " << count << " acks, min_rtt (w) " << rtt_window_.min_rtt()
+	 << ", cwnd " << cwnd_ << endl;
+  }
+}
+
+/* Feed one ack to the estimators; returns its delay signal: the RTT
+   (the least-held one of the latest ack group, with ack_filter), or with
+   use_owd the min RTT plus forward queueing only, so a slow ack path
+   does not look like congestion */
+float LatteController::update_samples( const Ack & ack )
+{
   /* Get latest RTT */
-  uint64_t rtt_t = timestamp_ack_received - send_timestamp_acked;
+  uint64_t rtt_t = ack.timestamp_ack_received - ack.send_timestamp_acked;
+
+  /* Forward queueing delay, from the receiver's timestamps */
+  const double last_queueing_delay = owd_.queueing_delay();
+  owd_.update(ack.send_timestamp_acked, ack.recv_timestamp_acked);
 
-  auto rtt_grad_t = ((float)rtt_t - rtt_window_.last_rtt())/min_rtt_;
-  rtt_grad_ = (1 - 0.7) * rtt_grad_ + 0.7 * rtt_grad_t;
+  /* With ack_filter, rate and RTT-gradient samples come once per group
+     of compressed acks instead of once per ack */
+  ack_filter_.set_rate_window(min_rtt_);
+  const bool filtered_sample =
+    ack_filter_.update(ack.send_timestamp_acked, ack.recv_timestamp_acked, ack.timestamp_ack_received);
+  const bool use_filter = params_.ack_filter != 0;
+
+  if (params_.use_owd or not use_filter or filtered_sample) {
+    auto rtt_grad_t = params_.use_owd
+      ? (float)(owd_.queueing_delay() - last_queueing_delay)/min_rtt_
+      : use_filter ? (float)ack_filter_.rtt_change()/min_rtt_
+      : ((float)rtt_t - rtt_window_.last_rtt())/min_rtt_;
+    rtt_grad_ = (1 - params_.rtt_grad_gain) * rtt_grad_
+      + params_.rtt_grad_gain * rtt_grad_t;
+  }
 
   /* Update RTT samples */
-  rtt_window_.update_rtt_samples(timestamp_ack_received, rtt_t);
+  rtt_window_.update_rtt_samples(ack.timestamp_ack_received, rtt_t);
 
   auto total_delivered = delivery_window_.get_curr_delivered() + 1;
-  delivery_window_.update_delivery_data(timestamp_ack_received, total_delivered);
-  auto delivered_at_sendts = delivery_window_.get_delivered(send_timestamp_acked);
+  delivery_window_.update_delivery_data(ack.timestamp_ack_received, total_delivered);
+  auto delivered_at_sendts = delivery_window_.get_delivered(ack.send_timestamp_acked);
 
-  auto bw_t = (float)(total_delivered - delivered_at_sendts.second)/(timestamp_ack_received - delivered_at_sendts.first);
-  sbw_t_ = 0.3 * bw_t + 0.7 * sbw_t_;
-  bw_window_.update_bw_samples(timestamp_ack_received, bw_t);
+  auto bw_t = use_filter
+    ? (float)ack_filter_.delivery_rate()
+    : (float)(total_delivered - delivered_at_sendts.second)/(ack.timestamp_ack_received - delivered_at_sendts.first);
+  if (not use_filter or filtered_sample) {
+    sbw_t_ = params_.sbw_gain * bw_t + (1 - params_.sbw_gain) * sbw_t_;
+    bw_window_.update_bw_samples(ack.timestamp_ack_received, bw_t);
+  }
   curr_max_bw_ = bw_window_.max_bw();
   min_rtt_ = rtt_window_.min_rtt();
   bdp_ = curr_max_bw_ * min_rtt_;
 
   if (debug_) {
-    cerr << "time " << timestamp_ack_received
+    cerr << "time " << ack.timestamp_ack_received
       << " bw_t " << bw_t << " pkt/s"
       << " rtt_t " << rtt_t << " ms"
       << ", min_rtt " << min_rtt_
       << " max_bw " << curr_max_bw_ << " pkts/ms"
       << " rtt " << min_rtt_ << " ms"
       << " bdp " << bdp_ << " pkts"
+      << " fwd_queueing " << owd_.queueing_delay() << " ms"
       << " rtt_grad " << rtt_grad_
 	    << " , cwnd " << cwnd_ << endl;
+    cerr << "At time " << ack.timestamp_ack_received
+	 << " received ack for datagram " << ack.sequence_number_acked
+	 << " (send @ time " << ack.send_timestamp_acked
+	 << ", received @ time " << ack.recv_timestamp_acked << " by receiver's clock)"
+	 << endl;
   }
 
-  if (cwnd_ > 10) {
-    lambda_ = 1.6 + 0.4 * 10.0/cwnd_;
+  return params_.use_owd ? min_rtt_ + owd_.queueing_delay()
+    : use_filter ? ack_filter_.rtt() : rtt_t;
+}
+
+/* Set the window from the estimators and the latest delay signal */
+void LatteController::update_window( const float prev_cwnd, const float delay_t,
+                                     const bool starting )
+{
+  if (cwnd_ > params_.lambda_knee) {
+    lambda_ = params_.lambda_base + params_.lambda_boost * params_.lambda_knee/cwnd_;
   }
   else {
-    lambda_ = 2.0;
+    lambda_ = params_.lambda_base + params_.lambda_boost;
   }
   cwnd_ =  lambda_ * bdp_;
 
-  if (rtt_t > min_rtt_) { /* Mostly true */
-    cwnd_ /= ((float)rtt_t/min_rtt_);
+  if (delay_t > min_rtt_) { /* Mostly true */
+    cwnd_ /= (delay_t/min_rtt_);
   }
 
-  if (rtt_grad_ > 0.1) {
+  if (rtt_grad_ > params_.rtt_grad_thresh) {
     cwnd_ = cwnd_ * (1 - rtt_grad_);
     //cerr << rtt_grad_ << "\t" << cwnd_ << endl;
   }
-  /* Ensure window >= 3 */
-  cwnd_ = cwnd_ < 3 ? 3 : cwnd_;
 
-
-  if ( debug_ ) {
-    cerr << "At time " << timestamp_ack_received
-	 << " received ack for datagram " << sequence_number_acked
-	 << " (send @ time " << send_timestamp_acked
-	 << ", received @ time " << recv_timestamp_acked << " by receiver's clock)"
-	 << ", min_rtt (w) " << rtt_window_.min_rtt()
-	 << ", cwnd " << cwnd_ << endl;
+  /* Startup overrides the model: grow to gain * BDP, never shrinking */
+  if (startup_.active()) {
+    cwnd_ = max(prev_cwnd, startup_.gain() * bdp_);
+  }
+  else if (starting and debug_) {
+    cerr << "Startup over after " << startup_.rounds() << " rounds ("
+	 << startup_.exit_reason() << "), max_bw " << curr_max_bw_ << endl;
   }
+  /* Ensure window >= 3 */
+  cwnd_ = cwnd_ < 3 ? 3 : cwnd_;
 }
 
 /* An ack was received */
@@ -113,27 +231,59 @@ void LatteController::timed_out()
   /* when time out happens */
 {
     //cwnd_ = 3;
+  startup_.end("timeout");
 
   if ( debug_ ) {
     cerr << "Timed out. cwnd: " << cwnd_ << endl;
   }
 }
 
-/* Wait for some time between sending packets */
-float LatteController::get_interpkt_delay( void )
+/* Start from a cached path estimate: pace at the cached bandwidth and
+   open the window to the BDP, both scaled by how fresh the cache is.
+   The bandwidth sample ages out of bw_window_ like any other. */
+void LatteController::warm_start( const PathEstimate & estimate )
 {
-  //return 1./curr_max_bw_ * gamma_ * 1000;
-  if (sbw_t_ < 0.8 * curr_max_bw_) {
-    return 1./curr_max_bw_ * gamma_ * 1000;
+  const float bw = estimate.confidence * estimate.max_bw;
+  if (bw <= 0 or estimate.min_rtt_ms <= 0) {
+    return;
+  }
+
+  min_rtt_ = estimate.min_rtt_ms;
+  curr_max_bw_ = sbw_t_ = bw;
+  bw_window_.update_bw_samples(timestamp_ms(), bw);
+  bdp_ = bw * min_rtt_;
+  cwnd_ = max(3.0f, lambda_ * bdp_);
+  /* a fresh estimate leaves nothing for startup to find */
+  if (estimate.confidence >= 0.5) {
+    startup_.end("warm start");
   }
-  return 1./sbw_t_ * gamma_ * 1000;
-}
 
+  if ( debug_ ) {
+    cerr << "Warm start: min_rtt " << min_rtt_ << " ms, bw " << bw
+	 << " pkts/ms (confidence " << estimate.confidence << "), cwnd " << cwnd_ << endl;
+  }
+}
 
-/* How long to wait (in milliseconds) if there are no acks
-   before sending one more datagram */
-unsigned int LatteController::timeout_ms( void )
+/* Min RTT and max bandwidth measured so far */
+bool LatteController::path_estimate( PathEstimate & estimate )
 {
+  if (delivery_window_.get_curr_delivered() == 0) {
+    return false;
+  }
+  estimate.min_rtt_ms = max<float>(1, min_rtt_); /* ms timestamps: 0 means < 1 ms */
+  estimate.max_bw = curr_max_bw_;
+  return true;
+}
 
- return static_cast<unsigned int>(1.5 * min_rtt_);
+/* Wait for some time between sending packets */
+float LatteController::get_interpkt_delay( void )
+{
+  //return 1./curr_max_bw_ * params_.gamma * 1000;
+  if (startup_.active()) {
+    return startup_.interpkt_delay(curr_max_bw_, cwnd_, min_rtt_);
+  }
+  if (sbw_t_ < 0.8 * curr_max_bw_) {
+    return 1./curr_max_bw_ * params_.gamma * 1000;
+  }
+  return 1./sbw_t_ * params_.gamma * 1000;
 }
@@ -5,15 +5,40 @@
 #include <cassert>
 #include <cstdint>
 #include <deque>
+#include <string>
 
+#include "ack_filter.hh"
 #include "controller.hh"
 #include "metacontroller.hh"
+#include "owd_estimator.hh"
+#include "startup.hh"
 
 
 /* Congestion controller interface */
 class LatteController : public Controller
 {
+public:
+  /* Tunable parameters */
+  struct Params {
+    float lambda_base {1.6};     /* cwnd = lambda * bdp, where lambda is */
+    float lambda_boost {0.4};    /* base + boost * min(1, knee / cwnd) */
+    float lambda_knee {10};
+    float gamma {0.8};           /* pacing gap, in units of 1/bandwidth */
+    float rtt_grad_gain {0.7};   /* EWMA weight of new RTT gradient samples */
+    float rtt_grad_thresh {0.1}; /* shrink cwnd by gradients above this */
+    float sbw_gain {0.3};        /* EWMA weight of new bandwidth samples */
+    float use_owd {1};           /* nonzero: forward queueing delay instead of RTT */
+    float ack_filter {1};        /* nonzero: de-jitter rate and gradient samples */
+    float startup {1};           /* nonzero: exponential startup phase */
+    float startup_gain {2};      /* startup cwnd and pacing gain, per round */
+
+    /* Set a parameter by name; false if there is no such parameter */
+    bool set( const std::string & name, const float value );
+  };
+
 protected:
+  Params params_ {};
+
   float cwnd_{50}; /* Congestion window */
   float min_rtt_{500};   /* Min RTT seen */
   float bdp_{10};
@@ -22,13 +47,21 @@ protected:
   float sbw_t_{10};
 
   float lambda_{2.0};
-  float gamma_{0.8};
 
   RttWindow rtt_window_;
   DeliveryWindow delivery_window_;
   BwWindow bw_window_;
+  OwdEstimator owd_ {};
+  AckFilter ack_filter_ {};
+  Startup startup_ {};
   bool conservative_mode_{false};
 
+  /* Feed one ack to the estimators; returns its delay signal */
+  float update_samples( const Ack & ack );
+
+  /* Set cwnd from the estimators, once per burst of acks */
+  void update_window( const float prev_cwnd, const float delay_t, const bool starting );
+
 public:
 
   LatteController( const bool debug );
@@ -37,6 +70,9 @@ public:
   LatteController( const bool debug,
       const float cwnd );
 
+  LatteController( const bool debug,
+      const Params & params );
+
   /* Timeout occured*/
   void timed_out( void );
 
@@ -46,15 +82,24 @@ public:
   /* Get current window size, in datagrams */
   unsigned int window_size( void );
 
+  /* A datagram was sent */
+  void datagram_was_sent( const uint64_t sequence_number,
+			  const uint64_t send_timestamp );
+
   /* An ack was received */
   void ack_received( const uint64_t sequence_number_acked,
 		     const uint64_t send_timestamp_acked,
 		     const uint64_t recv_timestamp_acked,
 		     const uint64_t timestamp_ack_received );
 
-  /* How long to wait (in milliseconds) if there are no acks
-     before sending one more datagram */
-  unsigned int timeout_ms( void );
+  /* A burst of acks, with one window update */
+  void acks_received( const Ack * const acks, const size_t count );
+
+  /* Start from a cached path estimate */
+  void warm_start( const PathEstimate & estimate );
+
+  /* Min RTT and max bandwidth measured so far */
+  bool path_estimate( PathEstimate & estimate );
 
 };
 #endif
@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "file_descriptor.hh"
+#include "link_log.hh"
+#include "mmap_region.hh"
+#include "util.hh"
+
+using namespace std;
+
+static const uint32_t NO_DELAY = numeric_limits<uint32_t>::max();
+
+/* A cursor over the mapped log, one line at a time */
+class LogParser
+{
+private:
+  const char * pos_;
+  const char * end_;
+  const string & filename_;
+  uint64_t line_ {1};
+
+public:
+  LogParser( const char * const begin, const char * const end, const string & filename )
+    : pos_( begin ), end_( end ), filename_( filename ) {}
+
+  /* no copying: it points into the mapping */
+  LogParser( const LogParser & other ) = delete;
+  LogParser & operator=( const LogParser & other ) = delete;
+
+  bool done( void ) const { return pos_ >= end_; }
+  char peek( void ) const { return pos_ < end_ ? *pos_ : '\n'; }
+
+  void skip_spaces( void )
+  {
+    while ( pos_ < end_ and (*pos_ == ' ' or *pos_ == '\t') ) {
+      pos_++;
+    }
+  }
+
+  void skip_line( void )
+  {
+    const void * const newline = memchr( pos_, '\n', end_ - pos_ );
+    pos_ = newline ? static_cast<const char *>( newline ) + 1 : end_;
+    line_++;
+  }
+
+  uint64_t number( void )
+  {
+    skip_spaces();
+    if ( pos_ >= end_ or *pos_ < '0' or *pos_ > '9' ) {
+      throw runtime_error( filename_ + ":" + to_string( line_ ) + ": expected a number" );
+    }
+    uint64_t ret = 0;
+    while ( pos_ < end_ and *pos_ >= '0' and *pos_ <= '9' ) {
+      ret = ret * 10 + (*pos_++ - '0');
+    }
+    return ret;
+  }
+
+  char event( void )
+  {
+    skip_spaces();
+    if ( pos_ >= end_ ) {
+      throw runtime_error( filename_ + ":" + to_string( line_ ) + ": expected an event" );
+    }
+    return *pos_++;
+  }
+};
+
+/* The sample at the 95th percentile of a histogram of whole ms */
+static double p95_ms( const vector<uint64_t> & histogram, const uint64_t samples )
+{
+  if ( samples == 0 ) {
+    return 0;
+  }
+
+  const uint64_t rank = samples * 95 / 100; /* as LinkSimulator's p95_ms() */
+  uint64_t seen = 0;
+  for ( size_t delay = 0; delay < histogram.size(); delay++ ) {
+    seen += histogram[ delay ];
+    if ( seen > rank ) {
+      return delay;
+    }
+  }
+  return histogram.size() - 1;
+}
+
+static void count( vector<uint64_t> & histogram, const uint64_t delay )
+{
+  if ( delay >= histogram.size() ) {
+    histogram.resize( delay + 1 );
+  }
+  histogram[ delay ]++;
+}
+
+LinkLogSummary analyze_link_log( const string & filename )
+{
+  FileDescriptor fd( SystemCall( "open " + filename, open( filename.c_str(), O_RDONLY ) ) );
+
+  struct stat info;
+  SystemCall( "fstat " + filename, fstat( fd.fd_num(), &info ) );
+  if ( info.st_size == 0 ) {
+    throw runtime_error( filename + ": empty log" );
+  }
+
+  const MMapRegion region( info.st_size, PROT_READ, MAP_PRIVATE, fd.fd_num() );
+  SystemCall( "madvise", madvise( region.addr(), region.length(), MADV_SEQUENTIAL ) );
+
+  const char * const begin = reinterpret_cast<const char *>( region.addr() );
+  LogParser log( begin, begin + region.length(), filename );
+
+  LinkLogSummary summary;
+  uint64_t opportunity_bytes = 0, departure_bytes = 0, queueing_delay_sum = 0;
+  vector<uint64_t> queueing_delays, signal_delays;
+
+  /* least queueing delay of the packets that entered the queue in each
+     ms (for the signal delay), indexed from the first event */
+  vector<uint32_t> delay_by_arrival;
+
+  bool have_events = false;
+  uint64_t first = 0, last = 0;
+
+  while ( not log.done() ) {
+    if ( log.peek() == '#' or log.peek() == '\n' ) {
+      log.skip_line(); /* header comments */
+      continue;
+    }
+
+    const uint64_t timestamp = log.number();
+    if ( not have_events ) {
+      first = timestamp;
+      have_events = true;
+    }
+    last = max( last, timestamp );
+
+    const char event = log.event();
+    const uint64_t bytes = log.number();
+
+    switch ( event ) {
+    case '+':
+      summary.arrivals++;
+      break;
+    case '#':
+      summary.opportunities++;
+      opportunity_bytes += bytes;
+      break;
+    case 'd':
+      summary.drops++;
+      break;
+    case '-': {
+      const uint64_t delay = log.number();
+      summary.departures++;
+      departure_bytes += bytes;
+      queueing_delay_sum += delay;
+      count( queueing_delays, delay );
+
+      /* when it entered the queue (no earlier than the log starts) */
+      const uint64_t arrival = max( timestamp - min( delay, timestamp ), first ) - first;
+      if ( arrival >= delay_by_arrival.size() ) {
+	delay_by_arrival.resize( arrival + 1, NO_DELAY );
+      }
+      delay_by_arrival[ arrival ] = min<uint32_t>( delay_by_arrival[ arrival ], delay );
+      break;
+    }
+    default:
+      throw runtime_error( filename + ": unknown event '" + string( 1, event ) + "'" );
+    }
+
+    log.skip_line();
+  }
+
+  if ( not have_events ) {
+    throw runtime_error( filename + ": no events" );
+  }
+
+  summary.duration_ms = max<uint64_t>( last - first, 1 );
+  summary.capacity_mbps = opportunity_bytes * 8.0 / (summary.duration_ms * 1000.0);
+  summary.throughput_mbps = departure_bytes * 8.0 / (summary.duration_ms * 1000.0);
+  if ( summary.departures ) {
+    summary.mean_queueing_delay_ms = double( queueing_delay_sum ) / summary.departures;
+  }
+  summary.p95_queueing_delay_ms = p95_ms( queueing_delays, summary.departures );
+
+  /* Signal delay at each ms: how long until a packet sent then would be
+     delivered, i.e. the least (wait until a later packet enters the
+     queue) + (its queueing delay). Swept from the end; ms after the
+     last packet to enter the queue have no signal delay. */
+  uint64_t signal_samples = 0;
+  uint64_t running = NO_DELAY;
+  for ( size_t ms = delay_by_arrival.size(); ms-- > 0; ) {
+    if ( running != NO_DELAY ) {
+      running++;
+    }
+    running = min<uint64_t>( running, delay_by_arrival[ ms ] );
+    if ( running != NO_DELAY ) {
+      count( signal_delays, running );
+      signal_samples++;
+    }
+  }
+  summary.p95_signal_delay_ms = p95_ms( signal_delays, signal_samples );
+
+  return summary;
+}
@@ -0,0 +1,34 @@
+#ifndef LINK_LOG_HH
+#define LINK_LOG_HH
+
+#include <cstdint>
+#include <string>
+
+/* Scores of a mahimahi link log (mm-link --uplink-log), in the terms
+   mm-throughput-graph uses */
+struct LinkLogSummary
+{
+  uint64_t duration_ms {0};            /* first event to last */
+  uint64_t arrivals {0};               /* "+" lines: packets into the queue */
+  uint64_t departures {0};             /* "-" lines: packets delivered */
+  uint64_t drops {0};                  /* "d" lines */
+  uint64_t opportunities {0};          /* "#" lines: delivery opportunities */
+  double capacity_mbps {0};
+  double throughput_mbps {0};
+  double mean_queueing_delay_ms {0};
+  double p95_queueing_delay_ms {0};    /* per packet, time in the link's queue */
+  double p95_signal_delay_ms {0};      /* per ms: how long a packet sent then waits */
+
+  double utilization( void ) const { return capacity_mbps > 0 ? throughput_mbps / capacity_mbps : 0; }
+
+  /* throughput over 95th-percentile signal delay, in Mbps per second of delay */
+  double power( void ) const { return p95_signal_delay_ms > 0 ? throughput_mbps / (p95_signal_delay_ms / 1000.0) : 0; }
+};
+
+/* Score a link log in one pass over a read-only mapping of it. Delays
+   in the log are whole ms, so the percentiles come from histograms
+   instead of kept samples, and memory grows with the log's duration
+   rather than its size. */
+LinkLogSummary analyze_link_log( const std::string & filename );
+
+#endif /* LINK_LOG_HH */
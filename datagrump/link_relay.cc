@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <csignal>
+#include <ctime>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#include <sys/signalfd.h>
+
+#include "link_relay.hh"
+#include "poller.hh"
+#include "util.hh"
+
+using namespace std;
+using namespace PollerShortNames;
+
+/* what mm-link lets through per delivery opportunity */
+static const uint32_t OPPORTUNITY_BYTES = 1504;
+
+/* mm-link counts whole IP datagrams; the relay sees UDP payloads */
+static const uint32_t HEADER_OVERHEAD = 28; /* IPv4 + UDP */
+
+static const uint64_t NEVER = numeric_limits<uint64_t>::max();
+
+/*************** TraceQueue ******************/
+TraceQueue::TraceQueue( const shared_ptr<const LinkTrace> & trace, const uint64_t queue_limit,
+			ostream * const log, const DeliverCallback & deliver )
+  : trace_( trace ), queue_limit_( queue_limit ), log_( log ), deliver_( deliver )
+{}
+
+void TraceQueue::enqueue( string && payload, const uint64_t now_us )
+{
+  if ( not trace_ ) { /* unconstrained */
+    deliver_( move( payload ), now_us );
+    return;
+  }
+
+  /* opportunities before it arrived are not its to use */
+  advance( now_us );
+
+  const uint64_t now_ms = now_us / 1000;
+  const uint32_t size = payload.size() + HEADER_OVERHEAD;
+
+  if ( log_ ) {
+    *log_ << now_ms << " + " << size << "\n";
+  }
+
+  if ( queue_limit_ and queue_.size() >= queue_limit_ ) {
+    drops_++;
+    if ( log_ ) {
+      *log_ << now_ms << " d " << size << "\n";
+    }
+    return;
+  }
+
+  queue_.push_back( { move( payload ), now_ms, size } );
+}
+
+void TraceQueue::advance( const uint64_t now_us )
+{
+  if ( not trace_ ) {
+    return;
+  }
+
+  /* unused opportunities are lost, as on the real link */
+  for ( uint64_t opportunity_ms = trace_->opportunity( next_opportunity_ );
+	opportunity_ms * 1000 <= now_us;
+	opportunity_ms = trace_->opportunity( ++next_opportunity_ ) ) {
+    if ( log_ ) {
+      *log_ << opportunity_ms << " # " << OPPORTUNITY_BYTES << "\n";
+    }
+
+    uint32_t budget = OPPORTUNITY_BYTES;
+    while ( budget > 0 and not queue_.empty() ) {
+      QueuedPacket & head = queue_.front();
+      const uint32_t carried = min( budget, head.bytes_left );
+      head.bytes_left -= carried;
+      budget -= carried;
+
+      if ( head.bytes_left == 0 ) {
+	if ( log_ ) {
+	  *log_ << opportunity_ms << " - " << head.payload.size() + HEADER_OVERHEAD
+		<< " " << opportunity_ms - head.arrival_ms << "\n";
+	}
+	deliver_( move( head.payload ), opportunity_ms * 1000 );
+	queue_.pop_front();
+      }
+    }
+  }
+}
+
+uint64_t TraceQueue::next_departure_us( void ) const
+{
+  if ( not trace_ or queue_.empty() ) {
+    return NEVER;
+  }
+
+  /* the head may need several opportunities; waking for each is fine */
+  return trace_->opportunity( next_opportunity_ ) * 1000;
+}
+
+/*************** DelayLine ******************/
+void DelayLine::push( string && payload, const uint64_t time_us )
+{
+  in_flight_.emplace_back( time_us + delay_us_, move( payload ) );
+}
+
+void DelayLine::release( const uint64_t now_us, const TraceQueue::DeliverCallback & deliver )
+{
+  while ( not in_flight_.empty() and in_flight_.front().first <= now_us ) {
+    deliver( move( in_flight_.front().second ), in_flight_.front().first );
+    in_flight_.pop_front();
+  }
+}
+
+uint64_t DelayLine::next_release_us( void ) const
+{
+  return in_flight_.empty() ? NEVER : in_flight_.front().first;
+}
+
+/*************** LinkRelay ******************/
+LinkRelay::LinkRelay( const RelayConfig & config, const Address & listen_address,
+		      const Address & receiver_address )
+  : config_( config ),
+    receiver_address_( receiver_address ),
+    log_( config.uplink_log.empty() ? nullptr : new ofstream( config.uplink_log ) ),
+    start_( chrono::steady_clock::now() ),
+    uplink_( config.uplink, config.queue_limit_packets, log_.get(),
+	     [&] ( string && payload, const uint64_t time_us ) {
+	       uplink_delay_.push( move( payload ), time_us );
+	     } ),
+    uplink_delay_( config.one_way_delay_ms ),
+    downlink_delay_( config.one_way_delay_ms ),
+    downlink_( config.downlink, config.queue_limit_packets, nullptr,
+	       [&] ( string && payload, const uint64_t ) {
+		 if ( have_sender_ ) {
+		   sender_side_.sendto( sender_address_, payload );
+		   result_.acks_relayed++;
+		 }
+	       } )
+{
+  if ( not config_.uplink ) {
+    throw runtime_error( "LinkRelay: no uplink trace" );
+  }
+
+  if ( log_ and not *log_ ) {
+    throw runtime_error( "cannot open " + config_.uplink_log );
+  }
+
+  sender_side_.bind( listen_address );
+
+  if ( log_ ) {
+    write_log_header();
+  }
+}
+
+uint64_t LinkRelay::now_us( void ) const
+{
+  return chrono::duration_cast<chrono::microseconds>( chrono::steady_clock::now() - start_ ).count();
+}
+
+/* the header mm-link writes; timestamps in the log count from start_ */
+void LinkRelay::write_log_header( void )
+{
+  const uint64_t epoch_ms = chrono::duration_cast<chrono::milliseconds>(
+    chrono::system_clock::now().time_since_epoch() ).count();
+
+  *log_ << "# mahimahi mm-link [uplink] (emulated by datagrump linkrelay)\n"
+	<< "# command line: " << config_.command_line << "\n"
+	<< "# queue: " << (config_.queue_limit_packets
+			   ? "droptail [packets=" + to_string( config_.queue_limit_packets ) + "]"
+			   : string( "infinite" )) << "\n"
+	<< "# init timestamp: " << epoch_ms << "\n"
+	<< "# base timestamp: 0\n";
+}
+
+void LinkRelay::advance( const uint64_t now_us )
+{
+  uplink_.advance( now_us );
+  uplink_delay_.release( now_us, [&] ( string && payload, const uint64_t ) {
+      receiver_side_.sendto( receiver_address_, payload );
+      result_.datagrams_relayed++;
+    } );
+
+  downlink_delay_.release( now_us, [&] ( string && payload, const uint64_t time_us ) {
+      downlink_.enqueue( move( payload ), time_us );
+    } );
+  downlink_.advance( now_us );
+}
+
+RelayResult LinkRelay::run( void )
+{
+  /* take SIGINT and SIGTERM through the poller, so the log is complete */
+  sigset_t signals;
+  sigemptyset( &signals );
+  sigaddset( &signals, SIGINT );
+  sigaddset( &signals, SIGTERM );
+  SystemCall( "sigprocmask", sigprocmask( SIG_BLOCK, &signals, nullptr ) );
+  FileDescriptor signal_fd( SystemCall( "signalfd", signalfd( -1, &signals, 0 ) ) );
+
+  Poller poller;
+
+  poller.add_action( Action( sender_side_, Direction::In, [&] () {
+	const uint64_t now = now_us();
+	const size_t count = sender_side_.recv_batch( batch_ );
+	for ( size_t i = 0; i < count; i++ ) {
+	  sender_address_ = batch_[ i ].source_address;
+	  have_sender_ = true;
+	  uplink_.enqueue( move( batch_[ i ].payload ), now );
+	}
+	return ResultType::Continue;
+      } ) );
+
+  poller.add_action( Action( receiver_side_, Direction::In, [&] () {
+	const uint64_t now = now_us();
+	const size_t count = receiver_side_.recv_batch( batch_ );
+	for ( size_t i = 0; i < count; i++ ) {
+	  downlink_delay_.push( move( batch_[ i ].payload ), now );
+	}
+	return ResultType::Continue;
+      } ) );
+
+  poller.add_action( Action( signal_fd, Direction::In, [&] () {
+	signal_fd.read( sizeof( signalfd_siginfo ) );
+	return ResultType::Exit;
+      } ) );
+
+  const uint64_t end_us = config_.duration_ms ? config_.duration_ms * 1000 : NEVER;
+
+  while ( true ) {
+    const uint64_t now = now_us();
+    advance( min( now, end_us ) );
+    if ( now >= end_us ) {
+      break;
+    }
+
+    const uint64_t wake_us = min( { uplink_.next_departure_us(), uplink_delay_.next_release_us(),
+				    downlink_delay_.next_release_us(), downlink_.next_departure_us(),
+				    end_us } );
+    const int64_t timeout_us = wake_us == NEVER ? -1 : max<int64_t>( wake_us - now, 0 );
+
+    if ( poller.poll( chrono::microseconds( timeout_us ) ).result == Poller::Result::Type::Exit ) {
+      break;
+    }
+  }
+
+  /* an idle relay has not kept the log up to date */
+  const uint64_t stop_us = min( now_us(), end_us );
+  advance( stop_us );
+
+  result_.duration_ms = stop_us / 1000;
+  result_.datagrams_dropped = uplink_.drops();
+
+  if ( log_ ) {
+    log_->flush();
+  }
+
+  return result_;
+}
@@ -0,0 +1,150 @@
+#ifndef LINK_RELAY_HH
+#define LINK_RELAY_HH
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "link_simulator.hh"
+#include "socket.hh"
+
+/* What the emulated network looks like */
+struct RelayConfig
+{
+  std::shared_ptr<const LinkTrace> uplink {};   /* sender -> receiver (required) */
+  std::shared_ptr<const LinkTrace> downlink {}; /* receiver -> sender (optional) */
+  uint64_t one_way_delay_ms {20};               /* propagation, each direction */
+  uint64_t queue_limit_packets {0};             /* 0 = unlimited */
+  uint64_t duration_ms {0};                     /* 0 = until interrupted */
+  std::string uplink_log {};                    /* mahimahi-format log of the uplink ("" = none) */
+  std::string command_line {};                  /* for the log's header */
+};
+
+/* A bottleneck queue driven by a mahimahi trace in real time, as
+   mm-link runs one: each delivery opportunity can carry 1504 bytes of
+   the queue (a packet may straddle opportunities), and sizes count
+   the IPv4 and UDP headers. Without a trace it forwards at once. */
+class TraceQueue
+{
+public:
+  /* where departures go: the payload and when it left, in us */
+  typedef std::function<void(std::string && payload, const uint64_t time_us)> DeliverCallback;
+
+private:
+  struct QueuedPacket {
+    std::string payload;
+    uint64_t arrival_ms;
+    uint32_t bytes_left;    /* still to be carried by opportunities */
+  };
+
+  std::shared_ptr<const LinkTrace> trace_;
+  uint64_t queue_limit_;
+  std::ostream * log_;
+  DeliverCallback deliver_;
+
+  std::deque<QueuedPacket> queue_ {};
+  uint64_t next_opportunity_ {0};
+  uint64_t drops_ {0};
+
+public:
+  TraceQueue( const std::shared_ptr<const LinkTrace> & trace, const uint64_t queue_limit,
+	      std::ostream * const log, const DeliverCallback & deliver );
+
+  /* no copying: it writes to the relay's log */
+  TraceQueue( const TraceQueue & other ) = delete;
+  TraceQueue & operator=( const TraceQueue & other ) = delete;
+
+  /* A packet reaches the queue (or is dropped if it is full) */
+  void enqueue( std::string && payload, const uint64_t now_us );
+
+  /* Use every delivery opportunity up to now */
+  void advance( const uint64_t now_us );
+
+  /* When advance() next has something to deliver, in us (-1 = idle) */
+  uint64_t next_departure_us( void ) const;
+
+  size_t size( void ) const { return queue_.size(); }
+  uint64_t drops( void ) const { return drops_; }
+};
+
+/* Totals of a relay run */
+struct RelayResult
+{
+  uint64_t duration_ms {0};
+  uint64_t datagrams_relayed {0};   /* reached the receiver */
+  uint64_t datagrams_dropped {0};   /* by the uplink queue */
+  uint64_t acks_relayed {0};        /* reached the sender */
+};
+
+/* A fixed propagation delay, as mm-delay adds */
+class DelayLine
+{
+private:
+  uint64_t delay_us_;
+  std::deque<std::pair<uint64_t, std::string>> in_flight_ {}; /* release time, payload */
+
+public:
+  DelayLine( const uint64_t delay_ms ) : delay_us_( delay_ms * 1000 ) {}
+
+  void push( std::string && payload, const uint64_t time_us );
+
+  /* Hand everything due by now to `deliver` */
+  void release( const uint64_t now_us, const TraceQueue::DeliverCallback & deliver );
+
+  /* When the next packet is due, in us (-1 = empty) */
+  uint64_t next_release_us( void ) const;
+};
+
+/* A UDP relay between DatagrumpSender and the receiver that emulates
+   `mm-delay DELAY mm-link UPLINK DOWNLINK` in real time. The sender
+   sends to the relay's port; datagrams cross the uplink queue, then
+   the delay, to the receiver, and its acks cross the delay, then the
+   downlink queue, back to the sender. */
+class LinkRelay
+{
+private:
+  RelayConfig config_;
+  Address receiver_address_;
+  UDPSocket sender_side_ {};     /* bound to the port the sender uses */
+  UDPSocket receiver_side_ {};   /* talks to the receiver */
+
+  Address sender_address_ {};
+  bool have_sender_ {false};
+
+  std::unique_ptr<std::ostream> log_;
+  std::chrono::steady_clock::time_point start_;
+
+  TraceQueue uplink_;
+  DelayLine uplink_delay_;
+  DelayLine downlink_delay_;
+  TraceQueue downlink_;
+
+  std::vector<UDPSocket::received_datagram> batch_ {};
+  RelayResult result_ {};
+
+  uint64_t now_us( void ) const;
+  void write_log_header( void );
+
+  /* run both directions up to now */
+  void advance( const uint64_t now_us );
+
+public:
+  LinkRelay( const RelayConfig & config, const Address & listen_address,
+	     const Address & receiver_address );
+
+  /* no copying: the queues deliver through this */
+  LinkRelay( const LinkRelay & other ) = delete;
+  LinkRelay & operator=( const LinkRelay & other ) = delete;
+
+  /* Relay until the configured duration passes or SIGINT/SIGTERM */
+  RelayResult run( void );
+
+  Address local_address( void ) const { return sender_side_.local_address(); }
+};
+
+#endif /* LINK_RELAY_HH */
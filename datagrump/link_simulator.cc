@@ -0,0 +1,469 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+#include "link_simulator.hh"
+
+using namespace std;
+
+/* Sizes on the wire, including IP and UDP headers */
+static const uint32_t DATAGRAM_SIZE = 1500; /* 48-byte header + 1424-byte payload + 28 */
+static const uint32_t ACK_SIZE = 76;        /* 48-byte header + 28 */
+static const uint32_t OPPORTUNITY_BYTES = 1500;
+
+/* CoDel parameters (RFC 8289) */
+static const uint64_t CODEL_TARGET_US = 5000;
+static const uint64_t CODEL_INTERVAL_US = 100000;
+
+/*************** Simulation Config ******************/
+SimulationConfig::QueueType SimulationConfig::queue_type_from_name( const string & name )
+{
+  if ( name == "droptail" ) {
+    return QueueType::DropTail;
+  } else if ( name == "codel" ) {
+    return QueueType::CoDel;
+  }
+
+  throw runtime_error( "unknown queue type " + name + " (droptail or codel)" );
+}
+
+/*************** Link Trace ******************/
+LinkTrace::LinkTrace( const string & filename )
+{
+  ifstream trace( filename );
+  if ( not trace.is_open() ) {
+    throw runtime_error( "cannot open trace " + filename );
+  }
+
+  uint64_t timestamp;
+  while ( trace >> timestamp ) {
+    if ( not opportunities_.empty() and timestamp < opportunities_.back() ) {
+      throw runtime_error( filename + ": timestamps must not decrease" );
+    }
+    opportunities_.push_back( timestamp );
+  }
+
+  if ( opportunities_.empty() or opportunities_.back() == 0 ) {
+    throw runtime_error( filename + ": empty trace" );
+  }
+
+  period_ = opportunities_.back();
+}
+
+/* Index of the first opportunity at or after `time` ms */
+uint64_t LinkTrace::first_opportunity_at( const uint64_t time ) const
+{
+  const uint64_t pass = time / period_;
+  const uint64_t offset = time % period_;
+  const uint64_t index = lower_bound( opportunities_.begin(), opportunities_.end(), offset )
+    - opportunities_.begin();
+  return pass * opportunities_.size() + index;
+}
+
+/*************** Link Simulator ******************/
+LinkSimulator::LinkSimulator( const SimulationConfig & config, Controller & controller )
+  : config_( config ),
+    controller_( controller ),
+    links_ { Link( config.uplink ), Link( config.downlink ) }
+{
+  if ( not config_.uplink ) {
+    throw runtime_error( "LinkSimulator: no uplink trace" );
+  }
+}
+
+void LinkSimulator::schedule( const uint64_t time_us, const EventType type,
+			      const unsigned int link, const Packet & packet )
+{
+  events_.push( { time_us, event_order_++, type, link, timeout_generation_, packet } );
+}
+
+/* One trip around DatagrumpSender's poll loop */
+void LinkSimulator::sender_wake( void )
+{
+  sender_idle_ = false;
+  sender_pacing_ = false;
+
+  /* first rule: while the window is open, send (sleeping between datagrams) */
+  if ( loss_detector_.in_flight() < controller_.window_size() ) {
+    send_datagram();
+    const float pause_us = controller_.get_interpkt_delay();
+    const bool pause = isfinite( pause_us ) and pause_us > 0;
+    sender_pacing_ = pause;
+    schedule( now_us_ + (pause ? uint64_t( pause_us ) : 0), EventType::SenderWake );
+    return;
+  }
+
+  /* second rule: read the acks waiting (up to a batch), then poll again */
+  if ( not socket_buffer_.empty() ) {
+    read_acks();
+    schedule( now_us_, EventType::SenderWake );
+    return;
+  }
+
+  /* nothing to do: block in poll() until an ack or the timeout */
+  sender_idle_ = true;
+  timeout_generation_++;
+  schedule( now_us_ + rto_.timeout_us(), EventType::SenderTimeout );
+}
+
+/* poll() timed out: send one datagram to get things moving again
+   (DatagrumpSender::handle_timeout()) */
+void LinkSimulator::sender_timeout( const uint64_t generation )
+{
+  if ( not sender_idle_ or generation != timeout_generation_ ) {
+    return; /* an ack arrived first */
+  }
+
+  if ( rto_.timed_out() == RtoEstimator::Expiry::Probe ) {
+    result_.probes++;
+    send_datagram();
+    sender_wake();
+    return;
+  }
+  result_.timeouts++;
+
+  loss_detector_.timed_out( now_us_ / 1000 );
+  report_losses();
+
+  controller_.timed_out();
+  send_datagram();
+  sender_wake();
+}
+
+/* An ack reached the sender's socket */
+void LinkSimulator::sender_arrival( const Packet & ack )
+{
+  socket_buffer_.push_back( ack );
+  socket_buffer_.back().enqueue_time_us = now_us_; /* kernel receive timestamp */
+
+  if ( sender_pacing_ ) {
+    read_acks(); /* acks are read while waiting between paced datagrams */
+  } else if ( sender_idle_ ) {
+    timeout_generation_++;
+    sender_wake();
+  }
+}
+
+void LinkSimulator::send_datagram( void )
+{
+  const Packet datagram { sequence_number_++, now_us_, 0, now_us_, DATAGRAM_SIZE, false };
+  result_.datagrams_sent++;
+
+  controller_.datagram_was_sent( datagram.sequence_number, now_us_ / 1000 );
+  loss_detector_.datagram_sent( datagram.sequence_number, now_us_ / 1000 );
+
+  link_arrival( 0, datagram );
+}
+
+/* DatagrumpSender::read_acks() and got_ack() */
+void LinkSimulator::read_acks( void )
+{
+  ack_batch_.clear();
+  while ( ack_batch_.size() < UDPSocket::MAX_BATCH and not socket_buffer_.empty() ) {
+    const Packet & ack = socket_buffer_.front();
+    ack_batch_.push_back( { ack.sequence_number, ack.send_time_us / 1000,
+			    ack.recv_time_us / 1000, ack.enqueue_time_us / 1000 } );
+    socket_buffer_.pop_front();
+  }
+
+  controller_.acks_received( ack_batch_.data(), ack_batch_.size() );
+
+  for ( const auto & ack : ack_batch_ ) {
+    if ( loss_detector_.ack_received( ack.sequence_number_acked, ack.timestamp_ack_received )
+	 == LossDetector::AckType::Reordered ) {
+      controller_.reordering_detected( ack.sequence_number_acked, ack.timestamp_ack_received );
+      result_.reorderings++;
+    }
+    report_losses();
+
+    rto_.rtt_sample( (ack.timestamp_ack_received - ack.send_timestamp_acked) * 1000 );
+
+    const double window = controller_.window_size();
+    window_sum_ += window;
+    window_sum_squares_ += window * window;
+    window_change_sum_ += window_samples_ ? fabs( window - last_window_ ) : 0;
+    last_window_ = window;
+    window_samples_++;
+  }
+}
+
+/* DatagrumpSender::report_losses() */
+void LinkSimulator::report_losses( void )
+{
+  for ( const auto & lost : loss_detector_.newly_lost() ) {
+    controller_.datagram_lost( lost.sequence_number, lost.send_timestamp, now_us_ / 1000 );
+    result_.losses_detected++;
+  }
+}
+
+/* A packet reaches a link's queue */
+void LinkSimulator::link_arrival( const unsigned int link_index, Packet packet )
+{
+  Link & link = links_[ link_index ];
+
+  if ( not link.trace ) { /* unconstrained */
+    deliver( link_index, packet );
+    return;
+  }
+
+  if ( config_.queue_limit_packets and link.queue.size() >= config_.queue_limit_packets ) {
+    if ( not packet.is_ack ) {
+      result_.datagrams_dropped++;
+    }
+    return;
+  }
+
+  packet.enqueue_time_us = now_us_;
+  link.queue.push_back( packet );
+  schedule_service( link_index );
+}
+
+/* Arrange for the next delivery opportunity if packets are waiting */
+void LinkSimulator::schedule_service( const unsigned int link_index )
+{
+  Link & link = links_[ link_index ];
+
+  if ( link.service_scheduled or link.queue.empty() ) {
+    return;
+  }
+
+  /* packets can leave at the first opportunity at or after they arrive */
+  const uint64_t now_ms = (now_us_ + 999) / 1000;
+  link.next_opportunity = max( link.next_opportunity,
+			       link.trace->first_opportunity_at( now_ms ) );
+  link.service_scheduled = true;
+  schedule( link.trace->opportunity( link.next_opportunity ) * 1000,
+	    EventType::LinkService, link_index );
+}
+
+/* A delivery opportunity: send up to one MTU's worth of packets */
+void LinkSimulator::link_service( const unsigned int link_index )
+{
+  Link & link = links_[ link_index ];
+  link.service_scheduled = false;
+  link.next_opportunity++;
+
+  uint32_t budget = OPPORTUNITY_BYTES;
+  Packet packet;
+  while ( not link.queue.empty() and link.queue.front().size <= budget
+	  and dequeue( link, packet ) ) {
+    budget -= packet.size;
+    deliver( link_index, packet );
+  }
+
+  schedule_service( link_index );
+}
+
+/* CoDel's dodequeue(): pop the head, and say whether CoDel may drop it */
+bool LinkSimulator::codel_dequeue_one( Link & link, Packet & packet, bool & ok_to_drop )
+{
+  ok_to_drop = false;
+
+  if ( link.queue.empty() ) {
+    link.first_above_time_us = 0;
+    return false;
+  }
+
+  packet = link.queue.front();
+  link.queue.pop_front();
+
+  const uint64_t sojourn_us = now_us_ - packet.enqueue_time_us;
+  if ( sojourn_us < CODEL_TARGET_US ) {
+    link.first_above_time_us = 0;
+  } else if ( link.first_above_time_us == 0 ) {
+    link.first_above_time_us = now_us_ + CODEL_INTERVAL_US;
+  } else if ( now_us_ >= link.first_above_time_us ) {
+    ok_to_drop = true;
+  }
+
+  return true;
+}
+
+/* Take the next packet off a link's queue, applying the AQM */
+bool LinkSimulator::dequeue( Link & link, Packet & packet )
+{
+  if ( config_.queue_type == SimulationConfig::QueueType::DropTail ) {
+    if ( link.queue.empty() ) {
+      return false;
+    }
+    packet = link.queue.front();
+    link.queue.pop_front();
+    return true;
+  }
+
+  auto control_law = [] ( const uint64_t t, const uint64_t count ) {
+    return t + uint64_t( CODEL_INTERVAL_US / sqrt( double( count ) ) );
+  };
+  auto drop = [&] ( const Packet & dropped ) {
+    if ( not dropped.is_ack ) {
+      result_.datagrams_dropped++;
+    }
+  };
+
+  bool ok_to_drop;
+  bool have_packet = codel_dequeue_one( link, packet, ok_to_drop );
+
+  if ( link.dropping ) {
+    if ( not ok_to_drop ) {
+      link.dropping = false;
+    }
+    while ( have_packet and link.dropping and now_us_ >= link.drop_next_us ) {
+      drop( packet );
+      link.drop_count++;
+      have_packet = codel_dequeue_one( link, packet, ok_to_drop );
+      if ( not ok_to_drop ) {
+	link.dropping = false;
+      } else {
+	link.drop_next_us = control_law( link.drop_next_us, link.drop_count );
+      }
+    }
+  } else if ( have_packet and ok_to_drop ) {
+    drop( packet );
+    have_packet = codel_dequeue_one( link, packet, ok_to_drop );
+    link.dropping = true;
+    const uint64_t delta = link.drop_count - link.last_drop_count;
+    link.drop_count = (delta > 1 and now_us_ - link.drop_next_us < 16 * CODEL_INTERVAL_US)
+      ? delta : 1;
+    link.drop_next_us = control_law( now_us_, link.drop_count );
+    link.last_drop_count = link.drop_count;
+  }
+
+  return have_packet;
+}
+
+/* A packet leaves a link */
+void LinkSimulator::deliver( const unsigned int link_index, const Packet & packet )
+{
+  if ( link_index == 0 ) {
+    /* uplink, then propagation delay to the receiver */
+    queueing_delays_us_.push_back( now_us_ - packet.enqueue_time_us );
+    schedule( now_us_ + config_.one_way_delay_ms * 1000, EventType::ReceiverArrival, 0, packet );
+  } else {
+    /* downlink is the last hop before the sender; an aggregating
+       link holds acks and hands them over in bursts */
+    const uint64_t period_us = config_.ack_aggregation_ms * 1000;
+    const uint64_t release_us = period_us ? (now_us_ + period_us - 1) / period_us * period_us
+                                          : now_us_;
+    schedule( release_us, EventType::SenderArrival, 1, packet );
+  }
+}
+
+/* The receiver acknowledges every datagram */
+void LinkSimulator::receiver_arrival( const Packet & datagram )
+{
+  result_.datagrams_delivered++;
+  delays_us_.push_back( now_us_ - datagram.send_time_us );
+  check_full_rate();
+
+  /* stamped by the receiver's clock */
+  const int64_t receiver_clock_us = int64_t( now_us_ ) + config_.receiver_clock_offset_ms * 1000
+    + int64_t( now_us_ * config_.receiver_clock_drift_ppm / 1e6 );
+
+  const Packet ack { datagram.sequence_number, datagram.send_time_us,
+		     uint64_t( max<int64_t>( receiver_clock_us, 0 ) ),
+		     now_us_, ACK_SIZE, true };
+
+  /* propagation delay, then the downlink */
+  schedule( now_us_ + config_.one_way_delay_ms * 1000, EventType::LinkArrival, 1, ack );
+}
+
+/* Has the flow filled the link yet? Compares deliveries with the
+   uplink's delivery opportunities over the last propagation RTT. */
+void LinkSimulator::check_full_rate( void )
+{
+  if ( result_.time_to_full_rate_ms >= 0 ) {
+    return;
+  }
+
+  const uint64_t window_us = max<uint64_t>( 2 * config_.one_way_delay_ms, 10 ) * 1000;
+  recent_arrivals_us_.push_back( now_us_ );
+  while ( recent_arrivals_us_.front() + window_us <= now_us_ ) {
+    recent_arrivals_us_.pop_front();
+  }
+  if ( now_us_ < window_us ) {
+    return;
+  }
+
+  const uint64_t now_ms = now_us_ / 1000;
+  const uint64_t opportunities = config_.uplink->first_opportunity_at( now_ms + 1 )
+    - config_.uplink->first_opportunity_at( now_ms + 1 - window_us / 1000 );
+  if ( opportunities > 0 and recent_arrivals_us_.size() >= 0.9 * opportunities ) {
+    result_.time_to_full_rate_ms = now_us_ / 1000.0;
+    recent_arrivals_us_.clear();
+  }
+}
+
+/* 95th percentile of a sample set, in ms */
+static double p95_ms( vector<uint32_t> & samples_us )
+{
+  if ( samples_us.empty() ) {
+    return 0;
+  }
+  auto nth = samples_us.begin() + samples_us.size() * 95 / 100;
+  nth_element( samples_us.begin(), nth, samples_us.end() );
+  return *nth / 1000.0;
+}
+
+/* Run to the configured duration and score the run */
+SimulationResult LinkSimulator::run( void )
+{
+  const uint64_t duration_ms = config_.duration_ms ? config_.duration_ms
+                                                   : config_.uplink->period();
+  const uint64_t end_us = duration_ms * 1000;
+
+  schedule( 0, EventType::SenderWake );
+
+  while ( not events_.empty() and events_.top().time_us <= end_us ) {
+    const Event event = events_.top();
+    events_.pop();
+    now_us_ = event.time_us;
+
+    switch ( event.type ) {
+    case EventType::SenderWake:
+      sender_wake();
+      break;
+    case EventType::SenderTimeout:
+      sender_timeout( event.generation );
+      break;
+    case EventType::LinkArrival:
+      link_arrival( event.link, event.packet );
+      break;
+    case EventType::LinkService:
+      link_service( event.link );
+      break;
+    case EventType::ReceiverArrival:
+      receiver_arrival( event.packet );
+      break;
+    case EventType::SenderArrival:
+      sender_arrival( event.packet );
+      break;
+    }
+  }
+
+  /* score the run */
+  result_.duration_ms = duration_ms;
+  const uint64_t opportunities = config_.uplink->first_opportunity_at( duration_ms );
+  result_.capacity_mbps = double( opportunities ) * OPPORTUNITY_BYTES * 8 / (duration_ms * 1000.0);
+  result_.throughput_mbps = double( result_.datagrams_delivered ) * DATAGRAM_SIZE * 8
+    / (duration_ms * 1000.0);
+
+  if ( not delays_us_.empty() ) {
+    double sum = 0;
+    for ( const auto delay : delays_us_ ) {
+      sum += delay;
+    }
+    result_.mean_delay_ms = sum / delays_us_.size() / 1000.0;
+  }
+  result_.p95_delay_ms = p95_ms( delays_us_ );
+  result_.p95_queueing_delay_ms = p95_ms( queueing_delays_us_ );
+
+  if ( window_samples_ ) {
+    result_.mean_window = window_sum_ / window_samples_;
+    result_.window_stddev = sqrt( max( 0.0, window_sum_squares_ / window_samples_
+				       - result_.mean_window * result_.mean_window ) );
+    result_.window_jitter = window_change_sum_ / window_samples_;
+  }
+
+  return result_;
+}
@@ -0,0 +1,206 @@
+#ifndef LINK_SIMULATOR_HH
+#define LINK_SIMULATOR_HH
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "controller.hh"
+#include "loss_detector.hh"
+#include "rto_estimator.hh"
+#include "socket.hh"
+
+/* Packet delivery opportunities of a mahimahi trace: each line is a
+   millisecond timestamp at which the link can deliver one MTU-sized
+   (1500-byte) packet. The trace repeats once it runs out. */
+class LinkTrace
+{
+private:
+  std::vector<uint64_t> opportunities_ {};
+  uint64_t period_ {0};
+
+public:
+  LinkTrace( const std::string & filename );
+
+  /* Time (in ms) of the n-th delivery opportunity, counting repetitions */
+  uint64_t opportunity( const uint64_t n ) const
+  {
+    return opportunities_[ n % opportunities_.size() ]
+      + (n / opportunities_.size()) * period_;
+  }
+
+  /* Index of the first opportunity at or after `time` ms */
+  uint64_t first_opportunity_at( const uint64_t time ) const;
+
+  /* Length of one pass through the trace, in ms */
+  uint64_t period( void ) const { return period_; }
+
+  /* Average capacity, in opportunities per ms */
+  double rate( void ) const { return double( opportunities_.size() ) / period_; }
+};
+
+/* What the simulated network looks like */
+struct SimulationConfig
+{
+  std::shared_ptr<const LinkTrace> uplink {};   /* sender -> receiver (required) */
+  std::shared_ptr<const LinkTrace> downlink {}; /* receiver -> sender (optional) */
+  uint64_t one_way_delay_ms {20};               /* propagation, each direction */
+  enum class QueueType { DropTail, CoDel } queue_type {QueueType::DropTail};
+  uint64_t queue_limit_packets {0};             /* 0 = unlimited */
+  uint64_t duration_ms {0};                     /* 0 = one pass of the uplink trace */
+  int64_t receiver_clock_offset_ms {0};         /* receiver's clock minus sender's, at start */
+  double receiver_clock_drift_ppm {0};          /* how much faster the receiver's clock runs */
+  uint64_t ack_aggregation_ms {0};              /* release acks to the sender only at
+						   multiples of this (0 = as they come) */
+
+  static QueueType queue_type_from_name( const std::string & name );
+};
+
+/* Scoring of a run, in the terms mm-throughput-graph uses */
+struct SimulationResult
+{
+  uint64_t duration_ms {0};
+  uint64_t datagrams_sent {0};
+  uint64_t datagrams_delivered {0};
+  uint64_t datagrams_dropped {0};
+  uint64_t losses_detected {0};        /* by the sender's LossDetector */
+  uint64_t reorderings {0};            /* acks for datagrams declared lost */
+  uint64_t timeouts {0};               /* RTO expiries */
+  uint64_t probes {0};                 /* tail-loss probes */
+  double capacity_mbps {0};
+  double throughput_mbps {0};
+  double mean_delay_ms {0};            /* one-way: send to arrival at receiver */
+  double p95_delay_ms {0};
+  double p95_queueing_delay_ms {0};    /* time spent in the bottleneck queue */
+  double mean_window {0};              /* controller's window, sampled at each ack read */
+  double window_stddev {0};
+  double window_jitter {0};            /* mean change in window from one ack to the next */
+  double time_to_full_rate_ms {-1};    /* when deliveries over one propagation RTT first
+					  reached 90% of the link's capacity (-1 = never) */
+
+  double utilization( void ) const { return capacity_mbps > 0 ? throughput_mbps / capacity_mbps : 0; }
+
+  /* throughput over 95th-percentile delay, in Mbps per second of delay */
+  double power( void ) const { return p95_delay_ms > 0 ? throughput_mbps / (p95_delay_ms / 1000.0) : 0; }
+};
+
+/* Discrete-event simulation of DatagrumpSender, a receiver and a
+   trace-driven bottleneck link, in virtual time. The sender side
+   mirrors DatagrumpSender::loop(): it sends (paced by the controller,
+   reading acks between datagrams) while the window is open, reads the
+   acks waiting (up to a batch) per poll, and sends one datagram after
+   its RtoEstimator's timeout without any event. */
+class LinkSimulator
+{
+public:
+  /* a datagram or an ack in flight */
+  struct Packet {
+    uint64_t sequence_number;
+    uint64_t send_time_us;     /* sender's send time (for datagrams and the acks of them) */
+    uint64_t recv_time_us;     /* arrival at the receiver (acks only) */
+    uint64_t enqueue_time_us;  /* arrival at the current queue */
+    uint32_t size;
+    bool is_ack;
+  };
+
+private:
+  /* a trace-driven queue, or a plain delay line if there is no trace */
+  struct Link {
+    std::shared_ptr<const LinkTrace> trace;
+    std::deque<Packet> queue {};
+    uint64_t next_opportunity {0};
+    bool service_scheduled {false};
+
+    /* CoDel state (RFC 8289) */
+    bool dropping {false};
+    uint64_t first_above_time_us {0};
+    uint64_t drop_next_us {0};
+    uint64_t drop_count {0};
+    uint64_t last_drop_count {0};
+
+    Link( const std::shared_ptr<const LinkTrace> & s_trace ) : trace( s_trace ) {}
+  };
+
+  enum class EventType { SenderWake, SenderTimeout, LinkArrival, LinkService,
+			 ReceiverArrival, SenderArrival };
+
+  struct Event {
+    uint64_t time_us;
+    uint64_t order;         /* FIFO among simultaneous events */
+    EventType type;
+    unsigned int link;      /* 0 = uplink, 1 = downlink */
+    uint64_t generation;    /* invalidates stale timeouts */
+    Packet packet;
+
+    bool operator>( const Event & other ) const
+    {
+      return time_us != other.time_us ? time_us > other.time_us : order > other.order;
+    }
+  };
+
+  SimulationConfig config_;
+  Controller & controller_;
+
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events_ {};
+  uint64_t event_order_ {0};
+  uint64_t now_us_ {0};
+
+  Link links_[ 2 ];
+
+  /* sender state, as in DatagrumpSender */
+  uint64_t sequence_number_ {0};
+  LossDetector loss_detector_ {};
+  RtoEstimator rto_ {};
+  std::deque<Packet> socket_buffer_ {}; /* acks received but not yet read */
+  std::vector<Ack> ack_batch_ {};       /* the acks read together last */
+  bool sender_idle_ {false};            /* blocked in poll() waiting for an ack */
+  bool sender_pacing_ {false};          /* waiting to send the next paced datagram */
+  uint64_t timeout_generation_ {0};
+
+  /* measurements */
+  SimulationResult result_ {};
+  std::vector<uint32_t> delays_us_ {};
+  std::vector<uint32_t> queueing_delays_us_ {};
+  double window_sum_ {0}, window_sum_squares_ {0}, window_change_sum_ {0};
+  double last_window_ {0};
+  uint64_t window_samples_ {0};
+  std::deque<uint64_t> recent_arrivals_us_ {}; /* until the flow reaches full rate */
+
+  void schedule( const uint64_t time_us, const EventType type,
+		 const unsigned int link = 0, const Packet & packet = Packet() );
+
+  /* sender */
+  void sender_wake( void );
+  void sender_timeout( const uint64_t generation );
+  void sender_arrival( const Packet & ack );
+  void send_datagram( void );
+  void read_acks( void );
+  void report_losses( void );
+
+  /* links */
+  void link_arrival( const unsigned int link, Packet packet );
+  void link_service( const unsigned int link );
+  void schedule_service( const unsigned int link );
+  bool codel_dequeue_one( Link & link, Packet & packet, bool & ok_to_drop );
+  bool dequeue( Link & link, Packet & packet );
+  void deliver( const unsigned int link, const Packet & packet );
+
+  /* endpoints */
+  void receiver_arrival( const Packet & packet );
+  void check_full_rate( void );
+
+public:
+  LinkSimulator( const SimulationConfig & config, Controller & controller );
+
+  /* Run to the configured duration and score the run */
+  SimulationResult run( void );
+
+  /* forbid copying LinkSimulator objects or assigning them */
+  LinkSimulator( const LinkSimulator & other ) = delete;
+  const LinkSimulator & operator=( const LinkSimulator & other ) = delete;
+};
+
+#endif /* LINK_SIMULATOR_HH */
@@ -0,0 +1,93 @@
+/* relay between sender and receiver through an emulated mahimahi link */
+
+#include <cstdlib>
+#include <iostream>
+
+#include <getopt.h>
+
+#include "link_relay.hh"
+
+using namespace std;
+
+static void usage( const char * const argv0 )
+{
+  cerr << "Usage: " << argv0 << " [options] PORT RECEIVER_HOST RECEIVER_PORT UPLINK_TRACE" << endl
+       << "  -d, --delay=MS           one-way propagation delay (default 20)" << endl
+       << "  -D, --downlink=TRACE     trace for the ack direction (default unconstrained)" << endl
+       << "  -l, --queue-limit=PKTS   bottleneck queue limit (default unlimited)" << endl
+       << "  -t, --duration=MS        stop after this long (default when interrupted)" << endl
+       << "      --once               stop after one pass of the uplink trace" << endl
+       << "  -L, --uplink-log=FILE    log the uplink in mahimahi's format" << endl
+       << "The sender sends to PORT, as if the receiver were there." << endl;
+}
+
+int main( int argc, char *argv[] )
+{
+  /* check the command-line arguments */
+  if ( argc < 1 ) { /* for sticklers */
+    abort();
+  }
+
+  const option options[] = {
+    { "delay",       required_argument, nullptr, 'd' },
+    { "downlink",    required_argument, nullptr, 'D' },
+    { "queue-limit", required_argument, nullptr, 'l' },
+    { "duration",    required_argument, nullptr, 't' },
+    { "once",        no_argument,       nullptr, 'o' },
+    { "uplink-log",  required_argument, nullptr, 'L' },
+    { nullptr,       0,                 nullptr, 0 }
+  };
+
+  try {
+    RelayConfig config;
+    bool once = false;
+
+    for ( int i = 0; i < argc; i++ ) {
+      config.command_line += (i ? " " : "") + string( argv[ i ] );
+    }
+
+    int opt;
+    while ( (opt = getopt_long( argc, argv, "d:D:l:t:L:", options, nullptr )) != -1 ) {
+      switch ( opt ) {
+      case 'd': config.one_way_delay_ms = strtoull( optarg, nullptr, 10 ); break;
+      case 'D': config.downlink = make_shared<LinkTrace>( optarg ); break;
+      case 'l': config.queue_limit_packets = strtoull( optarg, nullptr, 10 ); break;
+      case 't': config.duration_ms = strtoull( optarg, nullptr, 10 ); break;
+      case 'o': once = true; break;
+      case 'L': config.uplink_log = optarg; break;
+      default:
+	usage( argv[ 0 ] );
+	return EXIT_FAILURE;
+      }
+    }
+
+    if ( argc - optind != 4 ) {
+      usage( argv[ 0 ] );
+      return EXIT_FAILURE;
+    }
+
+    const string port = argv[ optind ];
+    const Address receiver( argv[ optind + 1 ], argv[ optind + 2 ] );
+    config.uplink = make_shared<LinkTrace>( argv[ optind + 3 ] );
+
+    if ( once ) {
+      config.duration_ms = config.uplink->period();
+    }
+
+    LinkRelay relay( config, Address( "::0", port ), receiver );
+
+    cerr << "Relaying " << relay.local_address().to_string() << " to "
+	 << receiver.to_string() << endl;
+
+    const RelayResult result = relay.run();
+
+    cerr << "Relayed " << result.datagrams_relayed << " datagrams ("
+	 << result.datagrams_dropped << " dropped) and " << result.acks_relayed
+	 << " acks over " << result.duration_ms / 1000.0 << " s" << endl;
+  } catch ( const exception & e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
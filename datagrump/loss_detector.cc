@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "loss_detector.hh"
+
+using namespace std;
+
+/* How far past the latest RTT a datagram may be acked before it counts as lost (ms) */
+uint64_t LossDetector::reordering_window( void ) const
+{
+  return max<uint64_t>( reordering_multiple_ * min_rtt_ / 4, 1 );
+}
+
+void LossDetector::datagram_sent( const uint64_t sequence_number, const uint64_t send_timestamp )
+{
+  if ( not datagrams_.empty()
+       and sequence_number != datagrams_.back().sequence_number + 1 ) {
+    throw runtime_error( "LossDetector: datagrams must be sent in sequence" );
+  }
+
+  datagrams_.push_back( { sequence_number, send_timestamp, Datagram::State::InFlight } );
+  in_flight_++;
+}
+
+void LossDetector::declare_lost( Datagram & datagram, const uint64_t timestamp )
+{
+  datagram.state = Datagram::State::Lost;
+  in_flight_--;
+  lost_++;
+  newly_lost_.push_back( datagram );
+  recently_lost_.push_back( { datagram.sequence_number, timestamp } );
+}
+
+/* Forget settled datagrams at the front, and losses too old for a
+   reordered ack to still be on its way */
+void LossDetector::settle( const uint64_t timestamp )
+{
+  while ( not datagrams_.empty() and datagrams_.front().state != Datagram::State::InFlight ) {
+    datagrams_.pop_front();
+  }
+
+  const uint64_t horizon = 4 * (rack_rtt_ + reordering_window());
+  while ( not recently_lost_.empty() and recently_lost_.front().timestamp + horizon < timestamp ) {
+    recently_lost_.pop_front();
+  }
+}
+
+/* An ack for a datagram no longer in datagrams_ */
+LossDetector::AckType LossDetector::late_ack( const uint64_t sequence_number_acked )
+{
+  size_t declared = 0;
+  while ( declared < recently_lost_.size()
+	  and recently_lost_[ declared ].sequence_number != sequence_number_acked ) {
+    declared++;
+  }
+  if ( declared == recently_lost_.size() ) {
+    return AckType::Duplicate;
+  }
+
+  recently_lost_.erase( declared );
+  reordered_++;
+  reordering_multiple_ = min( reordering_multiple_ + 1, MAX_REORDERING_MULTIPLE );
+  return AckType::Reordered;
+}
+
+LossDetector::AckType LossDetector::ack_received( const uint64_t sequence_number_acked,
+						  const uint64_t timestamp )
+{
+  newly_lost_.clear();
+
+  if ( datagrams_.empty() or sequence_number_acked < datagrams_.front().sequence_number ) {
+    return late_ack( sequence_number_acked );
+  }
+
+  const uint64_t index = sequence_number_acked - datagrams_.front().sequence_number;
+  if ( index >= datagrams_.size() ) {
+    return AckType::Duplicate; /* never sent */
+  }
+
+  Datagram & acked = datagrams_[ index ];
+  if ( acked.state == Datagram::State::Acked ) {
+    return AckType::Duplicate;
+  }
+
+  AckType type = AckType::New;
+  if ( acked.state == Datagram::State::Lost ) {
+    /* still counted in recently_lost_, which late_ack() settles */
+    type = late_ack( sequence_number_acked );
+  } else {
+    in_flight_--;
+  }
+  acked.state = Datagram::State::Acked;
+
+  /* RACK: the most recently sent datagram known to be delivered */
+  const uint64_t rtt = timestamp > acked.send_timestamp ? timestamp - acked.send_timestamp : 0;
+  min_rtt_ = have_rack_ ? min( min_rtt_, rtt ) : rtt;
+  if ( not have_rack_ or sequence_number_acked > rack_sequence_number_ ) {
+    have_rack_ = true;
+    rack_sequence_number_ = sequence_number_acked;
+    rack_rtt_ = rtt;
+  }
+
+  /* how many datagrams after each one have been acked (all of them
+     are still in datagrams_, behind the oldest one in flight) */
+  uint64_t acked_after = 0;
+  for ( size_t i = 0; i < datagrams_.size(); i++ ) {
+    if ( datagrams_[ i ].state == Datagram::State::Acked ) {
+      acked_after++;
+    }
+  }
+
+  /* anything sent before it and still outstanding may be lost; once
+     reordering has been seen, only the time threshold counts */
+  const uint64_t deadline = rack_rtt_ + reordering_window();
+  for ( size_t i = 0; i < datagrams_.size(); i++ ) {
+    Datagram & datagram = datagrams_[ i ];
+    if ( datagram.sequence_number >= rack_sequence_number_ ) {
+      break;
+    }
+    if ( datagram.state == Datagram::State::Acked ) {
+      acked_after--;
+    } else if ( datagram.state == Datagram::State::InFlight
+		and ( (reordered_ == 0 and acked_after >= DUP_THRESH)
+		      or datagram.send_timestamp + deadline <= timestamp ) ) {
+      declare_lost( datagram, timestamp );
+    }
+  }
+
+  settle( timestamp );
+  return type;
+}
+
+void LossDetector::timed_out( const uint64_t timestamp )
+{
+  newly_lost_.clear();
+
+  const uint64_t deadline = rack_rtt_ + reordering_window();
+  for ( size_t i = 0; i < datagrams_.size(); i++ ) {
+    Datagram & datagram = datagrams_[ i ];
+    if ( datagram.state == Datagram::State::InFlight
+	 and datagram.send_timestamp + deadline <= timestamp ) {
+      declare_lost( datagram, timestamp );
+    }
+  }
+
+  settle( timestamp );
+}
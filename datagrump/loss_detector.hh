@@ -0,0 +1,95 @@
+#ifndef LOSS_DETECTOR_HH
+#define LOSS_DETECTOR_HH
+
+#include <cstdint>
+#include <vector>
+
+#include "ring_buffer.hh"
+
+/* The sender's record of every datagram it has sent and not yet
+   settled, and when each one counts as lost (RACK-style, RFC 8985).
+   A datagram still in flight is declared lost once either
+   - duplicate threshold: DUP_THRESH datagrams sent after it have been
+     acked (until any reordering is seen, as RFC 8985 stops using it), or
+   - time threshold: a datagram sent after it has been acked, and it has
+     gone unacked for the latest RTT plus a reordering window,
+   or, at a timeout, once it has been out that long at all (the tail of
+   a burst has no later datagram to be acked).
+   Acks for datagrams already declared lost were reordered, not lost:
+   each one widens the reordering window (up to 4 times its base of a
+   quarter min RTT, and at least 1 ms). */
+class LossDetector
+{
+public:
+  struct Datagram {
+    uint64_t sequence_number;
+    uint64_t send_timestamp;   /* ms */
+    enum class State : uint8_t { InFlight, Acked, Lost } state;
+  };
+
+  /* What an ack said about its datagram */
+  enum class AckType { New, Duplicate, Reordered };
+
+private:
+  static const unsigned int DUP_THRESH = 3;
+  static const unsigned int MAX_REORDERING_MULTIPLE = 4;
+
+  /* datagrams the records below start with room for: more than the
+     controllers' windows reach in practice, so they do not grow
+     mid-transfer */
+  static const size_t WINDOW_CAPACITY = 1 << 14;
+
+  /* every datagram from the oldest unsettled one on, by sequence number */
+  Fifo<Datagram> datagrams_ { WINDOW_CAPACITY };
+  uint64_t in_flight_ {0};
+
+  /* the most recently sent datagram known to be delivered */
+  bool have_rack_ {false};
+  uint64_t rack_sequence_number_ {0};
+  uint64_t rack_rtt_ {0};
+  uint64_t min_rtt_ {0};
+  unsigned int reordering_multiple_ {1};
+
+  /* datagrams declared lost by the last call, reused to avoid allocation */
+  std::vector<Datagram> newly_lost_ {};
+
+  /* sequence numbers declared lost lately, and when, so a late ack can
+     be recognised as reordering */
+  struct Declared {
+    uint64_t sequence_number;
+    uint64_t timestamp;
+  };
+  Fifo<Declared> recently_lost_ { WINDOW_CAPACITY };
+
+  uint64_t lost_ {0}, reordered_ {0};
+
+  uint64_t reordering_window( void ) const;
+  void declare_lost( Datagram & datagram, const uint64_t timestamp );
+  void settle( const uint64_t timestamp );
+  AckType late_ack( const uint64_t sequence_number_acked );
+
+public:
+  LossDetector() { newly_lost_.reserve( WINDOW_CAPACITY ); }
+
+  /* A datagram was sent (sequence numbers must be consecutive) */
+  void datagram_sent( const uint64_t sequence_number, const uint64_t send_timestamp );
+
+  /* An ack arrived at `timestamp` (ms); check for losses it reveals */
+  AckType ack_received( const uint64_t sequence_number_acked, const uint64_t timestamp );
+
+  /* The sender timed out: give up on everything out longer than the
+     latest RTT plus the reordering window */
+  void timed_out( const uint64_t timestamp );
+
+  /* Datagrams declared lost by the last ack_received() or timed_out() */
+  const std::vector<Datagram> & newly_lost( void ) const { return newly_lost_; }
+
+  /* Datagrams sent and neither acked nor declared lost */
+  uint64_t in_flight( void ) const { return in_flight_; }
+
+  /* Totals: datagrams declared lost, and acks for datagrams that had been */
+  uint64_t lost( void ) const { return lost_; }
+  uint64_t reordered( void ) const { return reordered_; }
+};
+
+#endif /* LOSS_DETECTOR_HH */
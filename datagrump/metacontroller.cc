@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
 
 #include "metacontroller.hh"
 #include "timestamp.hh"
@@ -13,6 +15,43 @@ MetaController::MetaController( const bool debug )
     bw_window_ ( BwWindow(debug) )
 {}
 
+MetaController::MetaController( const bool debug,
+    const Params & params )
+  : Controller ( debug ),
+    params_ ( params ),
+    rtt_window_ ( RttWindow(debug) ),
+    delivery_window_ ( DeliveryWindow(debug) ),
+    bw_window_ ( BwWindow(debug) ),
+    startup_ ( params.startup_gain )
+{
+  if (params_.gamma_vals.empty()) {
+    throw runtime_error( "MetaController: empty pacing cycle" );
+  }
+  if (params_.startup == 0) {
+    startup_.end("disabled");
+  }
+}
+
+/* Set a parameter by name */
+bool MetaController::Params::set( const string & name, const float value )
+{
+  if (name == "alpha") { alpha = value; }
+  else if (name == "lambda") { lambda = value; }
+  else if (name == "rtt_grad_gain") { rtt_grad_gain = value; }
+  else if (name == "delay_thresh") { delay_thresh = value; }
+  else if (name == "grad_penalty") { grad_penalty = value; }
+  else if (name == "pacing_gain") { pacing_gain = value; }
+  else if (name == "bw_window_rtts") { bw_window_rtts = value; }
+  else if (name == "startup") { startup = value; }
+  else if (name == "startup_gain") { startup_gain = value; }
+  else if (name.size() == 6 && name.compare(0, 5, "gamma") == 0 &&
+           name[5] >= '0' && name[5] < char('0' + gamma_vals.size())) {
+    gamma_vals[name[5] - '0'] = value;
+  }
+  else { return false; }
+  return true;
+}
+
 
 /* Get current window size, in datagrams */
 unsigned int MetaController::window_size( void )
@@ -27,6 +66,20 @@ unsigned int MetaController::window_size( void )
 }
 
 
+/* A datagram was sent */
+void MetaController::datagram_was_sent( const uint64_t sequence_number,
+				    /* of the sent datagram */
+				    const uint64_t send_timestamp )
+                                    /* in milliseconds */
+{
+  startup_.datagram_was_sent(sequence_number);
+
+  if ( debug_ ) {
+    cerr << "At time " << send_timestamp
+	 << " sent datagram " << sequence_number << endl;
+  }
+}
+
 /* An ack was received */
 void MetaController::ack_received( const uint64_t sequence_number_acked,
 			       /* what sequence number was acknowledged */
@@ -37,11 +90,45 @@ void MetaController::ack_received( const uint64_t sequence_number_acked,
 			       const uint64_t timestamp_ack_received )
                                /* when the ack was received (by sender) */
 {
-  // auto prev_cwnd = cwnd_;
+  const Ack ack {sequence_number_acked, send_timestamp_acked,
+                 recv_timestamp_acked, timestamp_ack_received};
+  acks_received(&ack, 1);
+}
+
+/* A burst of acks: every ack updates the estimators (and startup), but
+   the window is set once, from the state after the last one */
+void MetaController::acks_received( const Ack * const acks, const size_t count )
+{
+  if (count == 0) {
+    return;
+  }
+
+  const float prev_cwnd = cwnd_;
+  const bool starting = startup_.active();
 
+  uint64_t rtt_t = 0;
+  for (size_t i = 0; i < count; i++) {
+    rtt_t = update_samples(acks[i]);
+    if (startup_.active()) {
+      startup_.ack_received(acks[i].sequence_number_acked, curr_max_bw_, rtt_t, min_rtt_);
+    }
+  }
+
+  update_window(prev_cwnd, rtt_t, starting);
+
+  if ( debug_ ) {
+    cerr << "At time " << acks[count - 1].timestamp_ack_received
+	 << " after " << count << " acks, min_rtt " << min_rtt_
+	 << ", cwnd " << cwnd_ << endl;
+  }
+}
+
+/* Feed one ack to the estimators; returns its RTT */
+uint64_t MetaController::update_samples( const Ack & ack )
+{
   /* Get latest RTT */
-  uint64_t rtt_t = timestamp_ack_received - send_timestamp_acked;
-  srtt_ = alpha_ * srtt_ + (1 - alpha_) * rtt_t;
+  uint64_t rtt_t = ack.timestamp_ack_received - ack.send_timestamp_acked;
+  srtt_ = params_.alpha * srtt_ + (1 - params_.alpha) * rtt_t;
 
   min_rtt_ = rtt_window_.min_rtt();
   if (min_rtt_ == 0) {
@@ -49,32 +136,56 @@ void MetaController::ack_received( const uint64_t sequence_number_acked,
   }
 
   auto rtt_grad_t = ((float)rtt_t - rtt_window_.last_rtt())/min_rtt_;
-  rtt_grad_ = (1 - 0.5) * rtt_grad_ + 0.5 * rtt_grad_t;
+  rtt_grad_ = (1 - params_.rtt_grad_gain) * rtt_grad_
+    + params_.rtt_grad_gain * rtt_grad_t;
 
   /* Update RTT samples */
-  rtt_window_.update_rtt_samples(timestamp_ack_received, rtt_t);
+  rtt_window_.update_rtt_samples(ack.timestamp_ack_received, rtt_t);
 
   /* Measure bandwidth */
   auto total_delivered = delivery_window_.get_curr_delivered() + 1;
-  delivery_window_.update_delivery_data(timestamp_ack_received, total_delivered);
+  delivery_window_.update_delivery_data(ack.timestamp_ack_received, total_delivered);
   auto delivered_at_sendts =
-    delivery_window_.get_delivered(send_timestamp_acked);
+    delivery_window_.get_delivered(ack.send_timestamp_acked);
   auto bw_t = (float)(total_delivered - delivered_at_sendts.second)/
-    (timestamp_ack_received - delivered_at_sendts.first);
+    (ack.timestamp_ack_received - delivered_at_sendts.first);
 
   /* Update BW samples */
-  bw_window_.update_bw_samples(timestamp_ack_received, bw_t);
+  bw_window_.update_bw_samples(ack.timestamp_ack_received, bw_t);
   curr_max_bw_ = bw_window_.max_bw();
 
   /* Update packet pacing state */
-  if (timestamp_ack_received - last_gamma_update_ > min_rtt_) {
-    gamma_state_ = (gamma_state_ + 1)%5;
-    last_gamma_update_ = timestamp_ack_received;
+  if (ack.timestamp_ack_received - last_gamma_update_ > min_rtt_) {
+    gamma_state_ = (gamma_state_ + 1)%params_.gamma_vals.size();
+    last_gamma_update_ = ack.timestamp_ack_received;
   }
 
-  /* BDP and cwnd */
   bdp_ = curr_max_bw_ * min_rtt_;
-  cwnd_ =  lambda_ * bdp_;
+
+  if (debug_) {
+    cerr << "time " << ack.timestamp_ack_received
+      << " bw_t " << bw_t << " pkt/s"
+      << " rtt_t " << rtt_t << " ms"
+      << " srtt_t " << srtt_ << " ms"
+      << " max_bw " << curr_max_bw_ << " pkts/ms"
+      << " min_rtt " << min_rtt_ << " ms"
+      << " bdp " << bdp_ << " pkts" << endl;
+    cerr << "At time " << ack.timestamp_ack_received
+	 << " received ack for datagram " << ack.sequence_number_acked
+	 << " (send @ time " << ack.send_timestamp_acked
+	 << ", received @ time " << ack.recv_timestamp_acked << " by receiver's clock)"
+	 << endl;
+  }
+
+  return rtt_t;
+}
+
+/* Set the window from the estimators and the latest RTT */
+void MetaController::update_window( const float prev_cwnd, const uint64_t rtt_t,
+                                    const bool starting )
+{
+  /* BDP and cwnd */
+  cwnd_ =  params_.lambda * bdp_;
 
   //rtt_thresh_ = min_rtt_;
 
@@ -94,7 +205,7 @@ void MetaController::ack_received( const uint64_t sequence_number_acked,
   //  cwnd_ /= (rtt_t/min_rtt_);
   //
 
-  if (rtt_t > 1.1 * min_rtt_) {
+  if (rtt_t > params_.delay_thresh * min_rtt_) {
     //cwnd_ /= (1.0*rtt_t/min_rtt_)*(1.0*rtt_t/min_rtt_);
     cwnd_ /= exp(((float)rtt_t/min_rtt_) - 1);
   }
@@ -106,21 +217,21 @@ void MetaController::ack_received( const uint64_t sequence_number_acked,
   }
 
   if (rtt_grad_ > 0) {
-    cwnd_ *= (1.0 - 2*rtt_grad_);
+    cwnd_ *= (1.0 - params_.grad_penalty*rtt_grad_);
   }
+
+  /* Startup overrides the model: grow to gain * BDP, never shrinking */
+  if (startup_.active()) {
+    cwnd_ = max(prev_cwnd, startup_.gain() * bdp_);
+  }
+  else if (starting and debug_) {
+    cerr << "Startup over after " << startup_.rounds() << " rounds ("
+	 << startup_.exit_reason() << "), max_bw " << curr_max_bw_ << endl;
+  }
+
   /* Ensure window >= 3 */
   cwnd_ = cwnd_ < 3 ? 3 : cwnd_;
 
-  if (debug_) {
-    cerr << "time " << timestamp_ack_received
-      << " bw_t " << bw_t << " pkt/s"
-      << " rtt_t " << rtt_t << " ms"
-      << " srtt_t " << srtt_ << " ms"
-      << " max_bw " << curr_max_bw_ << " pkts/ms"
-      << " min_rtt " << min_rtt_ << " ms"
-      << " bdp " << bdp_ << " pkts"
-	    << ", cwnd " << cwnd_ << endl;
-  }
   /* Conservative approach */
   /*
   if (cwnd_ >= prev_cwnd && conservative_mode_) {
@@ -138,16 +249,7 @@ void MetaController::ack_received( const uint64_t sequence_number_acked,
     //cerr << "conservative true" << endl;
   }
   */
-  bw_window_.update_bw_window_size(5 * min_rtt_);
-
-  if ( debug_ ) {
-    cerr << "At time " << timestamp_ack_received
-	 << " received ack for datagram " << sequence_number_acked
-	 << " (send @ time " << send_timestamp_acked
-	 << ", received @ time " << recv_timestamp_acked << " by receiver's clock)"
-	 << ", min_rtt " << min_rtt_
-	 << ", cwnd " << cwnd_ << endl;
-  }
+  bw_window_.update_bw_window_size(params_.bw_window_rtts * min_rtt_);
 }
 
 /* An ack was received */
@@ -155,24 +257,55 @@ void MetaController::timed_out()
   /* when time put happens */
 {
   //cwnd_ = 3;
+  startup_.end("timeout");
 
   if ( debug_ ) {
     cerr << "Timed out. cwnd: " << cwnd_ << endl;
   }
 }
 
-/* Wait for some time between sending packets */
-float MetaController::get_interpkt_delay( void )
+/* Start from a cached path estimate (see LatteController::warm_start) */
+void MetaController::warm_start( const PathEstimate & estimate )
 {
-  return 1./curr_max_bw_ * gamma_vals_[gamma_state_] * 1000 * 0.9;
+  const float bw = estimate.confidence * estimate.max_bw;
+  if (bw <= 0 or estimate.min_rtt_ms <= 0) {
+    return;
+  }
+
+  min_rtt_ = estimate.min_rtt_ms;
+  srtt_ = estimate.min_rtt_ms;
+  curr_max_bw_ = bw;
+  bw_window_.update_bw_samples(timestamp_ms(), bw);
+  bdp_ = bw * min_rtt_;
+  cwnd_ = max(3.0f, params_.lambda * bdp_);
+  if (estimate.confidence >= 0.5) {
+    startup_.end("warm start");
+  }
+
+  if ( debug_ ) {
+    cerr << "Warm start: min_rtt " << min_rtt_ << " ms, bw " << bw
+	 << " pkts/ms (confidence " << estimate.confidence << "), cwnd " << cwnd_ << endl;
+  }
 }
 
+/* Min RTT and max bandwidth measured so far */
+bool MetaController::path_estimate( PathEstimate & estimate )
+{
+  if (delivery_window_.get_curr_delivered() == 0) {
+    return false;
+  }
+  estimate.min_rtt_ms = max<float>(1, min_rtt_); /* ms timestamps: 0 means < 1 ms */
+  estimate.max_bw = curr_max_bw_;
+  return true;
+}
 
-/* How long to wait (in milliseconds) if there are no acks
-   before sending one more datagram */
-unsigned int MetaController::timeout_ms( void )
+/* Wait for some time between sending packets */
+float MetaController::get_interpkt_delay( void )
 {
-  return static_cast<unsigned int>(2 * min_rtt_);
+  if (startup_.active()) {
+    return startup_.interpkt_delay(curr_max_bw_, cwnd_, min_rtt_);
+  }
+  return 1./curr_max_bw_ * params_.gamma_vals[gamma_state_] * 1000 * params_.pacing_gain;
 }
 
 
@@ -185,38 +318,36 @@ RttWindow::RttWindow( const bool debug )
 /* Update RTT samples */
 void RttWindow::update_rtt_samples( uint64_t curr_time,
         uint64_t rtt_sample ){
-  rtt_samples_.push_back(std::make_pair(curr_time, rtt_sample));
-
-  /* Remove old entries */
-  if (curr_time < rtt_sample_window_) {
-    return;
-  }
-  while (rtt_samples_.front().first < curr_time - rtt_sample_window_) {
-    rtt_samples_.pop_front();
-  }
+  min_rtt_filter_.update(curr_time, rtt_sample);
+  standing_rtt_filter_.update(curr_time, rtt_sample);
+  last_rtt_ = rtt_sample;
+  last_update_ = curr_time;
 }
 
 
 /* Return minimum of the RTT samples */
 uint64_t RttWindow::min_rtt( void ) {
-  std::deque<pair<uint64_t, uint64_t>>::iterator min_elem = std::min_element(
-      rtt_samples_.begin(),
-      rtt_samples_.end(),
-      [](std::pair<uint64_t, uint64_t> &left,
-        std::pair<uint64_t, uint64_t> &right) { return left.second < right.second;});
-  const auto &min_rtt = min_elem->second;
-  rtt_sample_window_ = min_rtt * 100;
+  if (min_rtt_filter_.empty()) {
+    return 0;
+  }
+  const auto &min_rtt = min_rtt_filter_.best();
+  min_rtt_filter_.set_window(min_rtt * 100);
   return min_rtt;
 }
 
 /* Return latest RTT samples */
 uint64_t RttWindow::last_rtt( void ) {
-  if (!rtt_samples_.empty()){
-    return rtt_samples_.back().second;
-  }
-  else {
-    return 100;
+  return last_rtt_;
+}
+
+/* Return minimum RTT over the last `window` ms */
+uint64_t RttWindow::standing_rtt( uint64_t window ) {
+  if (standing_rtt_filter_.empty()) {
+    return 0;
   }
+  standing_rtt_filter_.set_window(window);
+  standing_rtt_filter_.expire(last_update_);
+  return standing_rtt_filter_.best();
 }
 
 
@@ -230,14 +361,14 @@ DeliveryWindow::DeliveryWindow( const bool debug )
 void DeliveryWindow::update_delivery_data( uint64_t curr_time,
         uint64_t delivered ){
   if (!delivery_data_.empty() &&
-      delivery_data_.back().first == curr_time) {
-    delivery_data_.back().second = delivered;
+      delivery_data_.back_time() == curr_time) {
+    delivery_data_.back_value() = delivered;
     if (debug_) {
       cerr << "updated " << curr_time << " " << delivered << endl;
     }
   }
   else {
-    delivery_data_.push_back(std::make_pair(curr_time, delivered));
+    delivery_data_.push_back(curr_time, delivered);
     if (debug_) {
       cerr << "pushed " << curr_time << " " << delivered << endl;
     }
@@ -251,7 +382,7 @@ void DeliveryWindow::update_delivery_data( uint64_t curr_time,
   if (curr_time < delivery_data_window_) {
     return;
   }
-  while (delivery_data_.front().first < curr_time - delivery_data_window_) {
+  while (delivery_data_.front_time() < curr_time - delivery_data_window_) {
     delivery_data_.pop_front();
   }
 }
@@ -263,21 +394,15 @@ const uint64_t& DeliveryWindow::get_curr_delivered( void ) {
 
 /* Get delivered on of before a given time */
 std::pair<uint64_t,uint64_t> DeliveryWindow::get_delivered( const uint64_t& timestamp ) {
-  std::deque<pair<uint64_t, uint64_t>>::iterator upper = std::upper_bound(
-      delivery_data_.begin(),
-      delivery_data_.end(),
-      std::make_pair(timestamp, timestamp),
-      [](std::pair<uint64_t, uint64_t> left,
-        std::pair<uint64_t, uint64_t> right) { return left.first < right.first;}
-      );
-  if (upper == delivery_data_.begin()){
+  const size_t upper = delivery_data_.upper_bound(timestamp);
+  if (upper == 0){
     if( debug_ ) {
       cerr << "No delivery data" << endl;
     }
     return std::make_pair(0UL, 0UL);
   }
-  auto last_entry_on_before_ts = std::prev(upper);
-  return *last_entry_on_before_ts;
+  return std::make_pair(delivery_data_.time(upper - 1),
+                        delivery_data_.value(upper - 1));
 }
 
 /*************** BW Window ******************/
@@ -289,31 +414,19 @@ BwWindow::BwWindow( const bool debug )
 /* Update BW samples */
 void BwWindow::update_bw_samples( uint64_t curr_time,
         float bw_sample ){
-  bw_samples_.push_back(std::make_pair(curr_time, bw_sample));
-
-  /* Remove old entries */
-  if (curr_time < bw_window_size_) {
-    return;
-  }
-  while (bw_samples_.front().first < curr_time - bw_window_size_) {
-    bw_samples_.pop_front();
-  }
+  max_bw_filter_.update(curr_time, bw_sample);
 }
 
 /* Return max of the BW samples */
 float BwWindow::max_bw( void ) {
-  std::deque<pair<uint64_t, float>>::iterator max_elem = std::max_element(
-      bw_samples_.begin(),
-      bw_samples_.end(),
-      [](std::pair<uint64_t, float> &left,
-        std::pair<uint64_t, float> &right) { return left.second < right.second;});
-  return max_elem->second;
+  if (max_bw_filter_.empty()) {
+    return 0;
+  }
+  return max_bw_filter_.best();
 }
 
 
 /* Set BW window size */
 void BwWindow::update_bw_window_size( uint64_t size ) {
-  bw_window_size_ = size;
+  max_bw_filter_.set_window(size);
 }
-
-
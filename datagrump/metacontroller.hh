@@ -5,16 +5,25 @@
 #include <cassert>
 #include <cmath>
 #include <cstdint>
-#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "controller.hh"
+#include "ring_buffer.hh"
+#include "startup.hh"
+#include "windowed_filter.hh"
 
 class RttWindow
 {
   private:
     bool debug_;
-    uint64_t rtt_sample_window_ {10000};
-    std::deque<std::pair<uint64_t, uint64_t>> rtt_samples_ {};
+    /* 100 min RTTs of samples, capped at 30 s */
+    WindowedMinFilter<uint64_t> min_rtt_filter_ {10000, 30000};
+    /* short window chosen by the controller, capped at 5 s */
+    WindowedMinFilter<uint64_t> standing_rtt_filter_ {50, 5000};
+    uint64_t last_rtt_ {100};
+    uint64_t last_update_ {0};
 
   public:
 
@@ -28,14 +37,17 @@ class RttWindow
     /* Return latest RTT samples */
     uint64_t last_rtt( void );
 
+    /* Return minimum RTT over the last `window` ms (Copa's RTTstanding) */
+    uint64_t standing_rtt( uint64_t window );
+
 };
 
 class BwWindow
 {
   private:
     bool debug_;
-    uint64_t bw_window_size_ {200};
-    std::deque<std::pair<uint64_t, float>> bw_samples_ {};
+    /* window set by the controller, capped at 5 s */
+    WindowedMaxFilter<float> max_bw_filter_ {200, 5000};
 
   public:
 
@@ -57,7 +69,8 @@ class DeliveryWindow
   private:
     bool debug_;
     uint64_t delivery_data_window_ {15000};
-    std::deque<std::pair<uint64_t, uint64_t>> delivery_data_ {};
+    /* at most one entry per ms of the window */
+    SampleRing<uint64_t> delivery_data_ {delivery_data_window_ + 2};
     uint64_t last_delivered_{0};
 
   public:
@@ -78,7 +91,28 @@ class DeliveryWindow
 /* Congestion controller interface */
 class MetaController : public Controller
 {
+public:
+  /* Tunable parameters */
+  struct Params {
+    float alpha {0.8};           /* EWMA weight of the old smoothed RTT */
+    float lambda {2.0};          /* cwnd = lambda * bdp, before penalties */
+    float rtt_grad_gain {0.5};   /* EWMA weight of new RTT gradient samples */
+    float delay_thresh {1.1};    /* back off when RTT exceeds this * min RTT */
+    float grad_penalty {2.0};    /* shrink cwnd by this * positive gradient */
+    float pacing_gain {0.9};     /* scales every pacing gap */
+    float bw_window_rtts {5};    /* max-bandwidth window, in min RTTs */
+    std::vector<float> gamma_vals {0.8, 1.33, 1, 1, 1}; /* pacing cycle */
+    float startup {1};           /* nonzero: exponential startup phase */
+    float startup_gain {2};      /* startup cwnd and pacing gain, per round */
+
+    /* Set a parameter by name (gamma0..gamma4 for the pacing cycle);
+       false if there is no such parameter */
+    bool set( const std::string & name, const float value );
+  };
+
 protected:
+  Params params_ {};
+
   float cwnd_{10}; /* Congestion window */
   float rtt_thresh_{500}; /* RTT threshold */
   uint64_t min_rtt_{50};   /* Min RTT seen */
@@ -87,23 +121,28 @@ protected:
   float curr_max_bw_{1};
   float rtt_grad_{0};
 
-  float alpha_{0.8};
-
-  float lambda_{2.0};
-
   /* Packet pacing parameters */
   uint8_t last_gamma_update_{0};
   uint8_t gamma_state_{0};
-  std::vector<float> gamma_vals_ = {0.8, 1.33, 1, 1, 1};
 
   RttWindow rtt_window_;
   DeliveryWindow delivery_window_;
   BwWindow bw_window_;
+  Startup startup_ {};
   bool conservative_mode_{false};
 
+  /* Feed one ack to the estimators; returns its RTT */
+  uint64_t update_samples( const Ack & ack );
+
+  /* Set cwnd from the estimators, once per burst of acks */
+  void update_window( const float prev_cwnd, const uint64_t rtt_t, const bool starting );
+
 public:
   MetaController( const bool debug );
 
+  MetaController( const bool debug,
+      const Params & params );
+
   /* Timeout occured*/
   void timed_out( void );
 
@@ -113,15 +152,24 @@ public:
   /* Get current window size, in datagrams */
   unsigned int window_size( void );
 
+  /* A datagram was sent */
+  void datagram_was_sent( const uint64_t sequence_number,
+			  const uint64_t send_timestamp );
+
   /* An ack was received */
   void ack_received( const uint64_t sequence_number_acked,
 		     const uint64_t send_timestamp_acked,
 		     const uint64_t recv_timestamp_acked,
 		     const uint64_t timestamp_ack_received );
 
-  /* How long to wait (in milliseconds) if there are no acks
-     before sending one more datagram */
-  unsigned int timeout_ms( void );
+  /* A burst of acks, with one window update */
+  void acks_received( const Ack * const acks, const size_t count );
+
+  /* Start from a cached path estimate */
+  void warm_start( const PathEstimate & estimate );
+
+  /* Min RTT and max bandwidth measured so far */
+  bool path_estimate( PathEstimate & estimate );
 
 };
 #endif
@@ -0,0 +1,96 @@
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "metrics.hh"
+#include "util.hh"
+
+using namespace std;
+using namespace MetricsLayout;
+
+/* Shard used by the calling thread (assigned round-robin on first use) */
+unsigned int MetricsLayout::this_thread_shard( void )
+{
+  static atomic<unsigned int> next_shard { 0 };
+  static thread_local const unsigned int shard = next_shard++ % SHARDS;
+  return shard;
+}
+
+/* Gauges keep the bit pattern of a double in the first shard */
+void Gauge::set( const double value )
+{
+  uint64_t bits;
+  static_assert( sizeof( bits ) == sizeof( value ), "double is not 64 bits" );
+  memcpy( &bits, &value, sizeof( bits ) );
+  slot_->shards[ 0 ].value.store( bits, memory_order_relaxed );
+}
+
+/* Create (or reset) the named shared-memory segment */
+MetricsRegistry::MetricsRegistry( const string & segment_name )
+  : shm_fd_(),
+    region_(),
+    segment_( nullptr )
+{
+  try {
+    shm_fd_.reset( new FileDescriptor( SystemCall( "shm_open",
+						   shm_open( segment_name.c_str(),
+							     O_RDWR | O_CREAT, 0644 ) ) ) );
+    SystemCall( "ftruncate", ftruncate( shm_fd_->fd_num(), sizeof( Segment ) ) );
+    region_.reset( new MMapRegion( sizeof( Segment ), PROT_READ | PROT_WRITE,
+				   MAP_SHARED, shm_fd_->fd_num() ) );
+  } catch ( const exception & e ) {
+    /* metrics are best-effort: keep counting, just not where others can see */
+    cerr << "Metrics segment " << segment_name << " unavailable ("
+	 << e.what() << "), keeping metrics private" << endl;
+    region_.reset( new MMapRegion( sizeof( Segment ), PROT_READ | PROT_WRITE,
+				   MAP_PRIVATE | MAP_ANONYMOUS ) );
+  }
+
+  segment_ = reinterpret_cast<Segment *>( region_->addr() );
+
+  /* readers ignore the segment until it is republished */
+  segment_->magic.store( 0, memory_order_release );
+  memset( static_cast<void *>( segment_->slots ), 0, sizeof( segment_->slots ) );
+  segment_->num_metrics = 0;
+  segment_->buckets = BUCKETS;
+}
+
+Slot & MetricsRegistry::add_metric( const string & name, const Kind kind )
+{
+  if ( segment_->num_metrics >= MAX_METRICS ) {
+    throw runtime_error( "too many metrics registered" );
+  }
+
+  if ( name.empty() or name.size() >= NAME_LENGTH ) {
+    throw runtime_error( "invalid metric name: " + name );
+  }
+
+  Slot & slot = segment_->slots[ segment_->num_metrics++ ];
+  strncpy( slot.name, name.c_str(), NAME_LENGTH - 1 );
+  slot.kind = kind;
+  return slot;
+}
+
+Counter MetricsRegistry::counter( const string & name )
+{
+  return Counter( add_metric( name, Kind::Counter ) );
+}
+
+Gauge MetricsRegistry::gauge( const string & name )
+{
+  return Gauge( add_metric( name, Kind::Gauge ) );
+}
+
+Histogram MetricsRegistry::histogram( const string & name )
+{
+  return Histogram( add_metric( name, Kind::Histogram ) );
+}
+
+/* Make the registered metrics visible to readers */
+void MetricsRegistry::publish( void )
+{
+  segment_->magic.store( MAGIC, memory_order_release );
+}
@@ -0,0 +1,146 @@
+#ifndef METRICS_HH
+#define METRICS_HH
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "file_descriptor.hh"
+#include "mmap_region.hh"
+
+/* Live metrics (counters, gauges and histograms) kept in a shared-memory
+   segment, so that a separate process (grumpstat) can watch a running
+   sender or receiver. Updates are relaxed atomic adds/stores into the
+   mapping; nothing on the packet path allocates, locks or makes a syscall. */
+
+namespace MetricsLayout {
+  const uint64_t MAGIC = 0x6d65747269637331; /* "metrics1" */
+  const unsigned int MAX_METRICS = 32;
+  const unsigned int NAME_LENGTH = 48;
+  const unsigned int SHARDS = 4;      /* writers spread over shards by thread */
+  const unsigned int BUCKETS = 128;   /* histogram buckets (log-linear) */
+
+  enum class Kind : uint32_t { Unused = 0, Counter = 1, Gauge = 2, Histogram = 3 };
+
+  /* one writer shard: counter total, gauge bits, or histogram sum */
+  struct alignas( 64 ) Shard {
+    std::atomic<uint64_t> value;
+    std::atomic<uint64_t> buckets[ BUCKETS ];
+  };
+
+  struct Slot {
+    char name[ NAME_LENGTH ];
+    Kind kind;
+    Shard shards[ SHARDS ];
+  };
+
+  struct Segment {
+    std::atomic<uint64_t> magic; /* written last, once the slots are named */
+    uint32_t num_metrics;
+    uint32_t buckets;
+    Slot slots[ MAX_METRICS ];
+  };
+
+  /* Histogram bucket for a value: exact below 16, then 8 buckets per
+     power of two (12.5% resolution); the last bucket absorbs overflow */
+  inline unsigned int bucket_index( const uint64_t value )
+  {
+    if ( value < 16 ) {
+      return value;
+    }
+
+    const unsigned int exponent = 63 - __builtin_clzll( value );
+    const unsigned int index = 16 + (exponent - 4) * 8 + ((value >> (exponent - 3)) & 7);
+    return index < BUCKETS ? index : BUCKETS - 1;
+  }
+
+  /* Smallest value that lands in a bucket */
+  inline uint64_t bucket_floor( const unsigned int index )
+  {
+    if ( index < 16 ) {
+      return index;
+    }
+
+    const unsigned int exponent = (index - 16) / 8 + 4;
+    return (uint64_t( 8 ) + (index - 16) % 8) << (exponent - 3);
+  }
+
+  /* Shard used by the calling thread */
+  unsigned int this_thread_shard( void );
+}
+
+/* Monotonic event count */
+class Counter
+{
+private:
+  MetricsLayout::Slot * slot_;
+
+public:
+  Counter( MetricsLayout::Slot & slot ) : slot_( &slot ) {}
+
+  void add( const uint64_t amount = 1 )
+  {
+    slot_->shards[ MetricsLayout::this_thread_shard() ].value.fetch_add( amount, std::memory_order_relaxed );
+  }
+};
+
+/* Last-written value */
+class Gauge
+{
+private:
+  MetricsLayout::Slot * slot_;
+
+public:
+  Gauge( MetricsLayout::Slot & slot ) : slot_( &slot ) {}
+
+  void set( const double value );
+};
+
+/* Distribution of non-negative integer samples */
+class Histogram
+{
+private:
+  MetricsLayout::Slot * slot_;
+
+public:
+  Histogram( MetricsLayout::Slot & slot ) : slot_( &slot ) {}
+
+  void record( const uint64_t value )
+  {
+    MetricsLayout::Shard & shard = slot_->shards[ MetricsLayout::this_thread_shard() ];
+    shard.buckets[ MetricsLayout::bucket_index( value ) ].fetch_add( 1, std::memory_order_relaxed );
+    shard.value.fetch_add( value, std::memory_order_relaxed );
+  }
+};
+
+/* Owner of a metrics segment; hands out metric handles by name */
+class MetricsRegistry
+{
+private:
+  std::unique_ptr<FileDescriptor> shm_fd_;
+  std::unique_ptr<MMapRegion> region_;
+  MetricsLayout::Segment * segment_;
+
+  MetricsLayout::Slot & add_metric( const std::string & name,
+				    const MetricsLayout::Kind kind );
+
+public:
+  /* Create (or reset) the named POSIX shared-memory segment, e.g.
+     "/datagrump-sender". Falls back to private memory if that fails. */
+  MetricsRegistry( const std::string & segment_name );
+
+  /* Register metrics (do this before entering the packet path) */
+  Counter counter( const std::string & name );
+  Gauge gauge( const std::string & name );
+  Histogram histogram( const std::string & name );
+
+  /* Make the registered metrics visible to readers */
+  void publish( void );
+
+  /* forbid copying MetricsRegistry objects or assigning them */
+  MetricsRegistry( const MetricsRegistry & other ) = delete;
+  const MetricsRegistry & operator=( const MetricsRegistry & other ) = delete;
+};
+
+#endif /* METRICS_HH */
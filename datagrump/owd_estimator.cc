@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <vector>
+
+#include "owd_estimator.hh"
+
+using namespace std;
+
+OwdEstimator::OwdEstimator( const uint64_t bucket_ms,
+			    const unsigned int buckets,
+			    const double max_drift,
+			    const float gradient_gain )
+  : bucket_ms_( max<uint64_t>( bucket_ms, 1 ) ),
+    max_drift_( max_drift ),
+    minima_( max( buckets, 2u ) ),
+    gradient_gain_( gradient_gain )
+{}
+
+/* Theil-Sen fit through the bucket minima, lowered under all of them */
+void OwdEstimator::fit( void )
+{
+  const size_t n = minima_.size();
+  double slopes[ 64 * 63 / 2 ];
+  size_t count = 0;
+
+  /* at most the 64 newest buckets take part */
+  const size_t first = n > 64 ? n - 64 : 0;
+  for ( size_t i = first; i < n; i++ ) {
+    for ( size_t j = i + 1; j < n; j++ ) {
+      const Minimum & a = minima_.value( i ), & b = minima_.value( j );
+      const double dx = double( b.send_timestamp ) - a.send_timestamp;
+      if ( dx > 0 ) {
+	slopes[ count++ ] = (b.owd - a.owd) / dx;
+      }
+    }
+  }
+
+  if ( count > 0 ) {
+    nth_element( slopes, slopes + count / 2, slopes + count );
+    drift_ = min( max( slopes[ count / 2 ], -max_drift_ ), max_drift_ );
+  }
+
+  for ( size_t i = first; i < n; i++ ) {
+    const Minimum & point = minima_.value( i );
+    const double intercept = point.owd - drift_ * (double( point.send_timestamp ) - origin_);
+    intercept_ = i == first ? intercept : min( intercept_, intercept );
+  }
+}
+
+/* Add the timestamps of one acked datagram */
+void OwdEstimator::update( const uint64_t send_timestamp, const uint64_t recv_timestamp )
+{
+  const int64_t raw = int64_t( recv_timestamp ) - int64_t( send_timestamp );
+
+  if ( not started_ ) {
+    origin_ = last_send_ = send_timestamp;
+    intercept_ = raw;
+    started_ = true;
+  }
+
+  /* keep the lowest sample of each bucket (stamped with its send time) */
+  const uint64_t bucket = send_timestamp / bucket_ms_;
+  if ( not minima_.empty() and minima_.back_time() == bucket ) {
+    if ( raw < minima_.back_value().owd ) {
+      minima_.back_value() = { raw, send_timestamp };
+    }
+  } else if ( minima_.empty() or bucket > minima_.back_time() ) {
+    if ( minima_.size() >= 2 ) {
+      fit(); /* the newest bucket is complete */
+    }
+    minima_.push_back( bucket, { raw, send_timestamp } );
+  }
+
+  /* queueing above the baseline; a sample below it lowers the baseline */
+  const double baseline = intercept_ + drift_ * (double( send_timestamp ) - origin_);
+  if ( raw < baseline ) {
+    intercept_ -= baseline - raw;
+  }
+  const double queueing_delay = max( 0.0, raw - baseline );
+
+  if ( send_timestamp > last_send_ ) {
+    const double gradient = (queueing_delay - queueing_delay_) / (send_timestamp - last_send_);
+    gradient_ = (1 - gradient_gain_) * gradient_ + gradient_gain_ * gradient;
+    last_send_ = send_timestamp;
+  }
+  queueing_delay_ = queueing_delay;
+}
@@ -0,0 +1,70 @@
+#ifndef OWD_ESTIMATOR_HH
+#define OWD_ESTIMATOR_HH
+
+#include <cstdint>
+
+#include "ring_buffer.hh"
+
+/* Forward (sender to receiver) queueing delay from the receiver's
+   timestamps. A raw one-way delay, recv_timestamp - send_timestamp,
+   mixes the propagation delay, the forward queue and the offset
+   between the two clocks, and the offset drifts as the clocks run at
+   slightly different rates. The lowest raw delay in each bucket of
+   send time is taken as a point where the queue was (nearly) empty.
+   A Theil-Sen line (median of pairwise slopes, so a few buckets with
+   a standing queue do not tilt it) is fitted through those points
+   and lowered to sit under all of them. The line is then the baseline,
+   and whatever a sample has above it is queueing. Congestion on the
+   ack path does not show up in it, unlike in RTT. */
+class OwdEstimator
+{
+private:
+  uint64_t bucket_ms_;
+  double max_drift_;
+
+  /* lowest raw one-way delay in a bucket, and when it was sent */
+  struct Minimum {
+    int64_t owd;
+    uint64_t send_timestamp;
+  };
+
+  SampleRing<Minimum> minima_; /* keyed by bucket number */
+  uint64_t origin_ {0};        /* send time of the first sample */
+  bool started_ {false};
+
+  /* baseline: intercept + drift * (send time - origin) */
+  double intercept_ {0};
+  double drift_ {0};
+
+  double queueing_delay_ {0};
+  double gradient_ {0};
+  float gradient_gain_;
+  uint64_t last_send_ {0};
+
+  void fit( void );
+
+public:
+  /* Buckets of `bucket_ms`, `buckets` of them kept; drift is clamped
+     to +-max_drift (ms per ms); gradient_gain weights new gradient
+     samples in their EWMA */
+  OwdEstimator( const uint64_t bucket_ms = 1000,
+		const unsigned int buckets = 30,
+		const double max_drift = 200e-6,
+		const float gradient_gain = 0.25 );
+
+  /* Add the timestamps of one acked datagram */
+  void update( const uint64_t send_timestamp, const uint64_t recv_timestamp );
+
+  /* Forward queueing delay of the latest sample, in ms (>= 0) */
+  double queueing_delay( void ) const { return queueing_delay_; }
+
+  /* Smoothed rate of change of the forward queueing delay (ms per ms) */
+  double gradient( void ) const { return gradient_; }
+
+  /* Estimated receiver clock drift relative to the sender (ms per ms) */
+  double drift( void ) const { return drift_; }
+
+  bool empty( void ) const { return not started_; }
+};
+
+#endif /* OWD_ESTIMATOR_HH */
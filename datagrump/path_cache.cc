@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include "path_cache.hh"
+#include "util.hh"
+
+using namespace std;
+using namespace PathCacheLayout;
+
+/* Holds flock() on the cache file, so concurrent senders do not
+   interleave their updates to an entry */
+class FileLock
+{
+private:
+  int fd_;
+
+public:
+  FileLock( const int fd ) : fd_( fd ) { SystemCall( "flock", flock( fd_, LOCK_EX ) ); }
+  ~FileLock() { flock( fd_, LOCK_UN ); }
+
+  /* forbid copying FileLock objects or assigning them */
+  FileLock( const FileLock & other ) = delete;
+  const FileLock & operator=( const FileLock & other ) = delete;
+};
+
+PathCache::PathCache( const string & filename,
+		      const uint64_t half_life_ms,
+		      const uint64_t max_age_ms )
+  : fd_( new FileDescriptor( SystemCall( "open " + filename,
+					 open( filename.c_str(), O_RDWR | O_CREAT, 0644 ) ) ) ),
+    region_(),
+    file_( nullptr ),
+    half_life_ms_( max<uint64_t>( half_life_ms, 1 ) ),
+    max_age_ms_( max_age_ms )
+{
+  FileLock lock( fd_->fd_num() );
+
+  SystemCall( "ftruncate", ftruncate( fd_->fd_num(), sizeof( File ) ) );
+  region_.reset( new MMapRegion( sizeof( File ), PROT_READ | PROT_WRITE,
+				 MAP_SHARED, fd_->fd_num() ) );
+  file_ = reinterpret_cast<File *>( region_->addr() );
+
+  /* a new (zero-filled) or foreign file starts empty */
+  if ( file_->magic != MAGIC or file_->num_entries != ENTRIES ) {
+    memset( static_cast<void *>( file_ ), 0, sizeof( File ) );
+    file_->num_entries = ENTRIES;
+    file_->magic = MAGIC;
+  }
+}
+
+string PathCache::default_filename( void )
+{
+  const char * const override = getenv( "DATAGRUMP_PATH_CACHE" );
+  if ( override and *override ) {
+    return override;
+  }
+
+  const char * const home = getenv( "HOME" );
+  return string( home and *home ? home : "/tmp" ) + "/.datagrump-paths";
+}
+
+uint64_t PathCache::now_ms( void )
+{
+  return chrono::duration_cast<chrono::milliseconds>(
+    chrono::system_clock::now().time_since_epoch() ).count();
+}
+
+/* The entry for `key`, by open addressing. With `create`, a missing key
+   takes an empty slot, or else the stalest of its probe sequence. */
+Entry * PathCache::find( const string & key, const bool create )
+{
+  const size_t start = hash<string>()( key ) % ENTRIES;
+  Entry * victim = nullptr;
+
+  for ( unsigned int i = 0; i < PROBES; i++ ) {
+    Entry & entry = file_->entries[ (start + i) % ENTRIES ];
+    if ( strncmp( entry.key, key.c_str(), KEY_LENGTH ) == 0 ) {
+      return &entry;
+    }
+    if ( entry.key[ 0 ] == 0 ) {
+      if ( not victim or victim->key[ 0 ] != 0 ) {
+	victim = &entry; /* first empty slot */
+      }
+    } else if ( not victim or (victim->key[ 0 ] != 0 and entry.updated_ms < victim->updated_ms) ) {
+      victim = &entry;
+    }
+  }
+
+  if ( not create ) {
+    return nullptr;
+  }
+
+  memset( static_cast<void *>( victim ), 0, sizeof( Entry ) );
+  strncpy( victim->key, key.c_str(), KEY_LENGTH - 1 );
+  return victim;
+}
+
+bool PathCache::lookup( const string & destination_ip, PathEstimate & estimate )
+{
+  FileLock lock( fd_->fd_num() );
+
+  const Entry * const entry = find( destination_ip, false );
+  if ( not entry or entry->min_rtt_ms <= 0 or entry->max_bw <= 0 ) {
+    return false;
+  }
+
+  const uint64_t now = now_ms();
+  const uint64_t age = now > entry->updated_ms ? now - entry->updated_ms : 0;
+  if ( age > max_age_ms_ ) {
+    return false;
+  }
+
+  estimate.min_rtt_ms = entry->min_rtt_ms;
+  estimate.max_bw = entry->max_bw;
+  estimate.loss_rate = entry->loss_rate;
+  estimate.confidence = pow( 0.5, double( age ) / half_life_ms_ );
+  return true;
+}
+
+void PathCache::store( const string & destination_ip, const PathEstimate & estimate )
+{
+  FileLock lock( fd_->fd_num() );
+
+  Entry * const entry = find( destination_ip, true );
+  entry->min_rtt_ms = estimate.min_rtt_ms;
+  entry->max_bw = estimate.max_bw;
+  entry->loss_rate = estimate.loss_rate;
+  entry->updated_ms = now_ms();
+  if ( not run_counted_ ) {
+    entry->runs++;
+    run_counted_ = true;
+  }
+}
@@ -0,0 +1,81 @@
+#ifndef PATH_CACHE_HH
+#define PATH_CACHE_HH
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "controller.hh"
+#include "file_descriptor.hh"
+#include "mmap_region.hh"
+
+/* What earlier runs learned about the path to each destination, kept in
+   a small memory-mapped file so the next sender to that host can start
+   near the right rate. Records are keyed by the destination's IP (the
+   port does not change the path), written in place through the
+   mapping, and trusted less as they age. */
+
+namespace PathCacheLayout {
+  const uint64_t MAGIC = 0x7061746863616331; /* "pathcac1" */
+  const unsigned int ENTRIES = 256;
+  const unsigned int KEY_LENGTH = 48;
+  const unsigned int PROBES = 16;     /* slots searched per key */
+
+  struct Entry {
+    char key[ KEY_LENGTH ];           /* IP address; empty if unused */
+    uint64_t updated_ms;              /* wall-clock ms since the epoch */
+    float min_rtt_ms;
+    float max_bw;                     /* pkts/ms */
+    float loss_rate;
+    uint32_t runs;                    /* how many runs contributed */
+  };
+
+  struct File {
+    uint64_t magic;
+    uint32_t num_entries;
+    uint32_t reserved;
+    Entry entries[ ENTRIES ];
+  };
+}
+
+class PathCache
+{
+private:
+  std::unique_ptr<FileDescriptor> fd_;
+  std::unique_ptr<MMapRegion> region_;
+  PathCacheLayout::File * file_;
+  uint64_t half_life_ms_;
+  uint64_t max_age_ms_;
+  bool run_counted_ {false};
+
+  PathCacheLayout::Entry * find( const std::string & key, const bool create );
+
+public:
+  /* Map (creating if needed) the cache file. Records lose half their
+     weight every half_life_ms and are ignored after max_age_ms. */
+  PathCache( const std::string & filename,
+	     const uint64_t half_life_ms = 10 * 60 * 1000,
+	     const uint64_t max_age_ms = 24 * 60 * 60 * 1000 );
+
+  /* $DATAGRUMP_PATH_CACHE, else ~/.datagrump-paths (or /tmp if no $HOME) */
+  static std::string default_filename( void );
+
+  /* Wall-clock time, in ms since the epoch */
+  static uint64_t now_ms( void );
+
+  /* Look up the path to `destination_ip` (as Address::ip() gives it);
+     false if nothing usable. The estimate's confidence is its weight
+     after ageing. */
+  bool lookup( const std::string & destination_ip, PathEstimate & estimate );
+
+  /* Record the latest estimate for `destination_ip` (the first store of
+     a run also counts the run). Nothing allocates, so the sender can
+     store from its packet path with a key it keeps. */
+  void store( const std::string & destination_ip, const PathEstimate & estimate );
+
+  /* forbid copying PathCache objects or assigning them */
+  PathCache( const PathCache & other ) = delete;
+  const PathCache & operator=( const PathCache & other ) = delete;
+};
+
+#endif /* PATH_CACHE_HH */
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "path_scheduler.hh"
+
+using namespace std;
+
+/* The sendable path with the least smoothed RTT */
+static bool lowest_rtt( const vector<PathStatus> & paths, size_t & chosen )
+{
+  bool found = false;
+  for ( size_t i = 0; i < paths.size(); i++ ) {
+    if ( paths[ i ].can_send and (not found or paths[ i ].srtt_us < paths[ chosen ].srtt_us) ) {
+      chosen = i;
+      found = true;
+    }
+  }
+  return found;
+}
+
+bool PathScheduler::pick( const vector<PathStatus> & paths, size_t & chosen ) const
+{
+  /* measure every path first */
+  for ( size_t i = 0; i < paths.size(); i++ ) {
+    if ( paths[ i ].can_send and not paths[ i ].have_rtt ) {
+      chosen = i;
+      return true;
+    }
+  }
+
+  if ( not lowest_rtt( paths, chosen ) ) {
+    chosen = paths.size();
+    return false;
+  }
+
+  if ( policy_ == Policy::LowestRtt ) {
+    return true;
+  }
+
+  /* EarliestDelivery: is the fastest path worth waiting for? */
+  size_t fastest = chosen;
+  for ( size_t i = 0; i < paths.size(); i++ ) {
+    if ( paths[ i ].have_rtt and paths[ i ].srtt_us < paths[ fastest ].srtt_us ) {
+      fastest = i;
+    }
+  }
+
+  if ( fastest == chosen ) {
+    return true;
+  }
+
+  const PathStatus & fast = paths[ fastest ];
+  const PathStatus & slow = paths[ chosen ];
+  const double datagrams = max( slow.window - slow.in_flight, 1.0 );
+  const double wait_us = fast.pacing_us + (1 + datagrams / max( fast.window, 1.0 )) * fast.srtt_us;
+
+  if ( wait_us < slow.srtt_us ) {
+    chosen = fastest;
+    return false;
+  }
+
+  return true;
+}
+
+PathScheduler::Policy PathScheduler::policy_from_name( const string & name )
+{
+  if ( name == "lowest-rtt" ) {
+    return Policy::LowestRtt;
+  } else if ( name == "earliest-delivery" ) {
+    return Policy::EarliestDelivery;
+  }
+
+  throw runtime_error( "unknown scheduler " + name + " (lowest-rtt or earliest-delivery)" );
+}
+
+string PathScheduler::name( const Policy policy )
+{
+  switch ( policy ) {
+  case Policy::LowestRtt: return "lowest-rtt";
+  case Policy::EarliestDelivery: return "earliest-delivery";
+  }
+
+  return "unknown";
+}
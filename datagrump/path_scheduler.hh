@@ -0,0 +1,73 @@
+#ifndef PATH_SCHEDULER_HH
+#define PATH_SCHEDULER_HH
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* What the scheduler knows of one path of a multipath sender */
+struct PathStatus
+{
+  bool can_send;        /* window open, and pacing allows a datagram now */
+  bool have_rtt;        /* srtt_us is from at least one sample */
+  double srtt_us;
+  double in_flight;     /* datagrams */
+  double window;        /* the controller's window, in datagrams */
+  double pacing_us;     /* until pacing allows the next datagram */
+};
+
+/* Chooses the path for each datagram of a multipath sender.
+   - LowestRtt: the sendable path with the least smoothed RTT (the
+     default scheduler of multipath TCP).
+   - EarliestDelivery: what ECF ("earliest completion first") does.
+     If the fastest path (least srtt) cannot send, the other path
+     that could send next takes the k datagrams its window has room
+     for, unless the fastest path would deliver all of them sooner:
+     waiting for it costs its pacing delay plus (1 + k / window)
+     smoothed RTTs, against one smoothed RTT on the slower path. So a
+     much slower path carries only what the fast one cannot, and
+     delay stays low at some cost in aggregate throughput.
+   Either way, a sendable path without an RTT sample goes first, so
+   every path gets measured. */
+class PathScheduler
+{
+public:
+  enum class Policy { LowestRtt, EarliestDelivery };
+
+private:
+  Policy policy_;
+
+public:
+  PathScheduler( const Policy policy = Policy::LowestRtt ) : policy_( policy ) {}
+
+  /* The path the next datagram should take; false to wait for an
+     ack or for pacing. Then `chosen` is the fastest path, if a slower
+     one could send but should wait for it (so only the fastest path's
+     pacing matters), or paths.size() if no path can send. */
+  bool pick( const std::vector<PathStatus> & paths, size_t & chosen ) const;
+
+  Policy policy( void ) const { return policy_; }
+
+  static Policy policy_from_name( const std::string & name );
+  static std::string name( const Policy policy );
+};
+
+/* Multipath senders tag each datagram's sequence number with its path
+   in the top byte; the receiver echoes it back in the ack. Path 0's
+   sequence numbers are untagged, so a single-path sender is unchanged. */
+namespace PathTag {
+  const unsigned int SHIFT = 56;
+  const unsigned int MAX_PATHS = 16;
+  const uint64_t SEQUENCE_MASK = (uint64_t( 1 ) << SHIFT) - 1;
+
+  inline uint64_t tag( const unsigned int path, const uint64_t sequence_number )
+  {
+    return (uint64_t( path ) << SHIFT) | (sequence_number & SEQUENCE_MASK);
+  }
+
+  inline unsigned int path( const uint64_t tagged ) { return tagged >> SHIFT; }
+
+  inline uint64_t sequence_number( const uint64_t tagged ) { return tagged & SEQUENCE_MASK; }
+}
+
+#endif /* PATH_SCHEDULER_HH */
@@ -2,9 +2,15 @@
 
 #include <cstdlib>
 #include <iostream>
+#include <vector>
 
 #include "socket.hh"
+#include "alloc_counter.hh"
 #include "contest_message.hh"
+#include "fec.hh"
+#include "metrics.hh"
+#include "path_scheduler.hh"
+#include "timestamp.hh"
 
 using namespace std;
 
@@ -33,19 +39,69 @@ int main( int argc, char *argv[] )
 
   uint64_t sequence_number = 0;
 
+  /* live metrics, readable with grumpstat */
+  MetricsRegistry metrics( "/datagrump-receiver" );
+  Counter datagrams_received = metrics.counter( "datagrams_received" );
+  Counter bytes_received = metrics.counter( "bytes_received" );
+  Counter reordered = metrics.counter( "reordered" );
+  Gauge highest_sequence_number = metrics.gauge( "highest_sequence_number" );
+  Gauge fec_recovered = metrics.gauge( "fec_recovered" );
+  Gauge fec_unrecoverable = metrics.gauge( "fec_unrecoverable" );
+  Counter heap_allocations = metrics.counter( "heap_allocations" );
+  metrics.publish();
+  /* per path, for a multipath sender */
+  uint64_t highest_seen[ PathTag::MAX_PATHS ] = {};
+
+  /* rebuilds lost datagrams, if the sender sends repairs (-f) */
+  FecDecoder decoder;
+
+  /* the datagrams and acks are reused, so once warmed up the loop
+     never allocates */
+  vector<UDPSocket::received_datagram> datagrams = UDPSocket::make_batch( 1500 );
+  string ack;
+  const string ack_payload; /* acks carry none */
+  uint64_t allocations_counted = 0;
+
   /* Loop and acknowledge every incoming datagram back to its source */
   while ( true ) {
-    const UDPSocket::received_datagram recd = socket.recv();
-    ContestMessage message = recd.payload;
+    const size_t count = socket.recv_batch( datagrams );
+
+    for ( size_t i = 0; i < count; i++ ) {
+      const UDPSocket::received_datagram & recd = datagrams[ i ];
+      ContestMessage::Header header( recd.payload );
+      const char * const payload = recd.payload.data() + sizeof( header );
+      const size_t payload_length = recd.payload.size() - sizeof( header );
+
+      datagrams_received.add();
+      bytes_received.add( recd.payload.size() );
+      const unsigned int path = PathTag::path( header.sequence_number ) % PathTag::MAX_PATHS;
+      const uint64_t path_sequence_number = PathTag::sequence_number( header.sequence_number );
+      if ( path_sequence_number < highest_seen[ path ] ) {
+	reordered.add();
+      } else {
+	highest_seen[ path ] = path_sequence_number;
+	highest_sequence_number.set( highest_seen[ 0 ] );
+      }
+
+      if ( decoder.receive( payload, payload_length ) ) {
+	fec_recovered.set( decoder.recovered() );
+	fec_unrecoverable.set( decoder.unrecoverable() );
+      }
+
+      /* assemble the acknowledgment */
+      header.transform_into_ack( sequence_number++, recd.timestamp, payload_length );
 
-    /* assemble the acknowledgment */
-    message.transform_into_ack( sequence_number++, recd.timestamp );
+      /* timestamp the ack just before sending */
+      header.send_timestamp = timestamp_ms();
 
-    /* timestamp the ack just before sending */
-    message.set_send_timestamp();
+      /* send the ack */
+      ContestMessage::serialize( header, ack_payload, ack );
+      socket.sendto( recd.source_address, ack );
+    }
 
-    /* send the ack */
-    socket.sendto( recd.source_address, message.to_string() );
+    const uint64_t allocations = AllocCounter::allocations();
+    heap_allocations.add( allocations - allocations_counted );
+    allocations_counted = allocations;
   }
 
   return EXIT_SUCCESS;
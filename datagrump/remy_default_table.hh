@@ -0,0 +1,77 @@
+#ifndef REMY_DEFAULT_TABLE_HH
+#define REMY_DEFAULT_TABLE_HH
+
+#include "remycontroller.hh"
+
+/* Built-in rules for RemyController (generated by remytrain) */
+static constexpr RemyTable REMY_DEFAULT_TABLE = {
+  { { 0.877439976, 1.00000417, 1.26541603 },
+    { 0.518505514, 0.677455604, 1.53066921 },
+    { 1.22500002, 1.57500005, 2.04999995 } },
+  { { 1, 1, 0 },
+    { 0.25, 0.99000001, 0 },
+    { 0, 1, 0 },
+    { 0, 0.939999998, 0 },
+    { 1, 1, 0 },
+    { 0.5, 1, 0 },
+    { 0, 1, 0 },
+    { 4, 0.959999979, 0 },
+    { 0, 0.99000001, 0 },
+    { 0.5, 1, 0 },
+    { 0, 0.99000001, 0 },
+    { 0, 0.939999998, 0 },
+    { 1, 1, 0 },
+    { 0.5, 1, 0 },
+    { 0, 0.99000001, 0 },
+    { 0, 0.949999988, 0 },
+    { 1, 1, 0 },
+    { 0.5, 0.949999988, 0 },
+    { 0, 0.99000001, 0 },
+    { 0, 0.939999998, 0 },
+    { 1, 1, 0 },
+    { 0.5, 1, 0 },
+    { 0, 0.99000001, 0 },
+    { 0, 0.949999988, 0 },
+    { 1, 1, 0 },
+    { -3.5, 0.949999988, 0 },
+    { 0, 0.99000001, 0 },
+    { 0, 0.949999988, 0 },
+    { 1, 1, 0 },
+    { 0.5, 1, 0 },
+    { -0.25, 0.99000001, 0 },
+    { 0, 0.949999988, 0 },
+    { 1, 1, 0 },
+    { 0.5, 1, 0 },
+    { 0, 0.99000001, 0 },
+    { 0, 0.949999988, 0 },
+    { 1, 1, 0 },
+    { 0.25, 0.949999988, 0 },
+    { 0, 0.99000001, 0 },
+    { 0, 0.949999988, 0 },
+    { 1, 0.949999988, 0 },
+    { 0.5, 1, 0 },
+    { 0, 0.99000001, 0.0500000007 },
+    { 0, 0.949999988, 0 },
+    { 1, 1, 0 },
+    { 0.5, 1, 0 },
+    { 4, 1, 0 },
+    { 0, 0.949999988, 0 },
+    { 1, 1, 0 },
+    { 0.5, 1, 0.0500000007 },
+    { 0, 0.99000001, 0 },
+    { 0, 0.949999988, 0 },
+    { 0.75, 1, 0 },
+    { 0.5, 1, 0.0500000007 },
+    { 1, 0.99000001, 0 },
+    { 0, 0.949999988, 0 },
+    { 1, 1, 0 },
+    { 0.5, 0.949999988, 0.0500000007 },
+    { 0, 0.99000001, 0 },
+    { 0, 0.959999979, 0 },
+    { 2, 0.939999998, 0.0500000007 },
+    { -0.5, 1, 0.0500000007 },
+    { 0, 0.99000001, 0 },
+    { 0, 0.949999988, 0 } }
+};
+
+#endif
@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "remycontroller.hh"
+#include "remy_default_table.hh"
+#include "timestamp.hh"
+
+using namespace std;
+
+const char * RemyTable::signal_name( const unsigned int signal )
+{
+  static const char * const names[] = { "ack_ewma", "send_ewma", "rtt_ratio" };
+  return signal < SIGNALS ? names[ signal ] : "?";
+}
+
+/* Text format: "#" comments, one "boundaries SIGNAL B1 B2 B3" line per
+   signal and one "rule INDEX INCREMENT MULTIPLE INTERSEND_MS" per rule */
+RemyTable RemyTable::load( const string & filename )
+{
+  ifstream file( filename );
+  if ( not file.is_open() ) {
+    throw runtime_error( "cannot open rule table " + filename );
+  }
+
+  RemyTable table {};
+  bool have_boundaries[ SIGNALS ] {}, have_rule[ RULES ] {};
+  string line;
+  unsigned int line_number = 0;
+
+  while ( getline( file, line ) ) {
+    line_number++;
+    istringstream fields( line.substr( 0, line.find( '#' ) ) );
+    const string where = filename + ":" + to_string( line_number );
+
+    string keyword;
+    if ( not (fields >> keyword) ) {
+      continue;
+    }
+
+    if ( keyword == "boundaries" ) {
+      string name;
+      fields >> name;
+      unsigned int signal = 0;
+      while ( signal < SIGNALS and name != signal_name( signal ) ) {
+	signal++;
+      }
+      if ( signal == SIGNALS ) {
+	throw runtime_error( where + ": unknown signal " + name );
+      }
+      for ( unsigned int b = 0; b < BINS - 1; b++ ) {
+	if ( not (fields >> table.boundaries[ signal ][ b ])
+	     or (b > 0 and table.boundaries[ signal ][ b ] < table.boundaries[ signal ][ b - 1 ]) ) {
+	  throw runtime_error( where + ": want " + to_string( BINS - 1 ) + " ascending boundaries" );
+	}
+      }
+      have_boundaries[ signal ] = true;
+    } else if ( keyword == "rule" ) {
+      unsigned int index;
+      RemyAction action;
+      if ( not (fields >> index >> action.window_increment
+		>> action.window_multiple >> action.intersend_ms)
+	   or index >= RULES or action.window_multiple < 0 or action.intersend_ms < 0 ) {
+	throw runtime_error( where + ": want rule INDEX INCREMENT MULTIPLE INTERSEND_MS" );
+      }
+      table.actions[ index ] = action;
+      have_rule[ index ] = true;
+    } else {
+      throw runtime_error( where + ": unknown keyword " + keyword );
+    }
+  }
+
+  for ( unsigned int s = 0; s < SIGNALS; s++ ) {
+    if ( not have_boundaries[ s ] ) {
+      throw runtime_error( filename + ": no boundaries for " + signal_name( s ) );
+    }
+  }
+  for ( unsigned int i = 0; i < RULES; i++ ) {
+    if ( not have_rule[ i ] ) {
+      throw runtime_error( filename + ": no rule " + to_string( i ) );
+    }
+  }
+
+  return table;
+}
+
+void RemyTable::save( ostream & out ) const
+{
+  out << setprecision( 9 );
+  for ( unsigned int s = 0; s < SIGNALS; s++ ) {
+    out << "boundaries " << signal_name( s );
+    for ( unsigned int b = 0; b < BINS - 1; b++ ) {
+      out << " " << boundaries[ s ][ b ];
+    }
+    out << "\n";
+  }
+
+  out << "# rule index = (ack_ewma bin * " << BINS << " + send_ewma bin) * "
+      << BINS << " + rtt_ratio bin\n";
+  for ( unsigned int i = 0; i < RULES; i++ ) {
+    out << "rule " << i << " " << actions[ i ].window_increment
+	<< " " << actions[ i ].window_multiple
+	<< " " << actions[ i ].intersend_ms << "\n";
+  }
+}
+
+void RemyTable::save_cxx( ostream & out, const string & name ) const
+{
+  out << setprecision( 9 )
+      << "static constexpr RemyTable " << name << " = {\n  { ";
+  for ( unsigned int s = 0; s < SIGNALS; s++ ) {
+    out << (s ? ",\n    { " : "{ ");
+    for ( unsigned int b = 0; b < BINS - 1; b++ ) {
+      out << (b ? ", " : "") << boundaries[ s ][ b ];
+    }
+    out << " }";
+  }
+  out << " },\n  { ";
+  for ( unsigned int i = 0; i < RULES; i++ ) {
+    out << (i ? ",\n    { " : "{ ") << actions[ i ].window_increment
+	<< ", " << actions[ i ].window_multiple
+	<< ", " << actions[ i ].intersend_ms << " }";
+  }
+  out << " }\n};\n";
+}
+
+const RemyTable & RemyController::default_table( void )
+{
+  return REMY_DEFAULT_TABLE;
+}
+
+RemyController::RemyController( const bool debug )
+  : RemyController( debug, Params() )
+{}
+
+RemyController::RemyController( const bool debug,
+    const Params & params )
+  : RemyController( debug, params, default_table() )
+{}
+
+RemyController::RemyController( const bool debug,
+    const Params & params,
+    const RemyTable & table )
+  : Controller ( debug ),
+    params_ ( params ),
+    table_ ( table )
+{}
+
+/* Set a parameter by name */
+bool RemyController::Params::set( const string & name, const float value )
+{
+  if (name == "ewma_weight") { ewma_weight = value; }
+  else if (name == "min_cwnd") { min_cwnd = value; }
+  else if (name == "max_cwnd") { max_cwnd = value; }
+  else { return false; }
+  return true;
+}
+
+/* Get current window size, in datagrams */
+unsigned int RemyController::window_size( void )
+{
+  unsigned int the_window_size = static_cast<unsigned int>(cwnd_);
+
+  if ( debug_ ) {
+    cerr << "At time " << timestamp_ms()
+	 << " window size is " << the_window_size << endl;
+  }
+  return the_window_size;
+}
+
+/* An ack was received */
+void RemyController::ack_received( const uint64_t sequence_number_acked,
+			       /* what sequence number was acknowledged */
+			       const uint64_t send_timestamp_acked,
+			       /* when the acknowledged datagram was sent (sender's clock) */
+			       const uint64_t recv_timestamp_acked,
+			       /* when the acknowledged datagram was received (receiver's clock)*/
+			       const uint64_t timestamp_ack_received )
+                               /* when the ack was received (by sender) */
+{
+  const uint64_t rtt_t = max<uint64_t>( timestamp_ack_received - send_timestamp_acked, 1 );
+  srtt_ = srtt_ == 0 ? rtt_t : 0.875 * srtt_ + 0.125 * rtt_t;
+  min_rtt_ = min_rtt_ == 0 ? rtt_t : min( min_rtt_, rtt_t );
+
+  /* the EWMAs start with the second ack */
+  const float weight = params_.ewma_weight;
+  if ( last_ack_ != 0 ) {
+    float & ack_ewma = signals_[ RemyTable::ACK_EWMA ];
+    float & send_ewma = signals_[ RemyTable::SEND_EWMA ];
+    ack_ewma = (1 - weight) * ack_ewma
+      + weight * (timestamp_ack_received - last_ack_);
+    send_ewma = (1 - weight) * send_ewma
+      + weight * (send_timestamp_acked > last_send_ ? send_timestamp_acked - last_send_ : 0);
+  }
+  last_ack_ = timestamp_ack_received;
+  last_send_ = send_timestamp_acked;
+  signals_[ RemyTable::RTT_RATIO ] = float( rtt_t ) / min_rtt_;
+
+  const RemyAction & action = table_.actions[ table_.rule( signals_ ) ];
+  cwnd_ = min( max( action.window_multiple * cwnd_ + action.window_increment,
+		    params_.min_cwnd ), params_.max_cwnd );
+  intersend_ms_ = action.intersend_ms;
+
+  if ( debug_ ) {
+    cerr << "At time " << timestamp_ack_received
+	 << " received ack for datagram " << sequence_number_acked
+	 << " (send @ time " << send_timestamp_acked
+	 << ", received @ time " << recv_timestamp_acked << " by receiver's clock)"
+	 << ", rule " << table_.rule( signals_ )
+	 << " (ack_ewma " << signals_[ RemyTable::ACK_EWMA ]
+	 << " send_ewma " << signals_[ RemyTable::SEND_EWMA ]
+	 << " rtt_ratio " << signals_[ RemyTable::RTT_RATIO ] << ")"
+	 << ", cwnd " << cwnd_ << endl;
+  }
+}
+
+/* Timeout occured */
+void RemyController::timed_out( void )
+{
+  /* halve the window (down to min_cwnd) and start over with fresh signals */
+  cwnd_ = max( cwnd_ / 2, params_.min_cwnd );
+  fill( signals_, signals_ + RemyTable::SIGNALS, 0 );
+  last_ack_ = last_send_ = 0;
+
+  if ( debug_ ) {
+    cerr << "Timed out. cwnd: " << cwnd_ << endl;
+  }
+}
+
+/* Pace at the rule's intersend time */
+float RemyController::get_interpkt_delay( void )
+{
+  return intersend_ms_ * 1000;
+}
+
@@ -0,0 +1,121 @@
+#ifndef REMYCONTROLLER_HH
+#define REMYCONTROLLER_HH
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "controller.hh"
+
+/* What a rule tells the sender to do on each ack */
+struct RemyAction {
+  float window_increment;  /* datagrams added to the window */
+  float window_multiple;   /* the window is scaled by this first */
+  float intersend_ms;      /* minimum gap between datagrams */
+};
+
+/* Rules of a RemyCC, as a grid over the congestion signals: each signal
+   falls in one of BINS bins, split at BINS - 1 ascending boundaries, and
+   the bins select one of RULES actions. This is a literal type, so a
+   trained table can be compiled in as a constexpr. */
+struct RemyTable {
+  enum Signal { ACK_EWMA, SEND_EWMA, RTT_RATIO, SIGNALS };
+  static const unsigned int BINS = 4;
+  static const unsigned int RULES = BINS * BINS * BINS;
+
+  float boundaries[ SIGNALS ][ BINS - 1 ];
+  RemyAction actions[ RULES ];
+
+  /* Index of the rule covering the signals (no data-dependent branches) */
+  unsigned int rule( const float signals[ SIGNALS ] ) const
+  {
+    unsigned int index = 0;
+    for ( unsigned int s = 0; s < SIGNALS; s++ ) {
+      unsigned int bin = 0;
+      for ( unsigned int b = 0; b < BINS - 1; b++ ) {
+	bin += signals[ s ] >= boundaries[ s ][ b ];
+      }
+      index = index * BINS + bin;
+    }
+    return index;
+  }
+
+  /* Read a table written by save() (throws on a malformed file) */
+  static RemyTable load( const std::string & filename );
+
+  /* Write the table as text, or as a C++ constexpr definition */
+  void save( std::ostream & out ) const;
+  void save_cxx( std::ostream & out, const std::string & name ) const;
+
+  static const char * signal_name( const unsigned int signal );
+};
+
+/* Table-driven controller after RemyCC (Winstein and Balakrishnan,
+   SIGCOMM 2013). It keeps three congestion signals, each updated on
+   every ack:
+     ack_ewma   EWMA of the time between acks (ms)
+     send_ewma  EWMA of the time between the sends of acked datagrams (ms)
+     rtt_ratio  last RTT over the lowest RTT seen
+   and applies the rule they select: cwnd = multiple * cwnd + increment,
+   pacing datagrams at least intersend_ms apart. The rules come from an
+   offline search (remytrain) rather than from a hand-written law. */
+class RemyController : public Controller
+{
+public:
+  /* Tunable parameters */
+  struct Params {
+    float ewma_weight {0.125};   /* weight of a new sample in both EWMAs */
+    float min_cwnd {1};
+    float max_cwnd {1000};
+
+    /* Set a parameter by name; false if there is no such parameter */
+    bool set( const std::string & name, const float value );
+  };
+
+protected:
+  Params params_ {};
+  RemyTable table_;
+
+  float signals_[ RemyTable::SIGNALS ] {}; /* indexed by RemyTable::Signal */
+  uint64_t last_ack_ {0};
+  uint64_t last_send_ {0};
+  uint64_t min_rtt_ {0};
+  float srtt_ {0};
+
+  float cwnd_ {10}; /* Congestion window */
+  float intersend_ms_ {0};
+
+public:
+  /* With the built-in table */
+  RemyController( const bool debug );
+
+  RemyController( const bool debug,
+      const Params & params );
+
+  RemyController( const bool debug,
+      const Params & params,
+      const RemyTable & table );
+
+  /* The table compiled into the program */
+  static const RemyTable & default_table( void );
+
+  /* Timeout occured*/
+  void timed_out( void );
+
+  /* Wait between packets */
+  float get_interpkt_delay( void );
+
+  /* Get current window size, in datagrams */
+  unsigned int window_size( void );
+
+  /* An ack was received */
+  void ack_received( const uint64_t sequence_number_acked,
+		     const uint64_t send_timestamp_acked,
+		     const uint64_t recv_timestamp_acked,
+		     const uint64_t timestamp_ack_received );
+
+  const float * signals( void ) const { return signals_; }
+  const RemyTable & table( void ) const { return table_; }
+};
+
+#endif
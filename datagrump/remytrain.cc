@@ -0,0 +1,369 @@
+/* search for RemyCC rules: improve a rule table one rule at a time,
+   scoring each candidate against link traces in simulated time */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include <getopt.h>
+
+#include "link_simulator.hh"
+#include "remycontroller.hh"
+
+using namespace std;
+
+/* A RemyController that counts how often each rule fires and can
+   keep the signals it saw */
+class RecordingRemyController : public RemyController
+{
+public:
+  uint64_t usage[ RemyTable::RULES ] {};
+  vector<float> samples[ RemyTable::SIGNALS ] {};
+  bool recording {false};
+
+  RecordingRemyController( const RemyController::Params & params, const RemyTable & table )
+    : RemyController( false, params, table )
+  {}
+
+  void ack_received( const uint64_t sequence_number_acked,
+		     const uint64_t send_timestamp_acked,
+		     const uint64_t recv_timestamp_acked,
+		     const uint64_t timestamp_ack_received )
+  {
+    usage[ table_.rule( signals_ ) ]++;
+    if ( recording ) {
+      for ( unsigned int s = 0; s < RemyTable::SIGNALS; s++ ) {
+	samples[ s ].push_back( signals_[ s ] );
+      }
+    }
+    RemyController::ack_received( sequence_number_acked, send_timestamp_acked,
+				  recv_timestamp_acked, timestamp_ack_received );
+  }
+};
+
+/* how one table did over all the traces */
+struct Evaluation
+{
+  double score {0}; /* mean over traces of ln(throughput) - delta * ln(p95 delay) */
+  double throughput_mbps {0};
+  double p95_delay_ms {0};
+  uint64_t usage[ RemyTable::RULES ] {};
+};
+
+class Trainer
+{
+private:
+  SimulationConfig config_;
+  vector<shared_ptr<const LinkTrace>> traces_;
+  RemyController::Params params_ {};
+  double delta_ {1};
+  unsigned int jobs_ {1};
+
+public:
+  Trainer( const SimulationConfig & config,
+	   const vector<shared_ptr<const LinkTrace>> & traces,
+	   const double delta, const unsigned int jobs )
+    : config_( config ), traces_( traces ), delta_( delta ), jobs_( jobs )
+  {}
+
+  /* Score every table on every trace, in parallel. If `samples` is
+     given, it collects the signals seen (single table only). */
+  vector<Evaluation> evaluate( const vector<RemyTable> & tables,
+			       vector<float> * const samples = nullptr ) const
+  {
+    const size_t runs = tables.size() * traces_.size();
+    vector<Evaluation> per_run( runs );
+    atomic<size_t> next_run { 0 };
+    exception_ptr failure;
+    mutex failure_mutex, samples_mutex;
+
+    auto worker = [&] () {
+      try {
+	for ( size_t i = next_run++; i < runs; i = next_run++ ) {
+	  SimulationConfig run_config = config_;
+	  run_config.uplink = traces_[ i % traces_.size() ];
+	  RecordingRemyController controller( params_, tables[ i / traces_.size() ] );
+	  controller.recording = samples != nullptr;
+	  const SimulationResult result = LinkSimulator( run_config, controller ).run();
+
+	  Evaluation & run = per_run[ i ];
+	  run.throughput_mbps = result.throughput_mbps;
+	  run.p95_delay_ms = result.p95_delay_ms;
+	  run.score = log( max( result.throughput_mbps, 1e-9 ) )
+	    - delta_ * log( max( result.p95_delay_ms, 1.0 ) );
+	  copy( controller.usage, controller.usage + RemyTable::RULES, run.usage );
+
+	  if ( samples ) {
+	    lock_guard<mutex> lock( samples_mutex );
+	    for ( unsigned int s = 0; s < RemyTable::SIGNALS; s++ ) {
+	      samples[ s ].insert( samples[ s ].end(), controller.samples[ s ].begin(),
+				   controller.samples[ s ].end() );
+	    }
+	  }
+	}
+      } catch ( ... ) {
+	lock_guard<mutex> lock( failure_mutex );
+	failure = current_exception();
+	next_run = runs;
+      }
+    };
+
+    vector<thread> threads;
+    for ( unsigned int i = 0; i < min<size_t>( jobs_, runs ); i++ ) {
+      threads.emplace_back( worker );
+    }
+    for ( auto & t : threads ) {
+      t.join();
+    }
+    if ( failure ) {
+      rethrow_exception( failure );
+    }
+
+    /* average over traces */
+    vector<Evaluation> ret( tables.size() );
+    for ( size_t i = 0; i < runs; i++ ) {
+      Evaluation & total = ret[ i / traces_.size() ];
+      const Evaluation & run = per_run[ i ];
+      total.score += run.score / traces_.size();
+      total.throughput_mbps += run.throughput_mbps / traces_.size();
+      total.p95_delay_ms += run.p95_delay_ms / traces_.size();
+      for ( unsigned int r = 0; r < RemyTable::RULES; r++ ) {
+	total.usage[ r ] += run.usage[ r ];
+      }
+    }
+    return ret;
+  }
+
+  Evaluation evaluate( const RemyTable & table ) const
+  {
+    return evaluate( vector<RemyTable>( 1, table ) ).front();
+  }
+
+  /* Move each signal's boundaries to the quartiles of what it sees
+     under `table`, so every bin gets used */
+  RemyTable fit_boundaries( const RemyTable & table ) const
+  {
+    vector<float> samples[ RemyTable::SIGNALS ];
+    evaluate( vector<RemyTable>( 1, table ), samples );
+
+    RemyTable ret = table;
+    for ( unsigned int s = 0; s < RemyTable::SIGNALS; s++ ) {
+      vector<float> & values = samples[ s ];
+      if ( values.empty() ) {
+	continue;
+      }
+      sort( values.begin(), values.end() );
+      for ( unsigned int b = 0; b < RemyTable::BINS - 1; b++ ) {
+	ret.boundaries[ s ][ b ] = values[ values.size() * (b + 1) / RemyTable::BINS ];
+      }
+    }
+    return ret;
+  }
+};
+
+/* Tables that differ from `table` in one field of one rule */
+static vector<RemyTable> neighbours( const RemyTable & table, const unsigned int rule )
+{
+  const RemyAction & action = table.actions[ rule ];
+  vector<RemyAction> actions;
+
+  for ( const float step : { -4.0f, -1.0f, -0.25f, 0.25f, 1.0f, 4.0f } ) {
+    actions.push_back( action );
+    actions.back().window_increment += step;
+  }
+  for ( const float step : { -0.05f, -0.01f, 0.01f, 0.05f } ) {
+    if ( action.window_multiple + step >= 0 ) {
+      actions.push_back( action );
+      actions.back().window_multiple += step;
+    }
+  }
+  if ( action.intersend_ms > 0 ) {
+    for ( const float factor : { 0.5f, 2.0f } ) {
+      actions.push_back( action );
+      actions.back().intersend_ms *= factor;
+    }
+    actions.push_back( action );
+    actions.back().intersend_ms = 0;
+  } else {
+    for ( const float intersend : { 0.05f, 0.2f } ) {
+      actions.push_back( action );
+      actions.back().intersend_ms = intersend;
+    }
+  }
+
+  vector<RemyTable> ret;
+  for ( const auto & candidate : actions ) {
+    ret.push_back( table );
+    ret.back().actions[ rule ] = candidate;
+  }
+  return ret;
+}
+
+static void write_table( const RemyTable & table, const string & filename, const string & cxx_filename )
+{
+  {
+    ofstream out( filename );
+    out << "# RemyController rule table (remytrain)\n";
+    table.save( out );
+    if ( not out ) {
+      throw runtime_error( "cannot write " + filename );
+    }
+  }
+
+  if ( not cxx_filename.empty() ) {
+    ofstream out( cxx_filename );
+    out << "#ifndef REMY_DEFAULT_TABLE_HH\n#define REMY_DEFAULT_TABLE_HH\n\n"
+	<< "#include \"remycontroller.hh\"\n\n"
+	<< "/* Built-in rules for RemyController (generated by remytrain) */\n";
+    table.save_cxx( out, "REMY_DEFAULT_TABLE" );
+    out << "\n#endif\n";
+    if ( not out ) {
+      throw runtime_error( "cannot write " + cxx_filename );
+    }
+  }
+}
+
+static void usage( const char * const argv0 )
+{
+  cerr << "Usage: " << argv0 << " [options] -o TABLE TRACE..." << endl
+       << "  -o, --output=FILE        write the table here after every improvement" << endl
+       << "  -x, --cxx=FILE           also write it as a C++ header (remy_default_table.hh)" << endl
+       << "  -i, --input=FILE         start from this table (default: built-in)" << endl
+       << "  -e, --epochs=N           passes over the rules (default 2)" << endl
+       << "  -m, --max-steps=N        improvements tried per rule and pass (default 8)" << endl
+       << "  -f, --fit                first move bin boundaries to the signals' quartiles" << endl
+       << "  -D, --delta=X            objective ln(throughput) - X ln(delay) (default 1)" << endl
+       << "  -j, --jobs=N             worker threads (default: all cores)" << endl
+       << "  -d, --delay=MS           one-way propagation delay (default 20)" << endl
+       << "  -q, --queue=TYPE         droptail or codel (default droptail)" << endl
+       << "  -l, --queue-limit=PKTS   bottleneck queue limit (default unlimited)" << endl
+       << "  -t, --duration=MS        simulated time per trace (default one pass)" << endl;
+}
+
+int main( int argc, char *argv[] )
+{
+  /* check the command-line arguments */
+  if ( argc < 1 ) { /* for sticklers */
+    abort();
+  }
+
+  const option options[] = {
+    { "output",      required_argument, nullptr, 'o' },
+    { "cxx",         required_argument, nullptr, 'x' },
+    { "input",       required_argument, nullptr, 'i' },
+    { "epochs",      required_argument, nullptr, 'e' },
+    { "max-steps",   required_argument, nullptr, 'm' },
+    { "fit",         no_argument,       nullptr, 'f' },
+    { "delta",       required_argument, nullptr, 'D' },
+    { "jobs",        required_argument, nullptr, 'j' },
+    { "delay",       required_argument, nullptr, 'd' },
+    { "queue",       required_argument, nullptr, 'q' },
+    { "queue-limit", required_argument, nullptr, 'l' },
+    { "duration",    required_argument, nullptr, 't' },
+    { nullptr,       0,                 nullptr, 0 }
+  };
+
+  try {
+    string output, cxx_output;
+    RemyTable table = RemyController::default_table();
+    unsigned int epochs = 2, max_steps = 8;
+    bool fit = false;
+    double delta = 1;
+    unsigned int jobs = max( 1u, thread::hardware_concurrency() );
+    SimulationConfig config;
+
+    int opt;
+    while ( (opt = getopt_long( argc, argv, "o:x:i:e:m:fD:j:d:q:l:t:", options, nullptr )) != -1 ) {
+      switch ( opt ) {
+      case 'o': output = optarg; break;
+      case 'x': cxx_output = optarg; break;
+      case 'i': table = RemyTable::load( optarg ); break;
+      case 'e': epochs = strtoul( optarg, nullptr, 10 ); break;
+      case 'm': max_steps = strtoul( optarg, nullptr, 10 ); break;
+      case 'f': fit = true; break;
+      case 'D': delta = strtod( optarg, nullptr ); break;
+      case 'j': jobs = max( 1ul, strtoul( optarg, nullptr, 10 ) ); break;
+      case 'd': config.one_way_delay_ms = strtoull( optarg, nullptr, 10 ); break;
+      case 'q': config.queue_type = SimulationConfig::queue_type_from_name( optarg ); break;
+      case 'l': config.queue_limit_packets = strtoull( optarg, nullptr, 10 ); break;
+      case 't': config.duration_ms = strtoull( optarg, nullptr, 10 ); break;
+      default:
+	usage( argv[ 0 ] );
+	return EXIT_FAILURE;
+      }
+    }
+
+    if ( output.empty() or optind == argc ) {
+      usage( argv[ 0 ] );
+      return EXIT_FAILURE;
+    }
+
+    vector<shared_ptr<const LinkTrace>> traces;
+    for ( int i = optind; i < argc; i++ ) {
+      traces.push_back( make_shared<LinkTrace>( argv[ i ] ) );
+    }
+
+    const Trainer trainer( config, traces, delta, jobs );
+    const auto start = chrono::steady_clock::now();
+
+    if ( fit ) {
+      table = trainer.fit_boundaries( table );
+    }
+
+    Evaluation best = trainer.evaluate( table );
+    cerr << fixed << setprecision( 3 ) << "Initial score " << best.score
+	 << " (" << best.throughput_mbps << " Mbps, p95 " << best.p95_delay_ms << " ms)" << endl;
+    write_table( table, output, cxx_output );
+
+    for ( unsigned int epoch = 0; epoch < epochs; epoch++ ) {
+      /* most-used rules first; rules that never fire cannot be scored */
+      vector<unsigned int> order;
+      for ( unsigned int r = 0; r < RemyTable::RULES; r++ ) {
+	if ( best.usage[ r ] ) {
+	  order.push_back( r );
+	}
+      }
+      sort( order.begin(), order.end(),
+	    [&] ( const unsigned int a, const unsigned int b ) { return best.usage[ a ] > best.usage[ b ]; } );
+
+      for ( const unsigned int rule : order ) {
+	for ( unsigned int step = 0; step < max_steps; step++ ) {
+	  const vector<RemyTable> candidates = neighbours( table, rule );
+	  const vector<Evaluation> results = trainer.evaluate( candidates );
+	  const size_t winner = max_element( results.begin(), results.end(),
+					     [] ( const Evaluation & a, const Evaluation & b ) {
+					       return a.score < b.score; } ) - results.begin();
+	  if ( results[ winner ].score <= best.score + 1e-6 ) {
+	    break;
+	  }
+
+	  table = candidates[ winner ];
+	  best = results[ winner ];
+	  write_table( table, output, cxx_output );
+
+	  const RemyAction & action = table.actions[ rule ];
+	  cerr << "Epoch " << epoch + 1 << " rule " << setw( 2 ) << rule
+	       << " -> (" << action.window_increment << ", " << action.window_multiple
+	       << ", " << action.intersend_ms << "): score " << best.score
+	       << " (" << best.throughput_mbps << " Mbps, p95 " << best.p95_delay_ms << " ms)" << endl;
+	}
+      }
+    }
+
+    cerr << "Done in " << setprecision( 1 )
+	 << chrono::duration<double>( chrono::steady_clock::now() - start ).count() << " s" << endl;
+  } catch ( const exception & e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
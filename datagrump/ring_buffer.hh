@@ -0,0 +1,195 @@
+#ifndef RING_BUFFER_HH
+#define RING_BUFFER_HH
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+
+/* Fixed-capacity FIFO of (timestamp, value) samples for the controllers'
+   sliding windows. Storage is allocated once, up front, as two
+   cache-line-aligned arrays (timestamps and values kept apart, so a scan
+   or binary search over timestamps touches contiguous memory). Pushing
+   onto a full ring drops the oldest sample; nothing allocates afterwards. */
+template <typename Value>
+class SampleRing
+{
+  static_assert( std::is_trivially_copyable<Value>::value,
+		 "SampleRing values must be trivially copyable" );
+
+private:
+  struct FreeDeleter {
+    void operator()( void * const ptr ) const { free( ptr ); }
+  };
+
+  template <typename T>
+  static T * allocate( const size_t count )
+  {
+    void * ptr = nullptr;
+    if ( posix_memalign( &ptr, 64, count * sizeof( T ) ) ) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T *>( ptr );
+  }
+
+  /* smallest power of two >= n */
+  static size_t round_up( const size_t n )
+  {
+    size_t ret = 1;
+    while ( ret < n ) {
+      ret <<= 1;
+    }
+    return ret;
+  }
+
+  size_t capacity_;
+  size_t mask_;
+  std::unique_ptr<uint64_t[], FreeDeleter> times_;
+  std::unique_ptr<Value[], FreeDeleter> values_;
+  size_t head_ {0}; /* physical index of the oldest sample */
+  size_t size_ {0};
+
+  size_t slot( const size_t i ) const { return (head_ + i) & mask_; }
+
+public:
+  /* Room for at least min_capacity samples */
+  SampleRing( const size_t min_capacity )
+    : capacity_( round_up( min_capacity ) ),
+      mask_( capacity_ - 1 ),
+      times_( allocate<uint64_t>( capacity_ ) ),
+      values_( allocate<Value>( capacity_ ) )
+  {}
+
+  size_t size( void ) const { return size_; }
+  size_t capacity( void ) const { return capacity_; }
+  bool empty( void ) const { return size_ == 0; }
+  bool full( void ) const { return size_ == capacity_; }
+
+  /* Append a sample (dropping the oldest if full) */
+  void push_back( const uint64_t time, const Value & value )
+  {
+    if ( full() ) {
+      pop_front();
+    }
+    const size_t i = slot( size_++ );
+    times_[ i ] = time;
+    values_[ i ] = value;
+  }
+
+  void pop_front( void ) { head_ = (head_ + 1) & mask_; size_--; }
+  void pop_back( void ) { size_--; }
+  void clear( void ) { head_ = size_ = 0; }
+
+  /* i-th oldest sample */
+  uint64_t time( const size_t i ) const { return times_[ slot( i ) ]; }
+  const Value & value( const size_t i ) const { return values_[ slot( i ) ]; }
+  Value & value( const size_t i ) { return values_[ slot( i ) ]; }
+
+  uint64_t front_time( void ) const { return time( 0 ); }
+  const Value & front_value( void ) const { return value( 0 ); }
+  uint64_t back_time( void ) const { return time( size_ - 1 ); }
+  const Value & back_value( void ) const { return value( size_ - 1 ); }
+  Value & back_value( void ) { return value( size_ - 1 ); }
+
+  /* Index of the first sample stamped after `time` (size() if none);
+     timestamps must have been pushed in non-decreasing order */
+  size_t upper_bound( const uint64_t time ) const
+  {
+    size_t low = 0, high = size_;
+    while ( low < high ) {
+      const size_t mid = low + (high - low) / 2;
+      if ( this->time( mid ) <= time ) {
+	low = mid + 1;
+      } else {
+	high = mid;
+      }
+    }
+    return low;
+  }
+
+  /* forbid copying SampleRing objects or assigning them */
+  SampleRing( const SampleRing & other ) = delete;
+  const SampleRing & operator=( const SampleRing & other ) = delete;
+
+  SampleRing( SampleRing && other ) = default;
+};
+
+/* Unbounded FIFO for the packet path: a deque that never gives memory
+   back. Storage is one power-of-two ring that doubles when full and is
+   kept, so once it has grown to the working set (e.g. the datagrams in
+   flight) pushing and popping never allocate; a std::deque allocates a
+   block for every few dozen pushes, forever. */
+template <typename Value>
+class Fifo
+{
+  static_assert( std::is_trivially_copyable<Value>::value,
+		 "Fifo values must be trivially copyable" );
+
+private:
+  std::unique_ptr<Value[]> values_;
+  size_t mask_;
+  size_t head_ {0}; /* physical index of the oldest value */
+  size_t size_ {0};
+
+  size_t slot( const size_t i ) const { return (head_ + i) & mask_; }
+
+  void grow( void )
+  {
+    const size_t capacity = 2 * (mask_ + 1);
+    std::unique_ptr<Value[]> values( new Value[ capacity ] );
+    for ( size_t i = 0; i < size_; i++ ) {
+      values[ i ] = values_[ slot( i ) ];
+    }
+    values_ = std::move( values );
+    mask_ = capacity - 1;
+    head_ = 0;
+  }
+
+public:
+  /* Room for `initial_capacity` values (a power of two) before growing */
+  Fifo( const size_t initial_capacity = 64 )
+    : values_( new Value[ initial_capacity ] ),
+      mask_( initial_capacity - 1 )
+  {
+    if ( initial_capacity == 0 or (initial_capacity & mask_) ) {
+      throw std::invalid_argument( "Fifo: capacity must be a power of two" );
+    }
+  }
+
+  size_t size( void ) const { return size_; }
+  bool empty( void ) const { return size_ == 0; }
+
+  void push_back( const Value & value )
+  {
+    if ( size_ == mask_ + 1 ) {
+      grow();
+    }
+    values_[ slot( size_++ ) ] = value;
+  }
+
+  void pop_front( void ) { head_ = (head_ + 1) & mask_; size_--; }
+
+  /* Remove the i-th oldest value, keeping the order of the rest */
+  void erase( const size_t i )
+  {
+    for ( size_t j = i; j + 1 < size_; j++ ) {
+      values_[ slot( j ) ] = values_[ slot( j + 1 ) ];
+    }
+    size_--;
+  }
+
+  /* i-th oldest value */
+  const Value & operator[]( const size_t i ) const { return values_[ slot( i ) ]; }
+  Value & operator[]( const size_t i ) { return values_[ slot( i ) ]; }
+
+  const Value & front( void ) const { return values_[ head_ ]; }
+  const Value & back( void ) const { return values_[ slot( size_ - 1 ) ]; }
+
+  /* forbid copying Fifo objects or assigning them */
+  Fifo( const Fifo & other ) = delete;
+  const Fifo & operator=( const Fifo & other ) = delete;
+};
+
+#endif /* RING_BUFFER_HH */
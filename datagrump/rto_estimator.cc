@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <cmath>
+
+#include "rto_estimator.hh"
+
+using namespace std;
+
+RtoEstimator::RtoEstimator( const uint64_t min_rto_us, const uint64_t max_rto_us )
+  : min_rto_us_( min_rto_us ),
+    max_rto_us_( max( min_rto_us, max_rto_us ) )
+{}
+
+void RtoEstimator::rtt_sample( const uint64_t rtt_us )
+{
+  if ( not have_sample_ ) {
+    srtt_us_ = rtt_us;
+    rttvar_us_ = rtt_us / 2.0;
+    have_sample_ = true;
+  } else {
+    rttvar_us_ = 0.75 * rttvar_us_ + 0.25 * fabs( srtt_us_ - rtt_us );
+    srtt_us_ = 0.875 * srtt_us_ + 0.125 * rtt_us;
+  }
+
+  backoffs_ = 0;
+  probe_sent_ = false;
+}
+
+uint64_t RtoEstimator::rto_us( void ) const
+{
+  const double base = have_sample_
+    ? srtt_us_ + max<double>( GRANULARITY_US, 4 * rttvar_us_ )
+    : INITIAL_RTO_US;
+  const uint64_t rto = min<double>( max<double>( base, min_rto_us_ ), max_rto_us_ );
+  return min( rto << backoffs_, max_rto_us_ );
+}
+
+uint64_t RtoEstimator::timeout_us( void ) const
+{
+  const uint64_t rto = rto_us();
+  if ( not have_sample_ or probe_sent_ ) {
+    return rto;
+  }
+
+  /* the probe is only worth sending if it comes before the RTO */
+  return min<uint64_t>( 2 * srtt_us_ + GRANULARITY_US, rto );
+}
+
+RtoEstimator::Expiry RtoEstimator::timed_out( void )
+{
+  if ( have_sample_ and not probe_sent_ and timeout_us() < rto_us() ) {
+    probe_sent_ = true;
+    return Expiry::Probe;
+  }
+
+  backoffs_ = min( backoffs_ + 1, MAX_BACKOFFS );
+  return Expiry::Rto;
+}
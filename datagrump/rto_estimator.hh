@@ -0,0 +1,54 @@
+#ifndef RTO_ESTIMATOR_HH
+#define RTO_ESTIMATOR_HH
+
+#include <cstdint>
+
+/* When the sender should stop waiting for acks, in microseconds.
+   RFC 6298: SRTT and RTTVAR from RTT samples (gains 1/8 and 1/4),
+   RTO = SRTT + max(G, 4 * RTTVAR) clamped to [min_rto, max_rto],
+   1 s before the first sample, doubling with each expiry until the
+   next sample. A tail-loss probe (RFC 8985) comes first: after
+   2 * SRTT without an ack the sender sends one datagram to draw an
+   ack, and only if that fails too does the RTO expire. The timer
+   restarts at every event, as the sender's poll() does. */
+class RtoEstimator
+{
+public:
+  enum class Expiry { Probe, Rto };
+
+private:
+  static const uint64_t INITIAL_RTO_US = 1000000;
+  static const uint64_t GRANULARITY_US = 1000;  /* RTT samples are whole ms */
+  static const unsigned int MAX_BACKOFFS = 6;
+
+  uint64_t min_rto_us_;
+  uint64_t max_rto_us_;
+
+  bool have_sample_ {false};
+  double srtt_us_ {0};
+  double rttvar_us_ {0};
+  unsigned int backoffs_ {0};
+  bool probe_sent_ {false};
+
+public:
+  RtoEstimator( const uint64_t min_rto_us = 200000,
+		const uint64_t max_rto_us = 60000000 );
+
+  /* A new RTT sample (us); ends any backoff */
+  void rtt_sample( const uint64_t rtt_us );
+
+  /* The retransmission timeout, including backoff */
+  uint64_t rto_us( void ) const;
+
+  /* How long to wait for the next ack: the probe timeout until a probe
+     has been sent since the last ack, then the RTO */
+  uint64_t timeout_us( void ) const;
+
+  /* The timer expired: was that the probe timeout, or the RTO? */
+  Expiry timed_out( void );
+
+  double srtt_us( void ) const { return srtt_us_; }
+  double rttvar_us( void ) const { return rttvar_us_; }
+};
+
+#endif /* RTO_ESTIMATOR_HH */
@@ -79,9 +79,3 @@ void RttController::timed_out()
   }
 }
 
-/* How long to wait (in milliseconds) if there are no acks
-   before sending one more datagram */
-unsigned int RttController::timeout_ms( void )
-{
-  return 1000; /* timeout of one second */
-}
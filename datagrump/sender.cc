@@ -1,45 +1,170 @@
 /* UDP sender for congestion-control contest */
 
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
 #include <chrono>
 #include <iostream>
-#include <thread>
+#include <memory>
+
+#include <getopt.h>
 
 #include "socket.hh"
+#include "alloc_counter.hh"
 #include "contest_message.hh"
-#include "metacontroller.hh"
-#include "lattecontroller.hh"
+#include "controller_factory.hh"
+#include "header_batch.hh"
+#include "loss_detector.hh"
+#include "fec.hh"
+#include "metrics.hh"
+#include "path_cache.hh"
+#include "path_scheduler.hh"
 #include "poller.hh"
+#include "rto_estimator.hh"
+#include "timestamp.hh"
+#include "util.hh"
 
 using namespace std;
 using namespace PollerShortNames;
 
+/* one route to the receiver, with its own socket, controller and
+   transport state */
+struct Path
+{
+  UDPSocket socket;
+  unique_ptr<Controller> controller; /* your class */
+
+  uint64_t sequence_number; /* next outgoing sequence number (untagged) */
+
+  /* which datagrams are still in flight, and which were lost */
+  LossDetector loss_detector;
+
+  /* how long to wait for an ack before probing, then timing out; the
+     timer restarts at each send or ack on this path */
+  RtoEstimator rto;
+  chrono::steady_clock::time_point timer_start;
+
+  /* when the controller's pacing allows the next datagram */
+  chrono::steady_clock::time_point next_send;
+
+  /* whether this path's estimates go to the path cache (under its
+     destination IP), and when they last did */
+  bool use_path_cache;
+  string path_cache_key;
+  uint64_t last_path_store;
+
+  Path( const string & controller_name, const bool debug )
+    : socket(),
+      controller( make_controller( controller_name, debug ) ),
+      sequence_number( 0 ),
+      loss_detector(),
+      rto(),
+      timer_start( chrono::steady_clock::now() ),
+      next_send( timer_start ),
+      use_path_cache( false ),
+      path_cache_key(),
+      last_path_store( 0 )
+  {}
+
+  bool window_is_open( void ) const
+  {
+    return loss_detector.in_flight() < controller->window_size();
+  }
+
+  chrono::steady_clock::time_point timeout( void ) const
+  {
+    return timer_start + chrono::microseconds( rto.timeout_us() );
+  }
+};
+
+/* All messages use the same dummy payload */
+static const string dummy_payload( 1424, 'x' );
+
+/* where a path goes, and optionally the local address it leaves from */
+struct PathSpec
+{
+  string host;
+  string port;
+  string local_ip;
+};
+
 /* simple sender class to handle the accounting */
 class DatagrumpSender
 {
 private:
-  UDPSocket socket_;
-  LatteController controller_; /* your class */
+  /* one path unless multipath; the scheduler places each datagram */
+  vector<unique_ptr<Path>> paths_;
+  PathScheduler scheduler_;
+  vector<PathStatus> path_status_;
+  size_t waiting_for_; /* the path the scheduler last held out for */
+
+  /* the latest burst of acks, their headers, and what the controller
+     is told of them */
+  vector<UDPSocket::received_datagram> acks_;
+  HeaderBatch ack_headers_;
+  vector<Ack> ack_batch_;
 
-  uint64_t sequence_number_; /* next outgoing sequence number */
+  /* live metrics (summed over paths), readable with grumpstat */
+  MetricsRegistry metrics_;
+  Counter datagrams_sent_, acks_received_, bytes_acked_, timeouts_, probes_;
+  Counter datagrams_lost_, reorderings_, fec_repairs_sent_, heap_allocations_;
+  Histogram rtt_ms_;
+  Gauge cwnd_, interpkt_delay_us_;
+  uint64_t allocations_counted_ {0};
 
-  /* if network does not reorder or lose datagrams,
-     this is the sequence number that the sender
-     next expects will be acknowledged by the receiver */
-  uint64_t next_ack_expected_;
+  /* the outgoing datagram's wire representation, reused so that
+     nothing on the packet path allocates once warmed up */
+  string datagram_ {};
 
-  void send_datagram( void );
-  void got_ack( const uint64_t timestamp, const ContestMessage & msg );
-  void handle_timeout(void);
-  bool window_is_open( void );
-  void moderate_packets( void );
+  /* repair datagrams over all paths' payloads (null if no FEC) */
+  unique_ptr<FecEncoder> fec_;
+
+  /* what earlier runs learned about each path (null if unavailable) */
+  unique_ptr<PathCache> path_cache_;
+
+  void send_scheduled( void );
+  void send_datagram( const unsigned int path_id );
+  void read_acks( const unsigned int path_id );
+  void got_ack( Path & path, const Ack & ack, const uint64_t payload_length );
+  void handle_timeout( const unsigned int path_id );
+  void report_losses( Path & path, const uint64_t timestamp );
+  void store_path_estimate( Path & path, const uint64_t timestamp );
 
 public:
-  DatagrumpSender( const char * const host, const char * const port,
-		   const bool debug );
+  DatagrumpSender( const vector<PathSpec> & paths, const string & controller,
+		   const PathScheduler::Policy policy, const bool fec,
+		   const FecHeader::Scheme fec_scheme, const bool debug );
   int loop( void );
 };
 
+static void usage( const char * const argv0 )
+{
+  cerr << "Usage: " << argv0 << " [options] HOST PORT [CONTROLLER] [debug]" << endl
+       << "  -P, --path=HOST:PORT[/LOCAL_IP]  send over another path as well (repeatable);" << endl
+       << "                                   LOCAL_IP binds it to a local address" << endl
+       << "  -s, --scheduler=NAME             lowest-rtt (default) or earliest-delivery" << endl
+       << "  -f, --fec=SCHEME                 send repair datagrams: xor or rs (Reed-Solomon)" << endl;
+  cerr << "Controllers:";
+  for ( const auto & name : controller_names() ) {
+    cerr << " " << name;
+  }
+  cerr << " (default latte; remy:TABLE for a trained rule table)" << endl;
+}
+
+/* HOST:PORT[/LOCAL_IP], split at the last colon so IPv6 hosts work */
+static PathSpec parse_path( const string & spec )
+{
+  const size_t slash = spec.find( '/' );
+  const string destination = spec.substr( 0, slash );
+  const size_t colon = destination.rfind( ':' );
+  if ( colon == string::npos or colon == 0 or colon + 1 == destination.size() ) {
+    throw runtime_error( "bad path " + spec + " (HOST:PORT[/LOCAL_IP])" );
+  }
+
+  return { destination.substr( 0, colon ), destination.substr( colon + 1 ),
+	   slash == string::npos ? "" : spec.substr( slash + 1 ) };
+}
+
 int main( int argc, char *argv[] )
 {
    /* check the command-line arguments */
@@ -47,143 +172,395 @@ int main( int argc, char *argv[] )
     abort();
   }
 
+  const option options[] = {
+    { "path",      required_argument, nullptr, 'P' },
+    { "scheduler", required_argument, nullptr, 's' },
+    { "fec",       required_argument, nullptr, 'f' },
+    { nullptr,     0,                 nullptr, 0 }
+  };
+
+  vector<PathSpec> extra_paths;
+  PathScheduler::Policy policy = PathScheduler::Policy::LowestRtt;
+  bool fec = false;
+  FecHeader::Scheme fec_scheme = FecHeader::Scheme::Xor;
+
+  try {
+    int opt;
+    while ( (opt = getopt_long( argc, argv, "+P:s:f:", options, nullptr )) != -1 ) {
+      switch ( opt ) {
+      case 'P': extra_paths.push_back( parse_path( optarg ) ); break;
+      case 's': policy = PathScheduler::policy_from_name( optarg ); break;
+      case 'f':
+	fec = true;
+	fec_scheme = FecHeader::scheme_from_name( optarg );
+	break;
+      default:
+	usage( argv[ 0 ] );
+	return EXIT_FAILURE;
+      }
+    }
+  } catch ( const runtime_error & e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  /* the rest are positional, as before */
+  const char * const program = argv[ 0 ];
+  argv += optind - 1;
+  argc -= optind - 1;
+
   bool debug = false;
-  if ( argc == 4 and string( argv[ 3 ] ) == "debug" ) {
+  string controller = "latte";
+  if ( argc > 3 and string( argv[ argc - 1 ] ) == "debug" ) {
     debug = true;
-  } else if ( argc == 3 ) {
-    /* do nothing */
-  } else {
-    cerr << "Usage: " << argv[ 0 ] << " HOST PORT [debug]" << endl;
+    argc--;
+  }
+  if ( argc == 4 ) {
+    controller = argv[ 3 ];
+  }
+  const auto names = controller_names();
+  /* remy can also run a rule table from a file, as remy:TABLE */
+  const string base_name = controller.compare( 0, 5, "remy:" ) == 0 ? "remy" : controller;
+  if ( (argc != 3 and argc != 4)
+       or find( names.begin(), names.end(), base_name ) == names.end()
+       or extra_paths.size() + 1 > PathTag::MAX_PATHS ) {
+    usage( program );
     return EXIT_FAILURE;
   }
 
+  vector<PathSpec> paths = { { argv[ 1 ], argv[ 2 ], "" } };
+  paths.insert( paths.end(), extra_paths.begin(), extra_paths.end() );
+
   /* create sender object to handle the accounting */
   /* all the interesting work is done by the Controller */
-  DatagrumpSender sender( argv[ 1 ], argv[ 2 ], debug );
+  DatagrumpSender sender( paths, controller, policy, fec, fec_scheme, debug );
   return sender.loop();
 }
 
-DatagrumpSender::DatagrumpSender( const char * const host,
-				  const char * const port,
+/* The path cache is best-effort: without it we just start cold */
+static unique_ptr<PathCache> open_path_cache( void )
+{
+  const string filename = PathCache::default_filename();
+  try {
+    return unique_ptr<PathCache>( new PathCache( filename ) );
+  } catch ( const exception & e ) {
+    cerr << "Path cache " << filename << " unavailable ("
+	 << e.what() << "), starting cold" << endl;
+    return nullptr;
+  }
+}
+
+DatagrumpSender::DatagrumpSender( const vector<PathSpec> & paths,
+				  const string & controller,
+				  const PathScheduler::Policy policy,
+				  const bool fec,
+				  const FecHeader::Scheme fec_scheme,
 				  const bool debug )
-  : socket_(),
-    controller_( debug ),
-    sequence_number_( 0 ),
-    next_ack_expected_( 0 )
+  : paths_(),
+    scheduler_( policy ),
+    path_status_(),
+    waiting_for_( 0 ),
+    acks_( UDPSocket::make_batch( HeaderBatch::HEADER_SIZE ) ),
+    ack_headers_(),
+    ack_batch_(),
+    metrics_( "/datagrump-sender" ),
+    datagrams_sent_( metrics_.counter( "datagrams_sent" ) ),
+    acks_received_( metrics_.counter( "acks_received" ) ),
+    bytes_acked_( metrics_.counter( "bytes_acked" ) ),
+    timeouts_( metrics_.counter( "timeouts" ) ),
+    probes_( metrics_.counter( "probes" ) ),
+    datagrams_lost_( metrics_.counter( "datagrams_lost" ) ),
+    reorderings_( metrics_.counter( "reorderings" ) ),
+    fec_repairs_sent_( metrics_.counter( "fec_repairs_sent" ) ),
+    heap_allocations_( metrics_.counter( "heap_allocations" ) ),
+    rtt_ms_( metrics_.histogram( "rtt_ms" ) ),
+    cwnd_( metrics_.gauge( "cwnd" ) ),
+    interpkt_delay_us_( metrics_.gauge( "interpkt_delay_us" ) ),
+    fec_( fec ? new FecEncoder( fec_scheme, dummy_payload.size() ) : nullptr ),
+    path_cache_( open_path_cache() )
 {
-  /* turn on timestamps when socket receives a datagram */
-  socket_.set_timestamps();
+  metrics_.publish();
+  ack_batch_.reserve( UDPSocket::MAX_BATCH );
+
+  for ( const auto & spec : paths ) {
+    paths_.emplace_back( new Path( controller, debug ) );
+    Path & path = *paths_.back();
+
+    /* turn on timestamps when socket receives a datagram */
+    path.socket.set_timestamps();
+
+    /* leave from a particular local address (e.g. one interface) */
+    if ( not spec.local_ip.empty() ) {
+      path.socket.bind( Address( spec.local_ip, 0 ) );
+    }
+
+    /* connect socket to the remote host */
+    /* (note: this doesn't send anything; it just tags the socket
+       locally with the remote address */
+    path.socket.connect( Address( spec.host, spec.port ) );
+
+    cerr << "Sending to " << path.socket.peer_address().to_string();
+    if ( paths.size() > 1 ) {
+      cerr << " from " << path.socket.local_address().to_string()
+	   << " (path " << paths_.size() - 1 << ")";
+    }
+    cerr << endl;
+  }
+  path_status_.resize( paths_.size() );
+  waiting_for_ = paths_.size();
 
-  /* connect socket to the remote host */
-  /* (note: this doesn't send anything; it just tags the socket
-     locally with the remote address */
-  socket_.connect( Address( host, port ) );
+  if ( paths_.size() > 1 ) {
+    cerr << "Scheduling datagrams " << PathScheduler::name( policy ) << " first" << endl;
+  }
+
+  /* The cache is keyed by destination IP, so it can only speak for a
+     path whose destination no other path shares */
+  for ( auto & path : paths_ ) {
+    path->use_path_cache = path_cache_ and 1 == count_if( paths_.begin(), paths_.end(),
+      [&] ( const unique_ptr<Path> & other ) {
+	return other->socket.peer_address().ip() == path->socket.peer_address().ip();
+      } );
 
-  cerr << "Sending to " << socket_.peer_address().to_string() << endl;
+    path->path_cache_key = path->socket.peer_address().ip();
+
+    /* start from what the last run to this host measured */
+    PathEstimate estimate;
+    if ( path->use_path_cache and path_cache_->lookup( path->path_cache_key, estimate ) ) {
+      cerr << "Warm start from path cache: min RTT " << estimate.min_rtt_ms
+	   << " ms, " << estimate.max_bw << " pkts/ms, confidence "
+	   << estimate.confidence << endl;
+      path->controller->warm_start( estimate );
+    }
+  }
 }
 
-void DatagrumpSender::got_ack( const uint64_t timestamp,
-			       const ContestMessage & ack )
+/* Write the controller's view of the path back to the cache, about once
+   a second. The update goes straight into the shared mapping, so it
+   outlives the sender however it exits. */
+void DatagrumpSender::store_path_estimate( Path & path, const uint64_t timestamp )
 {
-  if ( not ack.is_ack() ) {
-    throw runtime_error( "sender got something other than an ack from the receiver" );
+  if ( not path.use_path_cache or timestamp < path.last_path_store + 1000 ) {
+    return;
   }
 
-  /* Update sender's counter */
-  next_ack_expected_ = max( next_ack_expected_,
-			    ack.header.ack_sequence_number + 1 );
+  PathEstimate estimate;
+  if ( not path.controller->path_estimate( estimate ) ) {
+    return;
+  }
+  estimate.loss_rate = double( path.loss_detector.lost() ) / max<uint64_t>( path.sequence_number, 1 );
 
-  /* Inform congestion controller */
-  controller_.ack_received( ack.header.ack_sequence_number,
-			    ack.header.ack_send_timestamp,
-			    ack.header.ack_recv_timestamp,
-			    timestamp );
+  path_cache_->store( path.path_cache_key, estimate );
+  path.last_path_store = timestamp;
 }
 
-void DatagrumpSender::send_datagram( void )
+/* Read every ack waiting on a path's socket (up to a batch) with one
+   system call, decode their headers together, and hand them to the
+   path's controller as one burst */
+void DatagrumpSender::read_acks( const unsigned int path_id )
 {
-  /* All messages use the same dummy payload */
-  static const string dummy_payload( 1424, 'x' );
+  Path & path = *paths_[ path_id ];
 
-  ContestMessage cm( sequence_number_++, dummy_payload );
-  cm.set_send_timestamp();
-  socket_.send( cm.to_string() );
+  const size_t count = path.socket.recv_batch( acks_ );
+  ack_headers_.decode( acks_, count );
+
+  ack_batch_.clear();
+  for ( size_t i = 0; i < count; i++ ) {
+    if ( not ack_headers_.valid[ i ] ) {
+      throw runtime_error( "contest message too small to contain header" );
+    }
+    if ( ack_headers_.ack_sequence_number[ i ] == uint64_t( -1 ) ) {
+      throw runtime_error( "sender got something other than an ack from the receiver" );
+    }
+    if ( PathTag::path( ack_headers_.ack_sequence_number[ i ] ) != path_id ) {
+      throw runtime_error( "sender got an ack for another path" );
+    }
+
+    ack_batch_.push_back( { PathTag::sequence_number( ack_headers_.ack_sequence_number[ i ] ),
+			    ack_headers_.ack_send_timestamp[ i ],
+			    ack_headers_.ack_recv_timestamp[ i ],
+			    acks_[ i ].timestamp } );
+  }
 
   /* Inform congestion controller */
-  controller_.datagram_was_sent( cm.header.sequence_number,
-				 cm.header.send_timestamp );
+  path.controller->acks_received( ack_batch_.data(), ack_batch_.size() );
+
+  for ( size_t i = 0; i < count; i++ ) {
+    got_ack( path, ack_batch_[ i ], ack_headers_.ack_payload_length[ i ] );
+  }
+
+  if ( count > 0 ) {
+    path.timer_start = chrono::steady_clock::now();
+
+    unsigned int cwnd = 0;
+    for ( const auto & each : paths_ ) {
+      cwnd += each->controller->window_size();
+    }
+    cwnd_.set( cwnd );
+    store_path_estimate( path, ack_batch_.back().timestamp_ack_received );
+  }
+}
+
+/* What an ack the controller has seen says about other datagrams */
+void DatagrumpSender::got_ack( Path & path, const Ack & ack, const uint64_t payload_length )
+{
+  const uint64_t timestamp = ack.timestamp_ack_received;
+
+  const auto ack_type = path.loss_detector.ack_received( ack.sequence_number_acked, timestamp );
+  if ( ack_type == LossDetector::AckType::Reordered ) {
+    path.controller->reordering_detected( ack.sequence_number_acked, timestamp );
+    reorderings_.add();
+  }
+  report_losses( path, timestamp );
+
+  const uint64_t rtt = timestamp - ack.send_timestamp_acked;
+  path.rto.rtt_sample( rtt * 1000 );
+
+  acks_received_.add();
+  bytes_acked_.add( HeaderBatch::HEADER_SIZE + payload_length );
+  rtt_ms_.record( rtt );
+  if ( fec_ ) {
+    fec_->delivery_observed( false );
+  }
 }
 
-bool DatagrumpSender::window_is_open( void )
+void DatagrumpSender::send_datagram( const unsigned int path_id )
 {
-  return sequence_number_ - next_ack_expected_ < controller_.window_size();
+  Path & path = *paths_[ path_id ];
+
+  const uint64_t sequence_number = path.sequence_number++;
+  /* with FEC, the dummy payload carries its header (or a repair) */
+  const string & payload = fec_ ? fec_->next_payload( dummy_payload ) : dummy_payload;
+  ContestMessage::Header header( PathTag::tag( path_id, sequence_number ) );
+  header.send_timestamp = timestamp_ms();
+  ContestMessage::serialize( header, payload, datagram_ );
+  path.socket.send( datagram_ );
+
+  /* Inform congestion controller */
+  path.controller->datagram_was_sent( sequence_number, header.send_timestamp );
+  path.loss_detector.datagram_sent( sequence_number, header.send_timestamp );
+
+  datagrams_sent_.add();
+  if ( fec_ and fec_->last_was_repair() ) {
+    fec_repairs_sent_.add();
+  }
+
+  /* the controller paces datagrams this far apart (us) */
+  const auto now = chrono::steady_clock::now();
+  const float waittime = path.controller->get_interpkt_delay();
+  interpkt_delay_us_.set( waittime );
+  path.timer_start = now;
+  path.next_send = (isfinite( waittime ) and waittime > 0)
+    ? now + chrono::microseconds( static_cast<int64_t>( waittime ) ) : now;
 }
 
-void DatagrumpSender::handle_timeout(void) {
-  controller_.timed_out();
-  send_datagram();
+/* Send while the scheduler finds a path that may take a datagram */
+void DatagrumpSender::send_scheduled( void )
+{
+  while ( true ) {
+    const auto now = chrono::steady_clock::now();
+    for ( size_t i = 0; i < paths_.size(); i++ ) {
+      const Path & path = *paths_[ i ];
+      const auto pacing = max( path.next_send - now, chrono::steady_clock::duration::zero() );
+      path_status_[ i ] = { path.window_is_open() and path.next_send <= now,
+			    path.rto.srtt_us() > 0,
+			    path.rto.srtt_us(),
+			    double( path.loss_detector.in_flight() ),
+			    double( path.controller->window_size() ),
+			    double( chrono::duration_cast<chrono::microseconds>( pacing ).count() ) };
+    }
+
+    if ( not scheduler_.pick( path_status_, waiting_for_ ) ) {
+      return;
+    }
+    send_datagram( waiting_for_ );
+  }
 }
 
-void DatagrumpSender::moderate_packets(void) {
-  float waittime = controller_.get_interpkt_delay();
-  std::this_thread::sleep_for(std::chrono::microseconds(static_cast<int>(waittime)));
-  /*
-  bool sleep = true;
-  auto start = std::chrono::system_clock::now();
-  while(sleep)
-  {
-    auto now = std::chrono::system_clock::now();
-    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - start);
-    if ( elapsed.count() > waittime ) {
-        sleep = false;
+/* Tell the controller about datagrams the loss detector gave up on */
+void DatagrumpSender::report_losses( Path & path, const uint64_t timestamp )
+{
+  for ( const auto & lost : path.loss_detector.newly_lost() ) {
+    path.controller->datagram_lost( lost.sequence_number, lost.send_timestamp, timestamp );
+    datagrams_lost_.add();
+    if ( fec_ ) {
+      fec_->delivery_observed( true );
     }
   }
-  */
-  //cerr << "Wait for: " << waittime << endl;
 }
 
+void DatagrumpSender::handle_timeout( const unsigned int path_id ) {
+  Path & path = *paths_[ path_id ];
+
+  /* a tail-loss probe: one more datagram to draw an ack, in case only
+     the last few were lost */
+  if ( path.rto.timed_out() == RtoEstimator::Expiry::Probe ) {
+    probes_.add();
+    send_datagram( path_id );
+    return;
+  }
+
+  /* datagrams out longer than an RTT will not be acked now */
+  const uint64_t timestamp = timestamp_ms();
+  path.loss_detector.timed_out( timestamp );
+  report_losses( path, timestamp );
+
+  path.controller->timed_out();
+  timeouts_.add();
+  send_datagram( path_id );
+}
 
 int DatagrumpSender::loop( void )
 {
   /* read and write from the receiver using an event-driven "poller" */
   Poller poller;
 
-  /* first rule: if the window is open, close it by
-     sending more datagrams */
-
-  poller.add_action( Action( socket_, Direction::Out,
-        /* Close the window */
-        //[&] () { while ( window_is_open() ) { send_datagram(); } return ResultType::Continue; },
-
-        [&] () {
-        while ( window_is_open() ) {
-          send_datagram();
-          moderate_packets();
-        }
-        return ResultType::Continue;
-        },
-
-      /* We're only interested in this rule when the window is open */
-      [&] () { return window_is_open(); } ) );
-
-  /* second rule: if sender receives an ack,
-     process it and inform the controller
-     (by using the sender's got_ack method) */
-  poller.add_action( Action( socket_, Direction::In, [&] () {
-	const UDPSocket::received_datagram recd = socket_.recv();
-	const ContestMessage ack  = recd.payload;
-	got_ack( recd.timestamp, ack );
-	return ResultType::Continue;
-      } ) );
-
-  /* Run these two rules forever */
+  /* if a path's sender receives acks, process them and inform its
+     controller (by using the sender's got_ack method) */
+  for ( unsigned int i = 0; i < paths_.size(); i++ ) {
+    poller.add_action( Action( paths_[ i ]->socket, Direction::In, [this, i] () {
+	  read_acks( i );
+	  return ResultType::Continue;
+	} ) );
+  }
+
   while ( true ) {
-    const auto ret = poller.poll( controller_.timeout_ms() );
+    /* if any window is open, close it by sending more datagrams
+       (UDP sockets are writable but for a full buffer, where send()
+       just blocks) */
+    send_scheduled();
+
+    /* sleep until an ack, the next paced datagram, or a path's timer.
+       If the scheduler is holding out for the fastest path, the
+       others' pacing does not matter (it has passed, so counting it
+       would only spin). */
+    const auto now = chrono::steady_clock::now();
+    auto wake = chrono::steady_clock::time_point::max();
+    for ( size_t i = 0; i < paths_.size(); i++ ) {
+      const Path & path = *paths_[ i ];
+      wake = min( wake, path.timeout() );
+      if ( path.window_is_open() and (waiting_for_ == paths_.size() or waiting_for_ == i) ) {
+	wake = min( wake, path.next_send );
+      }
+    }
+
+    /* anything allocating on the way here shows up in grumpstat */
+    const uint64_t allocations = AllocCounter::allocations();
+    heap_allocations_.add( allocations - allocations_counted_ );
+    allocations_counted_ = allocations;
+
+    const auto ret = poller.poll( chrono::duration_cast<chrono::microseconds>(
+      max( wake - now, chrono::steady_clock::duration::zero() ) ) );
     if ( ret.result == PollResult::Exit ) {
       return ret.exit_status;
-    } else if ( ret.result == PollResult::Timeout ) {
-      /* After a timeout, send one datagram to try to get things moving again */
-      handle_timeout();
+    }
+
+    /* After a timeout (or probe timeout), send one datagram on that
+       path to try to get things moving again */
+    const auto after = chrono::steady_clock::now();
+    for ( unsigned int i = 0; i < paths_.size(); i++ ) {
+      if ( paths_[ i ]->timeout() <= after ) {
+	handle_timeout( i );
+      }
     }
   }
 }
@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "shadowcontroller.hh"
+#include "aimdcontroller.hh"
+#include "copacontroller.hh"
+#include "lattecontroller.hh"
+#include "timestamp.hh"
+
+using namespace std;
+
+ShadowController::ShadowController( const bool debug )
+  : ShadowController( debug, Params() )
+{}
+
+ShadowController::ShadowController( const bool debug,
+    const Params & params )
+  : Controller ( debug ),
+    params_ ( params ),
+    rtt_window_ ( RttWindow(debug) ),
+    bw_window_ ( BwWindow(debug) )
+{
+  /* the first one starts in charge */
+  add( "latte", new LatteController( false ) );
+  add( "aimd", new AimdController( false, 10, 1, 2 ) );
+  add( "copa", new CopaController( false ) );
+}
+
+/* Set a parameter by name */
+bool ShadowController::Params::set( const string & name, const float value )
+{
+  if (name == "min_interval_ms") { min_interval_ms = value; }
+  else if (name == "score_gain") { score_gain = value; }
+  else if (name == "margin") { margin = value; }
+  else if (name == "hold_intervals") { hold_intervals = value; }
+  else if (name == "queue_thresh") { queue_thresh = value; }
+  else if (name == "bw_window_rtts") { bw_window_rtts = value; }
+  else if (name == "delta") { delta = value; }
+  else { return false; }
+  return true;
+}
+
+void ShadowController::add( const string & name, Controller * const controller )
+{
+  candidates_.push_back( { name, unique_ptr<Controller>( controller ), 0, 0, 0 } );
+}
+
+/* Score of a window on the modeled link (capacity in pkts/ms, RTT in ms) */
+double ShadowController::predicted_score( const double window, const double capacity,
+					  const double base_rtt ) const
+{
+  const double bdp = capacity * base_rtt;
+  const double throughput = max( min( window, bdp ), 1.0 ) / base_rtt;
+  const double delay = base_rtt + max( 0.0, window - bdp ) / capacity;
+  return log( throughput ) - params_.delta * log( delay );
+}
+
+/* Score every candidate on the interval just finished, and switch if
+   one has clearly led the active controller for long enough */
+void ShadowController::end_interval( const uint64_t now )
+{
+  const double duration = max<uint64_t>( now - interval_start_, 1 );
+  const double base_rtt = max<uint64_t>( rtt_window_.min_rtt(), 1 );
+  const double delivery_rate = interval_acks_ / duration;
+  const double mean_rtt = interval_rtt_sum_ / interval_acks_;
+
+  /* a standing queue means the link was busy: it delivered exactly its
+     capacity. Otherwise capacity is at least what was delivered. */
+  bw_window_.update_bw_window_size( params_.bw_window_rtts * base_rtt );
+  bw_window_.update_bw_samples( now, delivery_rate );
+  const bool saturated = mean_rtt > (1 + params_.queue_thresh) * base_rtt;
+  const double capacity = max( saturated ? delivery_rate : bw_window_.max_bw(), 1e-3 );
+
+  for ( auto & candidate : candidates_ ) {
+    const double score = predicted_score( candidate.window_sum / interval_acks_,
+					  capacity, base_rtt );
+    candidate.score = scored_once_ ? (1 - params_.score_gain) * candidate.score
+      + params_.score_gain * score : score;
+    candidate.window_sum = 0;
+  }
+  scored_once_ = true;
+
+  size_t best = active_;
+  for ( size_t i = 0; i < candidates_.size(); i++ ) {
+    Candidate & candidate = candidates_[ i ];
+    if ( i == active_ ) {
+      continue;
+    }
+    candidate.leads = candidate.score > candidates_[ active_ ].score + params_.margin
+      ? candidate.leads + 1 : 0;
+    if ( candidate.leads >= params_.hold_intervals
+	 and candidate.score > candidates_[ best ].score ) {
+      best = i;
+    }
+  }
+
+  if ( best != active_ ) {
+    if ( debug_ ) {
+      cerr << "At time " << now << " switching from " << candidates_[ active_ ].name
+	   << " (score " << candidates_[ active_ ].score << ") to "
+	   << candidates_[ best ].name << " (score " << candidates_[ best ].score << ")" << endl;
+    }
+    active_ = best;
+    for ( auto & candidate : candidates_ ) {
+      candidate.leads = 0;
+    }
+  }
+
+  interval_start_ = now;
+  interval_acks_ = 0;
+  interval_rtt_sum_ = 0;
+}
+
+/* Get current window size, in datagrams */
+unsigned int ShadowController::window_size( void )
+{
+  unsigned int the_window_size = candidates_[ active_ ].controller->window_size();
+
+  if ( debug_ ) {
+    cerr << "At time " << timestamp_ms()
+	 << " window size is " << the_window_size
+	 << " (" << candidates_[ active_ ].name << ")" << endl;
+  }
+  return the_window_size;
+}
+
+/* A datagram was sent */
+void ShadowController::datagram_was_sent( const uint64_t sequence_number,
+				    /* of the sent datagram */
+				    const uint64_t send_timestamp )
+                                    /* in milliseconds */
+{
+  for ( auto & candidate : candidates_ ) {
+    candidate.controller->datagram_was_sent( sequence_number, send_timestamp );
+  }
+}
+
+/* An ack was received */
+void ShadowController::ack_received( const uint64_t sequence_number_acked,
+			       /* what sequence number was acknowledged */
+			       const uint64_t send_timestamp_acked,
+			       /* when the acknowledged datagram was sent (sender's clock) */
+			       const uint64_t recv_timestamp_acked,
+			       /* when the acknowledged datagram was received (receiver's clock)*/
+			       const uint64_t timestamp_ack_received )
+                               /* when the ack was received (by sender) */
+{
+  const uint64_t rtt_t = timestamp_ack_received - send_timestamp_acked;
+  srtt_ = srtt_ == 0 ? rtt_t : 0.875 * srtt_ + 0.125 * rtt_t;
+  rtt_window_.update_rtt_samples( timestamp_ack_received, rtt_t );
+
+  for ( auto & candidate : candidates_ ) {
+    candidate.controller->ack_received( sequence_number_acked, send_timestamp_acked,
+					recv_timestamp_acked, timestamp_ack_received );
+    candidate.window_sum += candidate.controller->window_size();
+  }
+
+  if ( interval_acks_ == 0 and interval_start_ == 0 ) {
+    interval_start_ = timestamp_ack_received;
+  }
+  interval_acks_++;
+  interval_rtt_sum_ += rtt_t;
+
+  if ( timestamp_ack_received - interval_start_ >= max<float>( params_.min_interval_ms, srtt_ ) ) {
+    end_interval( timestamp_ack_received );
+  }
+
+  if ( debug_ ) {
+    cerr << "At time " << timestamp_ack_received
+	 << " received ack for datagram " << sequence_number_acked
+	 << " (send @ time " << send_timestamp_acked
+	 << ", received @ time " << recv_timestamp_acked << " by receiver's clock)"
+	 << ", active " << candidates_[ active_ ].name;
+    for ( const auto & candidate : candidates_ ) {
+      cerr << ", " << candidate.name << " score " << candidate.score;
+    }
+    cerr << endl;
+  }
+}
+
+/* Losses and reordering reach every candidate, as acks do */
+void ShadowController::datagram_lost( const uint64_t sequence_number,
+				      const uint64_t send_timestamp,
+				      const uint64_t timestamp )
+{
+  for ( auto & candidate : candidates_ ) {
+    candidate.controller->datagram_lost( sequence_number, send_timestamp, timestamp );
+  }
+}
+
+void ShadowController::reordering_detected( const uint64_t sequence_number,
+					    const uint64_t timestamp )
+{
+  for ( auto & candidate : candidates_ ) {
+    candidate.controller->reordering_detected( sequence_number, timestamp );
+  }
+}
+
+/* Timeout occured */
+void ShadowController::timed_out( void )
+{
+  for ( auto & candidate : candidates_ ) {
+    candidate.controller->timed_out();
+  }
+
+  if ( debug_ ) {
+    cerr << "Timed out. active: " << candidates_[ active_ ].name << endl;
+  }
+}
+
+/* Pace as the active controller does */
+float ShadowController::get_interpkt_delay( void )
+{
+  return candidates_[ active_ ].controller->get_interpkt_delay();
+}
+
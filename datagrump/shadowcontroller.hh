@@ -0,0 +1,108 @@
+#ifndef SHADOWCONTROLLER_HH
+#define SHADOWCONTROLLER_HH
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "controller.hh"
+#include "metacontroller.hh"
+
+/* Runs several controllers side by side and lets the best one drive.
+   Every sub-controller sees every send, ack and timeout ("shadow
+   mode"), but only the active one's window and pacing are used. Once
+   per interval (about one RTT) each sub-controller's mean window is
+   scored against a link model built from what was observed in the
+   interval: the delivery rate (taken as the capacity when the queue
+   was standing, a lower bound otherwise) and the min RTT. A window w
+   on a link of capacity C and base RTT R predicts
+     throughput min(w, C R) / R,   delay R + max(0, w - C R) / C
+   and scores ln(throughput) - delta * ln(delay). Control passes to the
+   best-scoring controller only after it has led the active one by
+   `margin` for `hold_intervals` intervals in a row. */
+class ShadowController : public Controller
+{
+public:
+  /* Tunable parameters */
+  struct Params {
+    float min_interval_ms {10};  /* scoring intervals are max(this, srtt) long */
+    float score_gain {0.25};     /* EWMA weight of a new interval's score */
+    float margin {0.1};          /* lead (in score) needed to take over */
+    float hold_intervals {3};    /* ... for this many intervals in a row */
+    float queue_thresh {0.1};    /* link is saturated above (1 + this) * min RTT */
+    float bw_window_rtts {10};   /* capacity estimate window, in min RTTs */
+    float delta {1};             /* weight of delay against throughput */
+
+    /* Set a parameter by name; false if there is no such parameter */
+    bool set( const std::string & name, const float value );
+  };
+
+protected:
+  /* one sub-controller and its record */
+  struct Candidate {
+    std::string name;
+    std::unique_ptr<Controller> controller;
+    double window_sum;   /* over the current interval's acks */
+    double score;        /* smoothed */
+    unsigned int leads;  /* consecutive intervals ahead of the active one */
+  };
+
+  Params params_ {};
+  std::vector<Candidate> candidates_ {};
+  size_t active_ {0};
+
+  RttWindow rtt_window_;
+  BwWindow bw_window_;
+  float srtt_ {0};
+
+  /* current scoring interval */
+  uint64_t interval_start_ {0};
+  uint64_t interval_acks_ {0};
+  double interval_rtt_sum_ {0};
+  bool scored_once_ {false};
+
+  void add( const std::string & name, Controller * const controller );
+  double predicted_score( const double window, const double capacity,
+			  const double base_rtt ) const;
+  void end_interval( const uint64_t now );
+
+public:
+  ShadowController( const bool debug );
+
+  ShadowController( const bool debug,
+      const Params & params );
+
+  /* Timeout occured*/
+  void timed_out( void );
+
+  /* Wait between packets */
+  float get_interpkt_delay( void );
+
+  /* Get current window size, in datagrams */
+  unsigned int window_size( void );
+
+  /* A datagram was sent */
+  void datagram_was_sent( const uint64_t sequence_number,
+			  const uint64_t send_timestamp );
+
+  /* An ack was received */
+  void ack_received( const uint64_t sequence_number_acked,
+		     const uint64_t send_timestamp_acked,
+		     const uint64_t recv_timestamp_acked,
+		     const uint64_t timestamp_ack_received );
+
+  /* A datagram was declared lost */
+  void datagram_lost( const uint64_t sequence_number,
+		      const uint64_t send_timestamp,
+		      const uint64_t timestamp );
+
+  /* An ack arrived for a datagram declared lost */
+  void reordering_detected( const uint64_t sequence_number,
+			    const uint64_t timestamp );
+
+  /* Name of the controller in charge */
+  const std::string & active( void ) const { return candidates_[ active_ ].name; }
+};
+
+#endif
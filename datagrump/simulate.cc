@@ -0,0 +1,135 @@
+/* run a congestion controller against a mahimahi trace in simulated time */
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include <getopt.h>
+
+#include "controller_factory.hh"
+#include "link_simulator.hh"
+
+using namespace std;
+
+static void usage( const char * const argv0 )
+{
+  cerr << "Usage: " << argv0 << " [options] UPLINK_TRACE" << endl
+       << "  -c, --controller=NAME    controller to run (default latte;" << endl
+       << "                           remy:TABLE runs a remytrain rule table)" << endl
+       << "  -p, --param=NAME=VALUE   set a controller parameter (repeatable)" << endl
+       << "  -d, --delay=MS           one-way propagation delay (default 20)" << endl
+       << "  -D, --downlink=TRACE     trace for the ack direction (default unconstrained)" << endl
+       << "  -q, --queue=TYPE         droptail or codel (default droptail)" << endl
+       << "  -l, --queue-limit=PKTS   bottleneck queue limit (default unlimited)" << endl
+       << "  -t, --duration=MS        simulated time (default one pass of the trace)" << endl
+       << "  -o, --clock-offset=MS    receiver's clock ahead of the sender's by this" << endl
+       << "  -r, --clock-drift=PPM    receiver's clock runs fast by this" << endl
+       << "  -a, --ack-aggregation=MS deliver acks to the sender in bursts every MS" << endl
+       << "      --debug              enable controller debugging output" << endl;
+}
+
+int main( int argc, char *argv[] )
+{
+  /* check the command-line arguments */
+  if ( argc < 1 ) { /* for sticklers */
+    abort();
+  }
+
+  const option options[] = {
+    { "controller",  required_argument, nullptr, 'c' },
+    { "param",       required_argument, nullptr, 'p' },
+    { "delay",       required_argument, nullptr, 'd' },
+    { "downlink",    required_argument, nullptr, 'D' },
+    { "queue",       required_argument, nullptr, 'q' },
+    { "queue-limit", required_argument, nullptr, 'l' },
+    { "duration",    required_argument, nullptr, 't' },
+    { "clock-offset", required_argument, nullptr, 'o' },
+    { "clock-drift", required_argument, nullptr, 'r' },
+    { "ack-aggregation", required_argument, nullptr, 'a' },
+    { "debug",       no_argument,       nullptr, 'g' },
+    { nullptr,       0,                 nullptr, 0 }
+  };
+
+  string controller_name = "latte";
+  bool debug = false;
+  ControllerSettings settings;
+
+  try {
+    SimulationConfig config;
+
+    int opt;
+    while ( (opt = getopt_long( argc, argv, "c:p:d:D:q:l:t:o:r:a:", options, nullptr )) != -1 ) {
+      switch ( opt ) {
+      case 'c': controller_name = optarg; break;
+      case 'p':
+	{
+	  const string setting = optarg;
+	  const size_t equals = setting.find( '=' );
+	  if ( equals == string::npos or equals == 0 ) {
+	    usage( argv[ 0 ] );
+	    return EXIT_FAILURE;
+	  }
+	  settings.emplace_back( setting.substr( 0, equals ), stof( setting.substr( equals + 1 ) ) );
+	}
+	break;
+      case 'd': config.one_way_delay_ms = strtoull( optarg, nullptr, 10 ); break;
+      case 'D': config.downlink = make_shared<LinkTrace>( optarg ); break;
+      case 'q': config.queue_type = SimulationConfig::queue_type_from_name( optarg ); break;
+      case 'l': config.queue_limit_packets = strtoull( optarg, nullptr, 10 ); break;
+      case 't': config.duration_ms = strtoull( optarg, nullptr, 10 ); break;
+      case 'o': config.receiver_clock_offset_ms = strtoll( optarg, nullptr, 10 ); break;
+      case 'r': config.receiver_clock_drift_ppm = strtod( optarg, nullptr ); break;
+      case 'a': config.ack_aggregation_ms = strtoull( optarg, nullptr, 10 ); break;
+      case 'g': debug = true; break;
+      default:
+	usage( argv[ 0 ] );
+	return EXIT_FAILURE;
+      }
+    }
+
+    if ( optind != argc - 1 ) {
+      usage( argv[ 0 ] );
+      return EXIT_FAILURE;
+    }
+
+    config.uplink = make_shared<LinkTrace>( argv[ optind ] );
+
+    auto controller = make_controller( controller_name, debug, settings );
+    LinkSimulator simulator( config, *controller );
+
+    const auto start = chrono::steady_clock::now();
+    const SimulationResult result = simulator.run();
+    const double wall_ms = chrono::duration<double, milli>( chrono::steady_clock::now() - start ).count();
+
+    cout << fixed << setprecision( 2 )
+	 << "Controller: " << controller_name << endl
+	 << "Simulated " << result.duration_ms / 1000.0 << " s in " << wall_ms << " ms" << endl
+	 << "Datagrams sent: " << result.datagrams_sent
+	 << ", delivered: " << result.datagrams_delivered
+	 << ", dropped: " << result.datagrams_dropped
+	 << " (detected lost: " << result.losses_detected
+	 << ", reordered: " << result.reorderings << ")" << endl
+	 << "Timeouts: " << result.timeouts << " (tail-loss probes: " << result.probes << ")" << endl
+	 << "Average capacity: " << result.capacity_mbps << " Mbits/s" << endl
+	 << "Average throughput: " << result.throughput_mbps << " Mbits/s ("
+	 << 100 * result.utilization() << "% utilization)" << endl
+	 << "95th percentile per-packet queueing delay: " << result.p95_queueing_delay_ms << " ms" << endl
+	 << "95th percentile signal delay: " << result.p95_delay_ms << " ms"
+	 << " (mean " << result.mean_delay_ms << " ms)" << endl
+	 << "Window: mean " << result.mean_window << ", stddev " << result.window_stddev
+	 << ", mean change per ack " << result.window_jitter << " datagrams" << endl
+	 << "Time to full rate: ";
+    if ( result.time_to_full_rate_ms >= 0 ) {
+      cout << result.time_to_full_rate_ms << " ms" << endl;
+    } else {
+      cout << "never" << endl;
+    }
+    cout << "Power: " << result.power() << endl;
+  } catch ( const exception & e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
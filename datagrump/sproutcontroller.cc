@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "sproutcontroller.hh"
+#include "timestamp.hh"
+
+using namespace std;
+
+/* At most this many ticks are replayed after a silence */
+static const uint64_t MAX_TICK_GAP = 500;
+
+/* Forecasts look no further ahead than this */
+static const double MAX_HORIZON_MS = 600;
+
+SproutController::SproutController( const bool debug )
+  : SproutController( debug, Params() )
+{}
+
+SproutController::SproutController( const bool debug,
+    const Params & params )
+  : Controller ( debug ),
+    params_ ( params ),
+    rate_pmf_ ( RATE_BINS, 1.0 / RATE_BINS ),
+    scratch_ ( RATE_BINS ),
+    forecast_pmf_ ( RATE_BINS )
+{
+  params_.tick_ms = max( 1.0f, roundf( params_.tick_ms ) );
+
+  /* Gaussian step of sigma * sqrt(tick), in bins, out to 3 sigma */
+  const double bin_width = params_.max_rate / RATE_BINS;
+  const double stddev = max( 1e-3, params_.sigma * sqrt( params_.tick_ms / 1000.0 ) / bin_width );
+  const int half_width = ceil( 3 * stddev );
+  double sum = 0;
+  for ( int i = -half_width; i <= half_width; i++ ) {
+    kernel_.push_back( exp( -0.5 * (i / stddev) * (i / stddev) ) );
+    sum += kernel_.back();
+  }
+  for ( auto & weight : kernel_ ) {
+    weight /= sum;
+  }
+}
+
+/* Set a parameter by name */
+bool SproutController::Params::set( const string & name, const float value )
+{
+  if (name == "tick_ms") { tick_ms = value; }
+  else if (name == "max_rate") { max_rate = value; }
+  else if (name == "sigma") { sigma = value; }
+  else if (name == "delay_target_ms") { delay_target_ms = value; }
+  else if (name == "quantile") { quantile = value; }
+  else if (name == "min_cwnd") { min_cwnd = value; }
+  else { return false; }
+  return true;
+}
+
+/* Link rate at the middle of a bin, in pkts/s */
+double SproutController::bin_rate( const unsigned int bin ) const
+{
+  return (bin + 0.5) * params_.max_rate / RATE_BINS;
+}
+
+/* Let the rate wander for one tick (mass past either end stays there) */
+void SproutController::evolve( vector<double> & pmf )
+{
+  const int half_width = kernel_.size() / 2;
+  fill( scratch_.begin(), scratch_.end(), 0 );
+
+  for ( int from = 0; from < int( RATE_BINS ); from++ ) {
+    if ( pmf[ from ] < 1e-12 ) {
+      continue;
+    }
+    for ( int k = 0; k < int( kernel_.size() ); k++ ) {
+      const int to = min( max( from + k - half_width, 0 ), int( RATE_BINS ) - 1 );
+      scratch_[ to ] += pmf[ from ] * kernel_[ k ];
+    }
+  }
+
+  pmf.swap( scratch_ );
+}
+
+/* Bayes update with one tick's deliveries. If the link was not kept
+   busy for the whole tick, the count only says the rate was at least
+   that high. */
+void SproutController::observe( const unsigned int deliveries, const bool backlogged )
+{
+  const double tick_s = params_.tick_ms / 1000.0;
+  double total = 0;
+
+  for ( unsigned int bin = 0; bin < RATE_BINS; bin++ ) {
+    const double mean = bin_rate( bin ) * tick_s;
+    double likelihood;
+    if ( backlogged ) {
+      likelihood = exp( deliveries * log( mean ) - mean - lgamma( deliveries + 1.0 ) );
+    } else {
+      /* P(X >= deliveries) */
+      double term = exp( -mean ), below = 0;
+      for ( unsigned int i = 0; i < deliveries; i++ ) {
+	below += term;
+	term *= mean / (i + 1);
+      }
+      likelihood = max( 0.0, 1 - below );
+    }
+    scratch_[ bin ] = rate_pmf_[ bin ] * likelihood;
+    total += scratch_[ bin ];
+  }
+
+  if ( not (total > 1e-300) ) {
+    return; /* observation the model cannot explain; keep the prior */
+  }
+
+  for ( unsigned int bin = 0; bin < RATE_BINS; bin++ ) {
+    rate_pmf_[ bin ] = scratch_[ bin ] / total;
+  }
+}
+
+/* Finish every tick before `tick`. The datagram that opened `tick`
+   entered the bottleneck queue at `enqueue_time`; if that was before
+   a tick started, the link had a backlog throughout that tick. */
+void SproutController::close_ticks( const uint64_t tick, const uint64_t enqueue_time )
+{
+  if ( tick - current_tick_ > MAX_TICK_GAP ) {
+    current_tick_ = tick - MAX_TICK_GAP;
+    tick_deliveries_ = 0;
+  }
+
+  const uint64_t tick_ms = params_.tick_ms;
+  while ( current_tick_ < tick ) {
+    evolve( rate_pmf_ );
+    observe( tick_deliveries_, enqueue_time <= current_tick_ * tick_ms );
+    tick_deliveries_ = 0;
+    current_tick_++;
+  }
+}
+
+/* Deliveries over the next min RTT + delay target that the link will
+   reach with probability 1 - quantile */
+unsigned int SproutController::forecast( void )
+{
+  const double horizon_ms = min( MAX_HORIZON_MS, min_rtt_ + (double)params_.delay_target_ms );
+  const double horizon_s = horizon_ms / 1000.0;
+
+  /* rate uncertainty halfway through the horizon */
+  const unsigned int steps = horizon_ms / params_.tick_ms / 2;
+  copy( rate_pmf_.begin(), rate_pmf_.end(), forecast_pmf_.begin() );
+  for ( unsigned int i = 0; i < steps; i++ ) {
+    evolve( forecast_pmf_ );
+  }
+
+  /* smallest n with P(N <= n) >= quantile, N ~ mixture of Poissons;
+     term[ bin ] is P(bin) * P(N = n | bin) */
+  vector<double> & term = forecast_pmf_;
+  double cdf = 0;
+  for ( unsigned int bin = 0; bin < RATE_BINS; bin++ ) {
+    term[ bin ] *= exp( -bin_rate( bin ) * horizon_s );
+  }
+
+  const unsigned int limit = params_.max_rate * horizon_s * 2 + 10;
+  for ( unsigned int n = 0; n < limit; n++ ) {
+    for ( unsigned int bin = 0; bin < RATE_BINS; bin++ ) {
+      cdf += term[ bin ];
+      term[ bin ] *= bin_rate( bin ) * horizon_s / (n + 1);
+    }
+    if ( cdf >= params_.quantile ) {
+      return n;
+    }
+  }
+  return limit;
+}
+
+/* Get current window size, in datagrams */
+unsigned int SproutController::window_size( void )
+{
+  unsigned int the_window_size = static_cast<unsigned int>(cwnd_);
+
+  if ( debug_ ) {
+    cerr << "At time " << timestamp_ms()
+	 << " window size is " << the_window_size << endl;
+  }
+  return the_window_size;
+}
+
+/* An ack was received */
+void SproutController::ack_received( const uint64_t sequence_number_acked,
+			       /* what sequence number was acknowledged */
+			       const uint64_t send_timestamp_acked,
+			       /* when the acknowledged datagram was sent (sender's clock) */
+			       const uint64_t recv_timestamp_acked,
+			       /* when the acknowledged datagram was received (receiver's clock)*/
+			       const uint64_t timestamp_ack_received )
+                               /* when the ack was received (by sender) */
+{
+  const uint64_t rtt_t = timestamp_ack_received - send_timestamp_acked;
+  srtt_ = srtt_ == 0 ? rtt_t : 0.875 * srtt_ + 0.125 * rtt_t;
+  /* propagation delay: the window forecasts over it, so it must not
+     creep up while the link stays backlogged (as a windowed min would) */
+  min_rtt_ = min_rtt_ == 0 ? rtt_t : min( min_rtt_, rtt_t );
+
+  /* count deliveries per tick of the receiver's clock */
+  const uint64_t tick = recv_timestamp_acked / (uint64_t)params_.tick_ms;
+  if ( not started_ ) {
+    current_tick_ = tick;
+    started_ = true;
+  }
+
+  if ( tick > current_tick_ ) {
+    const uint64_t queueing_delay = rtt_t - min_rtt_;
+    const uint64_t enqueue_time = recv_timestamp_acked > queueing_delay
+      ? recv_timestamp_acked - queueing_delay : 0;
+    close_ticks( tick, enqueue_time );
+    cwnd_ = max( (float)forecast(), params_.min_cwnd );
+  }
+  tick_deliveries_++;
+
+  if ( debug_ ) {
+    cerr << "At time " << timestamp_ack_received
+	 << " received ack for datagram " << sequence_number_acked
+	 << " (send @ time " << send_timestamp_acked
+	 << ", received @ time " << recv_timestamp_acked << " by receiver's clock)"
+	 << ", min_rtt " << min_rtt_
+	 << ", cwnd " << cwnd_ << endl;
+  }
+}
+
+/* Timeout occured */
+void SproutController::timed_out( void )
+{
+  if ( debug_ ) {
+    cerr << "Timed out. cwnd: " << cwnd_ << endl;
+  }
+}
+
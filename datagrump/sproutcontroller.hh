@@ -0,0 +1,78 @@
+#ifndef SPROUTCONTROLLER_HH
+#define SPROUTCONTROLLER_HH
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "controller.hh"
+
+/* Stochastic link-forecast controller after Sprout (Winstein et al.,
+   NSDI 2013). The link delivers packets as a Poisson process whose
+   rate wanders (Brownian motion). A Bayesian filter over discretized
+   rates is evolved and updated once per tick from the number of
+   datagrams the receiver got in that tick. The window is the number
+   of datagrams the link will drain within min RTT + delay target with
+   the chosen confidence (a low quantile of the forecast). */
+class SproutController : public Controller
+{
+public:
+  /* Tunable parameters */
+  struct Params {
+    float tick_ms {20};          /* observation and evolution interval */
+    float max_rate {1000};       /* highest rate modeled, in pkts/s */
+    float sigma {200};           /* rate volatility, in pkts/s per sqrt(s) */
+    float delay_target_ms {50};  /* queueing delay the window aims for */
+    float quantile {0.05};       /* forecast confidence: 5% chance of falling short */
+    float min_cwnd {1};
+
+    /* Set a parameter by name; false if there is no such parameter */
+    bool set( const std::string & name, const float value );
+  };
+
+  static const unsigned int RATE_BINS = 256;
+
+protected:
+  Params params_ {};
+
+  /* posterior over link rate: probability of each bin */
+  std::vector<double> rate_pmf_;
+  std::vector<double> scratch_;
+  std::vector<double> forecast_pmf_;
+  std::vector<double> kernel_ {}; /* one tick of Brownian motion */
+
+  /* ticks on the receiver's clock */
+  uint64_t current_tick_ {0};
+  unsigned int tick_deliveries_ {0};
+  bool started_ {false};
+
+  float cwnd_ {10}; /* Congestion window */
+  uint64_t min_rtt_ {0}; /* lowest RTT ever seen */
+  float srtt_ {0};
+
+  double bin_rate( const unsigned int bin ) const; /* pkts/s */
+  void evolve( std::vector<double> & pmf );
+  void observe( const unsigned int deliveries, const bool backlogged );
+  void close_ticks( const uint64_t tick, const uint64_t enqueue_time );
+  unsigned int forecast( void );
+
+public:
+  SproutController( const bool debug );
+
+  SproutController( const bool debug,
+      const Params & params );
+
+  /* Timeout occured*/
+  void timed_out( void );
+
+  /* Get current window size, in datagrams */
+  unsigned int window_size( void );
+
+  /* An ack was received */
+  void ack_received( const uint64_t sequence_number_acked,
+		     const uint64_t send_timestamp_acked,
+		     const uint64_t recv_timestamp_acked,
+		     const uint64_t timestamp_ack_received );
+};
+
+#endif
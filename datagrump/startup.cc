@@ -0,0 +1,60 @@
+#include <algorithm>
+
+#include "startup.hh"
+
+using namespace std;
+
+Startup::Startup( const float gain, const unsigned int plateau_rounds )
+  : gain_( gain ),
+    plateau_rounds_( plateau_rounds )
+{}
+
+void Startup::end( const string & reason )
+{
+  if ( active_ ) {
+    active_ = false;
+    exit_reason_ = reason;
+  }
+}
+
+float Startup::interpkt_delay( const float max_bw, const float cwnd, const float min_rtt_ms ) const
+{
+  const float rate = max( max_bw, min_rtt_ms > 0 ? cwnd / min_rtt_ms : 0 );
+  return 1000 / (gain_ * rate);
+}
+
+bool Startup::ack_received( const uint64_t sequence_number_acked, const float max_bw,
+			    const float delay_ms, const float min_rtt_ms )
+{
+  if ( not active_ ) {
+    return false;
+  }
+
+  /* delay increase */
+  delays_[ delay_samples_++ % DELAY_SAMPLES ] = delay_ms;
+  if ( delay_samples_ >= DELAY_SAMPLES ) {
+    const float eta = min( max( min_rtt_ms / 8, 4.0f ), 16.0f );
+    if ( *min_element( delays_, delays_ + DELAY_SAMPLES ) > min_rtt_ms + eta ) {
+      end( "delay increase" );
+      return false;
+    }
+  }
+
+  if ( sequence_number_acked < round_end_ ) {
+    return true;
+  }
+
+  /* a round trip is over: did it find more bandwidth? */
+  rounds_++;
+  round_end_ = next_sequence_;
+
+  if ( max_bw >= 1.25 * full_bw_ ) {
+    full_bw_ = max_bw;
+    flat_rounds_ = 0;
+  } else if ( ++flat_rounds_ >= plateau_rounds_ ) {
+    end( "bandwidth plateau" );
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,69 @@
+#ifndef STARTUP_HH
+#define STARTUP_HH
+
+#include <cstdint>
+#include <string>
+
+/* Exponential startup for the model-based controllers. While active,
+   the controller opens its window to gain * BDP and paces at gain *
+   the max delivery rate, or at the window per min RTT if that is
+   faster (so a cold bandwidth estimate cannot hold the window back).
+   Each round trip (until the first datagram sent after the round
+   began is acked) can then deliver up to gain times more than the
+   last. Startup ends, HyStart-style, on whichever comes first:
+   - delay increase: the lowest delay among the last DELAY_SAMPLES acks
+     exceeds the min RTT by clamp(min_rtt / 8, 4, 16) ms (a standing
+     queue, not one ack's jitter);
+   - bandwidth plateau: max bandwidth has not grown 25% in
+     plateau_rounds rounds;
+   - end() by the controller (timeout, warm start). */
+class Startup
+{
+private:
+  float gain_;
+  unsigned int plateau_rounds_;
+
+  bool active_ {true};
+  std::string exit_reason_ {};
+
+  /* round trips, counted by sequence number */
+  uint64_t next_sequence_ {0};
+  uint64_t round_end_ {0};
+  unsigned int rounds_ {0};
+
+  /* bandwidth plateau */
+  float full_bw_ {0};
+  unsigned int flat_rounds_ {0};
+
+  /* delay increase: the latest samples, oldest overwritten first */
+  static const unsigned int DELAY_SAMPLES = 8;
+  float delays_[ DELAY_SAMPLES ] {};
+  unsigned int delay_samples_ {0};
+
+public:
+  Startup( const float gain = 2, const unsigned int plateau_rounds = 3 );
+
+  /* A datagram was sent */
+  void datagram_was_sent( const uint64_t sequence_number )
+  {
+    next_sequence_ = sequence_number + 1;
+  }
+
+  /* An ack: max_bw in pkts/ms, and this ack's delay and the min RTT in
+     ms. Returns whether startup is still active. */
+  bool ack_received( const uint64_t sequence_number_acked, const float max_bw,
+		     const float delay_ms, const float min_rtt_ms );
+
+  /* Pacing gap while active (us) */
+  float interpkt_delay( const float max_bw, const float cwnd, const float min_rtt_ms ) const;
+
+  /* Leave startup for good */
+  void end( const std::string & reason );
+
+  bool active( void ) const { return active_; }
+  float gain( void ) const { return gain_; }
+  unsigned int rounds( void ) const { return rounds_; }
+  const std::string & exit_reason( void ) const { return exit_reason_; }
+};
+
+#endif /* STARTUP_HH */
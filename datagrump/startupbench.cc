@@ -0,0 +1,127 @@
+/* startup benchmark: how long fresh flows of each controller take to
+   fill a link, and how much queue they build on the way, in simulated time */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+#include "controller_factory.hh"
+#include "link_simulator.hh"
+
+using namespace std;
+
+static void usage( const char * const argv0 )
+{
+  cerr << "Usage: " << argv0 << " [options] TRACE..." << endl
+       << "  -c, --controller=NAME    controller to run (repeatable; default all)" << endl
+       << "  -p, --param=NAME=VALUE   set a controller parameter (repeatable)" << endl
+       << "  -d, --delays=MS,...      one-way propagation delays (default 10,20,50)" << endl
+       << "  -t, --duration=MS        simulated time per run (default 3000)" << endl;
+}
+
+int main( int argc, char *argv[] )
+{
+  /* check the command-line arguments */
+  if ( argc < 1 ) { /* for sticklers */
+    abort();
+  }
+
+  const option options[] = {
+    { "controller", required_argument, nullptr, 'c' },
+    { "param",      required_argument, nullptr, 'p' },
+    { "delays",     required_argument, nullptr, 'd' },
+    { "duration",   required_argument, nullptr, 't' },
+    { nullptr,      0,                 nullptr, 0 }
+  };
+
+  vector<string> controllers;
+  vector<uint64_t> delays { 10, 20, 50 };
+  uint64_t duration_ms = 3000;
+  ControllerSettings settings;
+
+  try {
+    int opt;
+    while ( (opt = getopt_long( argc, argv, "c:p:d:t:", options, nullptr )) != -1 ) {
+      switch ( opt ) {
+      case 'c': controllers.push_back( optarg ); break;
+      case 'p':
+	{
+	  const string setting = optarg;
+	  const size_t equals = setting.find( '=' );
+	  if ( equals == string::npos or equals == 0 ) {
+	    usage( argv[ 0 ] );
+	    return EXIT_FAILURE;
+	  }
+	  settings.emplace_back( setting.substr( 0, equals ), stof( setting.substr( equals + 1 ) ) );
+	}
+	break;
+      case 'd':
+	{
+	  delays.clear();
+	  istringstream list( optarg );
+	  string delay;
+	  while ( getline( list, delay, ',' ) ) {
+	    delays.push_back( stoull( delay ) );
+	  }
+	}
+	break;
+      case 't': duration_ms = strtoull( optarg, nullptr, 10 ); break;
+      default:
+	usage( argv[ 0 ] );
+	return EXIT_FAILURE;
+      }
+    }
+
+    if ( optind >= argc or delays.empty() ) {
+      usage( argv[ 0 ] );
+      return EXIT_FAILURE;
+    }
+
+    if ( controllers.empty() ) {
+      controllers = controller_names();
+    }
+
+    cout << left << setw( 12 ) << "controller" << setw( 16 ) << "trace" << right
+	 << setw( 8 ) << "delay" << setw( 12 ) << "full rate" << setw( 8 ) << "RTTs"
+	 << setw( 12 ) << "p95 queue" << setw( 10 ) << "Mbps" << endl;
+
+    for ( int i = optind; i < argc; i++ ) {
+      const string filename = argv[ i ];
+      const auto trace = make_shared<LinkTrace>( filename );
+
+      for ( const auto delay : delays ) {
+	SimulationConfig config;
+	config.uplink = trace;
+	config.one_way_delay_ms = delay;
+	config.duration_ms = duration_ms;
+
+	for ( const auto & name : controllers ) {
+	  auto controller = make_controller( name, false, settings );
+	  const SimulationResult result = LinkSimulator( config, *controller ).run();
+
+	  cout << left << setw( 12 ) << name
+	       << setw( 16 ) << filename.substr( filename.find_last_of( '/' ) + 1 ) << right
+	       << setw( 8 ) << delay << fixed << setprecision( 0 );
+	  if ( result.time_to_full_rate_ms >= 0 ) {
+	    cout << setw( 12 ) << result.time_to_full_rate_ms
+		 << setprecision( 1 ) << setw( 8 ) << result.time_to_full_rate_ms / (2 * delay);
+	  } else {
+	    cout << setw( 12 ) << "never" << setw( 8 ) << "-";
+	  }
+	  cout << setprecision( 1 ) << setw( 12 ) << result.p95_queueing_delay_ms
+	       << setprecision( 2 ) << setw( 10 ) << result.throughput_mbps << endl;
+	}
+      }
+    }
+  } catch ( const exception & e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
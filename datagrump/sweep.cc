@@ -0,0 +1,275 @@
+/* tune a controller: run a grid or random sample of parameter settings
+   against link traces in simulated time, on every core, and rank them */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#include <getopt.h>
+
+#include "controller_factory.hh"
+#include "link_simulator.hh"
+
+using namespace std;
+
+/* values to try for one parameter */
+struct Dimension
+{
+  string name {};
+  vector<float> values {};      /* grid points (or the listed values) */
+  bool is_range {false};        /* lo:hi:step; random search samples [lo, hi] */
+  float low {0}, high {0};
+};
+
+/* NAME=LO:HI:STEP, NAME=V1,V2,... or NAME=V */
+static Dimension parse_dimension( const string & spec )
+{
+  Dimension dim;
+
+  const size_t equals = spec.find( '=' );
+  if ( equals == string::npos or equals == 0 ) {
+    throw runtime_error( "bad parameter spec: " + spec );
+  }
+  dim.name = spec.substr( 0, equals );
+  const string values = spec.substr( equals + 1 );
+
+  if ( values.find( ':' ) != string::npos ) {
+    float step;
+    char colon1, colon2;
+    istringstream range( values );
+    if ( not (range >> dim.low >> colon1 >> dim.high >> colon2 >> step)
+	 or colon1 != ':' or colon2 != ':' or step <= 0 or dim.high < dim.low ) {
+      throw runtime_error( "bad range (want LO:HI:STEP): " + spec );
+    }
+    dim.is_range = true;
+    const unsigned int steps = floor( (dim.high - dim.low) / step + 1e-4 );
+    for ( unsigned int i = 0; i <= steps; i++ ) {
+      dim.values.push_back( dim.low + i * step );
+    }
+  } else {
+    istringstream list( values );
+    string value;
+    while ( getline( list, value, ',' ) ) {
+      dim.values.push_back( stof( value ) );
+    }
+  }
+
+  if ( dim.values.empty() ) {
+    throw runtime_error( "no values for " + dim.name );
+  }
+
+  return dim;
+}
+
+/* one point in parameter space, and how it did */
+struct Trial
+{
+  vector<float> values {};
+  double throughput_mbps {0};
+  double p95_delay_ms {0};
+  double power {0};
+  double score {0}; /* mean over traces of ln(throughput / delay) */
+};
+
+static vector<Trial> grid( const vector<Dimension> & dims )
+{
+  vector<Trial> ret( 1 );
+  for ( const auto & dim : dims ) {
+    vector<Trial> expanded;
+    for ( const auto & trial : ret ) {
+      for ( const auto value : dim.values ) {
+	expanded.push_back( trial );
+	expanded.back().values.push_back( value );
+      }
+    }
+    ret = expanded;
+  }
+  return ret;
+}
+
+static vector<Trial> random_sample( const vector<Dimension> & dims,
+				    const unsigned int count, const unsigned int seed )
+{
+  mt19937 prng( seed );
+  vector<Trial> ret( count );
+  for ( auto & trial : ret ) {
+    for ( const auto & dim : dims ) {
+      if ( dim.is_range ) {
+	trial.values.push_back( uniform_real_distribution<float>( dim.low, dim.high )( prng ) );
+      } else {
+	trial.values.push_back( dim.values[ uniform_int_distribution<size_t>( 0, dim.values.size() - 1 )( prng ) ] );
+      }
+    }
+  }
+  return ret;
+}
+
+static ControllerSettings settings_for( const vector<Dimension> & dims, const Trial & trial )
+{
+  ControllerSettings ret;
+  for ( size_t i = 0; i < dims.size(); i++ ) {
+    ret.emplace_back( dims[ i ].name, trial.values[ i ] );
+  }
+  return ret;
+}
+
+static void usage( const char * const argv0 )
+{
+  cerr << "Usage: " << argv0 << " [options] -c CONTROLLER -p NAME=SPEC... TRACE..." << endl
+       << "  -p, --param=NAME=SPEC    values to try: LO:HI:STEP, V1,V2,... or V" << endl
+       << "  -r, --random=N           try N random points instead of the full grid" << endl
+       << "  -s, --seed=N             seed for --random (default 1)" << endl
+       << "  -j, --jobs=N             worker threads (default: all cores)" << endl
+       << "  -n, --top=N              print only the N best settings" << endl
+       << "  -d, --delay=MS           one-way propagation delay (default 20)" << endl
+       << "  -q, --queue=TYPE         droptail or codel (default droptail)" << endl
+       << "  -l, --queue-limit=PKTS   bottleneck queue limit (default unlimited)" << endl
+       << "  -t, --duration=MS        simulated time per trace (default one pass)" << endl;
+}
+
+int main( int argc, char *argv[] )
+{
+  /* check the command-line arguments */
+  if ( argc < 1 ) { /* for sticklers */
+    abort();
+  }
+
+  const option options[] = {
+    { "controller",  required_argument, nullptr, 'c' },
+    { "param",       required_argument, nullptr, 'p' },
+    { "random",      required_argument, nullptr, 'r' },
+    { "seed",        required_argument, nullptr, 's' },
+    { "jobs",        required_argument, nullptr, 'j' },
+    { "top",         required_argument, nullptr, 'n' },
+    { "delay",       required_argument, nullptr, 'd' },
+    { "queue",       required_argument, nullptr, 'q' },
+    { "queue-limit", required_argument, nullptr, 'l' },
+    { "duration",    required_argument, nullptr, 't' },
+    { nullptr,       0,                 nullptr, 0 }
+  };
+
+  try {
+    string controller_name;
+    vector<Dimension> dims;
+    unsigned int random_count = 0, seed = 1, top = 0;
+    unsigned int jobs = max( 1u, thread::hardware_concurrency() );
+    SimulationConfig config;
+
+    int opt;
+    while ( (opt = getopt_long( argc, argv, "c:p:r:s:j:n:d:q:l:t:", options, nullptr )) != -1 ) {
+      switch ( opt ) {
+      case 'c': controller_name = optarg; break;
+      case 'p': dims.push_back( parse_dimension( optarg ) ); break;
+      case 'r': random_count = strtoul( optarg, nullptr, 10 ); break;
+      case 's': seed = strtoul( optarg, nullptr, 10 ); break;
+      case 'j': jobs = max( 1ul, strtoul( optarg, nullptr, 10 ) ); break;
+      case 'n': top = strtoul( optarg, nullptr, 10 ); break;
+      case 'd': config.one_way_delay_ms = strtoull( optarg, nullptr, 10 ); break;
+      case 'q': config.queue_type = SimulationConfig::queue_type_from_name( optarg ); break;
+      case 'l': config.queue_limit_packets = strtoull( optarg, nullptr, 10 ); break;
+      case 't': config.duration_ms = strtoull( optarg, nullptr, 10 ); break;
+      default:
+	usage( argv[ 0 ] );
+	return EXIT_FAILURE;
+      }
+    }
+
+    if ( controller_name.empty() or optind == argc ) {
+      usage( argv[ 0 ] );
+      return EXIT_FAILURE;
+    }
+
+    vector<shared_ptr<const LinkTrace>> traces;
+    for ( int i = optind; i < argc; i++ ) {
+      traces.push_back( make_shared<LinkTrace>( argv[ i ] ) );
+    }
+
+    vector<Trial> trials = random_count ? random_sample( dims, random_count, seed ) : grid( dims );
+
+    /* fail early on a bad controller or parameter name */
+    make_controller( controller_name, false, settings_for( dims, trials.front() ) );
+
+    cerr << "Running " << trials.size() << " settings x " << traces.size()
+	 << " traces on " << jobs << " threads..." << endl;
+
+    atomic<size_t> next_trial { 0 };
+    exception_ptr failure;
+    mutex failure_mutex;
+    const auto start = chrono::steady_clock::now();
+
+    auto worker = [&] () {
+      try {
+	for ( size_t i = next_trial++; i < trials.size(); i = next_trial++ ) {
+	  Trial & trial = trials[ i ];
+	  for ( const auto & trace : traces ) {
+	    SimulationConfig trace_config = config;
+	    trace_config.uplink = trace;
+	    auto controller = make_controller( controller_name, false, settings_for( dims, trial ) );
+	    const SimulationResult result = LinkSimulator( trace_config, *controller ).run();
+
+	    trial.throughput_mbps += result.throughput_mbps / traces.size();
+	    trial.p95_delay_ms += result.p95_delay_ms / traces.size();
+	    trial.power += result.power() / traces.size();
+	    trial.score += log( max( result.power(), 1e-9 ) ) / traces.size();
+	  }
+	}
+      } catch ( ... ) {
+	lock_guard<mutex> lock( failure_mutex );
+	failure = current_exception();
+	next_trial = trials.size();
+      }
+    };
+
+    vector<thread> threads;
+    for ( unsigned int i = 0; i < jobs; i++ ) {
+      threads.emplace_back( worker );
+    }
+    for ( auto & t : threads ) {
+      t.join();
+    }
+
+    if ( failure ) {
+      rethrow_exception( failure );
+    }
+
+    cerr << "Done in " << fixed << setprecision( 1 )
+	 << chrono::duration<double>( chrono::steady_clock::now() - start ).count() << " s" << endl;
+
+    /* ranked table, best first */
+    sort( trials.begin(), trials.end(),
+	  [] ( const Trial & a, const Trial & b ) { return a.score > b.score; } );
+
+    cout << setw( 5 ) << "rank";
+    for ( const auto & dim : dims ) {
+      cout << setw( max( size_t( 10 ), dim.name.size() + 2 ) ) << dim.name;
+    }
+    cout << setw( 12 ) << "tput Mbps" << setw( 12 ) << "p95 ms"
+	 << setw( 10 ) << "power" << setw( 8 ) << "score" << endl;
+
+    for ( size_t rank = 0; rank < trials.size() and (not top or rank < top); rank++ ) {
+      const Trial & trial = trials[ rank ];
+      cout << setw( 5 ) << rank + 1 << setprecision( 3 );
+      for ( size_t i = 0; i < dims.size(); i++ ) {
+	cout << setw( max( size_t( 10 ), dims[ i ].name.size() + 2 ) ) << trial.values[ i ];
+      }
+      cout << fixed << setprecision( 2 ) << setw( 12 ) << trial.throughput_mbps
+	   << setprecision( 1 ) << setw( 12 ) << trial.p95_delay_ms
+	   << setw( 10 ) << trial.power
+	   << setprecision( 3 ) << setw( 8 ) << trial.score << defaultfloat << endl;
+    }
+  } catch ( const exception & e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,49 @@
+/* score a mahimahi uplink log offline, as mm-throughput-graph would */
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include "link_log.hh"
+
+using namespace std;
+
+int main( int argc, char *argv[] )
+{
+  /* check the command-line arguments */
+  if ( argc < 1 ) { /* for sticklers */
+    abort();
+  }
+
+  if ( argc > 2 ) {
+    cerr << "Usage: " << argv[ 0 ] << " [LOG] (default /tmp/contest_uplink_log)" << endl;
+    return EXIT_FAILURE;
+  }
+
+  const string filename = argc == 2 ? argv[ 1 ] : "/tmp/contest_uplink_log";
+
+  try {
+    const auto start = chrono::steady_clock::now();
+    const LinkLogSummary summary = analyze_link_log( filename );
+    const double wall_ms = chrono::duration<double, milli>( chrono::steady_clock::now() - start ).count();
+
+    cout << fixed << setprecision( 2 )
+	 << "Log: " << filename << " (" << summary.duration_ms / 1000.0 << " s, analyzed in "
+	 << wall_ms << " ms)" << endl
+	 << "Packets: " << summary.arrivals << " arrived, " << summary.departures
+	 << " delivered, " << summary.drops << " dropped" << endl
+	 << "Average capacity: " << summary.capacity_mbps << " Mbits/s" << endl
+	 << "Average throughput: " << summary.throughput_mbps << " Mbits/s ("
+	 << 100 * summary.utilization() << "% utilization)" << endl
+	 << "95th percentile per-packet queueing delay: " << summary.p95_queueing_delay_ms << " ms"
+	 << " (mean " << summary.mean_queueing_delay_ms << " ms)" << endl
+	 << "95th percentile signal delay: " << summary.p95_signal_delay_ms << " ms" << endl
+	 << "Power: " << summary.power() << " Mbits/s per second of delay" << endl;
+  } catch ( const exception & e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,314 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "vivacecontroller.hh"
+#include "timestamp.hh"
+
+using namespace std;
+
+/* Utility is computed in Mbps, as in the paper (1500-byte datagrams) */
+static const double MBPS_PER_PKT_PER_MS = 1500 * 8 / 1000.0;
+
+/* Dynamic change bound never lets one step move the rate by more than half */
+static const double MAX_BOUND = 0.5;
+
+/* Every monitor interval carries at least this many datagrams */
+static const double MIN_INTERVAL_DATAGRAMS = 10;
+
+static const char * purpose_name( const uint8_t purpose )
+{
+  static const char * const names[] = { "startup", "probe-up", "probe-down", "hold" };
+  return purpose < 4 ? names[ purpose ] : "?";
+}
+
+VivaceController::VivaceController( const bool debug )
+  : VivaceController( debug, Params() )
+{}
+
+VivaceController::VivaceController( const bool debug,
+    const Params & params )
+  : Controller ( debug ),
+    params_ ( params ),
+    rate_ ( params.initial_rate )
+{}
+
+/* Set a parameter by name */
+bool VivaceController::Params::set( const string & name, const float value )
+{
+  if (name == "exponent") { exponent = value; }
+  else if (name == "latency_coeff") { latency_coeff = value; }
+  else if (name == "loss_coeff") { loss_coeff = value; }
+  else if (name == "grad_tolerance") { grad_tolerance = value; }
+  else if (name == "epsilon") { epsilon = value; }
+  else if (name == "step") { step = value; }
+  else if (name == "bound") { bound = value; }
+  else if (name == "bound_step") { bound_step = value; }
+  else if (name == "initial_rate") { initial_rate = value; }
+  else if (name == "min_rate") { min_rate = value; }
+  else if (name == "inflight_cap") { inflight_cap = value; }
+  else { return false; }
+  return true;
+}
+
+/* The interval datagrams are being sent in, if any */
+VivaceController::MonitorInterval * VivaceController::current( void )
+{
+  if ( intervals_.empty() or intervals_.back_value().closed ) {
+    return nullptr;
+  }
+  return &intervals_.back_value();
+}
+
+/* Open a monitor interval, choosing its rate for the experiment at hand */
+void VivaceController::start_interval( const uint64_t sequence_number, const uint64_t now )
+{
+  MonitorInterval mi {};
+  mi.first_sequence_number = mi.last_sequence_number = sequence_number;
+  mi.start_time = now;
+
+  if ( state_ == State::Startup ) {
+    if ( startup_round_ > 0 ) {
+      rate_ *= 2;
+    }
+    mi.purpose = Purpose::Startup;
+    mi.experiment = startup_round_++;
+    mi.rate = rate_;
+  } else if ( probes_scheduled_ < 2 ) {
+    const bool up = probes_scheduled_++ == 0;
+    mi.purpose = up ? Purpose::ProbeUp : Purpose::ProbeDown;
+    mi.experiment = probe_pair_;
+    mi.rate = rate_ * (up ? 1 + params_.epsilon : 1 - params_.epsilon);
+  } else {
+    mi.purpose = Purpose::Hold;
+    mi.rate = rate_;
+  }
+
+  /* about one RTT long */
+  mi.end_time = now + max( srtt_ == 0 ? 100.0 : (double)srtt_,
+			   MIN_INTERVAL_DATAGRAMS / mi.rate );
+
+  intervals_.push_back( now, mi );
+}
+
+/* u(x) = x^t - b * x * max(0, RTT gradient) - c * x * loss */
+double VivaceController::utility( const MonitorInterval & mi ) const
+{
+  const double duration = max<uint64_t>( mi.end_time - mi.start_time, 1 );
+  const double x = mi.sent / duration * MBPS_PER_PKT_PER_MS;
+  const double loss = mi.sent > mi.acked ? 1 - double( mi.acked ) / mi.sent : 0;
+
+  double gradient = 0;
+  const double n = mi.acked;
+  const double denominator = n * mi.sum_xx - mi.sum_x * mi.sum_x;
+  if ( n >= 2 and denominator > 0 ) {
+    gradient = (n * mi.sum_xy - mi.sum_x * mi.sum_y) / denominator;
+  }
+  /* a draining queue (negative gradient) earns no bonus: after an
+     overshoot it would reward whatever rate happened to follow */
+  if ( gradient < params_.grad_tolerance ) {
+    gradient = 0;
+  }
+
+  return pow( x, params_.exponent )
+    - params_.latency_coeff * x * gradient
+    - params_.loss_coeff * x * loss;
+}
+
+/* All of an interval's acks are in (or given up on): learn from it */
+void VivaceController::interval_done( const MonitorInterval & mi )
+{
+  const double u = utility( mi );
+
+  if ( debug_ ) {
+    cerr << "Monitor interval " << purpose_name( uint8_t( mi.purpose ) )
+	 << " rate " << mi.rate << " pkts/ms, sent " << mi.sent
+	 << ", acked " << mi.acked << ", utility " << u << endl;
+  }
+
+  if ( mi.purpose == Purpose::Startup and state_ == State::Startup ) {
+    if ( best_rate_ == 0 or u >= best_utility_ ) {
+      best_utility_ = u;
+      best_rate_ = mi.rate;
+      return;
+    }
+    /* utility fell: settle on the best rate and start learning */
+    rate_ = best_rate_;
+    state_ = State::Probing;
+    probes_scheduled_ = 0;
+    probe_pair_++;
+    return;
+  }
+
+  if ( state_ != State::Probing or mi.experiment != probe_pair_ ) {
+    return;
+  }
+
+  if ( mi.purpose == Purpose::ProbeUp ) {
+    utility_up_ = u;
+    have_up_ = true;
+  } else if ( mi.purpose == Purpose::ProbeDown ) {
+    utility_down_ = u;
+    have_down_ = true;
+  }
+
+  if ( not (have_up_ and have_down_) ) {
+    return;
+  }
+
+  /* gradient ascent with confidence amplifier and dynamic bound */
+  const double x = rate_ * MBPS_PER_PKT_PER_MS;
+  const double gradient = (utility_up_ - utility_down_) / (2 * params_.epsilon * x);
+  const int direction = gradient > 0 ? 1 : -1;
+
+  if ( direction == direction_ ) {
+    confidence_++;
+  } else {
+    direction_ = direction;
+    confidence_ = 1;
+    bound_hits_ = 0;
+  }
+
+  double change = confidence_ * params_.step * gradient;
+  const double bound = min<double>( params_.bound + bound_hits_ * params_.bound_step,
+				    MAX_BOUND ) * x;
+  if ( fabs( change ) > bound ) {
+    change = direction * bound;
+    bound_hits_++;
+  } else {
+    bound_hits_ = 0;
+  }
+
+  rate_ = max<float>( params_.min_rate, rate_ + change / MBPS_PER_PKT_PER_MS );
+
+  probe_pair_++;
+  probes_scheduled_ = 0;
+  have_up_ = have_down_ = false;
+}
+
+/* Close the sending interval when its time is up, and score intervals
+   whose last datagram has been acked (or whose acks are overdue) */
+void VivaceController::check_intervals( const uint64_t now )
+{
+  MonitorInterval * const mi = current();
+  if ( mi and now >= mi->end_time ) {
+    mi->closed = true;
+    mi->end_time = now;
+  }
+
+  const uint64_t patience = srtt_ == 0 ? 1000 : 2 * srtt_;
+  while ( not intervals_.empty() and intervals_.front_value().closed ) {
+    const MonitorInterval & oldest = intervals_.front_value();
+    if ( largest_acked_ < oldest.last_sequence_number
+	 and now < oldest.end_time + patience ) {
+      break;
+    }
+    interval_done( oldest );
+    intervals_.pop_front();
+  }
+}
+
+/* Get current window size, in datagrams */
+unsigned int VivaceController::window_size( void )
+{
+  /* rate-based: the window only caps inflight at about a min RTT's worth,
+     so a rate that overshoots a collapsing link cannot queue without bound */
+  const float rate = current() ? current()->rate : rate_;
+  const float rtt = min_rtt_ == 0 ? 100 : min_rtt_;
+  unsigned int the_window_size = max( 4.0f, params_.inflight_cap * rate * rtt );
+
+  if ( debug_ ) {
+    cerr << "At time " << timestamp_ms()
+	 << " window size is " << the_window_size << endl;
+  }
+  return the_window_size;
+}
+
+/* A datagram was sent */
+void VivaceController::datagram_was_sent( const uint64_t sequence_number,
+				    /* of the sent datagram */
+				    const uint64_t send_timestamp )
+                                    /* in milliseconds */
+{
+  check_intervals( send_timestamp );
+
+  if ( not current() ) {
+    start_interval( sequence_number, send_timestamp );
+  }
+
+  MonitorInterval & mi = intervals_.back_value();
+  mi.last_sequence_number = sequence_number;
+  mi.sent++;
+}
+
+/* An ack was received */
+void VivaceController::ack_received( const uint64_t sequence_number_acked,
+			       /* what sequence number was acknowledged */
+			       const uint64_t send_timestamp_acked,
+			       /* when the acknowledged datagram was sent (sender's clock) */
+			       const uint64_t recv_timestamp_acked,
+			       /* when the acknowledged datagram was received (receiver's clock)*/
+			       const uint64_t timestamp_ack_received )
+                               /* when the ack was received (by sender) */
+{
+  const uint64_t rtt_t = timestamp_ack_received - send_timestamp_acked;
+  srtt_ = srtt_ == 0 ? rtt_t : 0.875 * srtt_ + 0.125 * rtt_t;
+  min_rtt_ = min_rtt_ == 0 ? rtt_t : min( min_rtt_, rtt_t );
+  largest_acked_ = max( largest_acked_, sequence_number_acked );
+
+  /* credit the interval the datagram was sent in */
+  for ( size_t i = 0; i < intervals_.size(); i++ ) {
+    MonitorInterval & mi = intervals_.value( i );
+    if ( sequence_number_acked >= mi.first_sequence_number
+	 and sequence_number_acked <= mi.last_sequence_number ) {
+      const double x = send_timestamp_acked - mi.start_time;
+      mi.acked++;
+      mi.sum_x += x;
+      mi.sum_y += rtt_t;
+      mi.sum_xx += x * x;
+      mi.sum_xy += x * rtt_t;
+      break;
+    }
+  }
+
+  check_intervals( timestamp_ack_received );
+
+  if ( debug_ ) {
+    cerr << "At time " << timestamp_ack_received
+	 << " received ack for datagram " << sequence_number_acked
+	 << " (send @ time " << send_timestamp_acked
+	 << ", received @ time " << recv_timestamp_acked << " by receiver's clock)"
+	 << ", rate " << rate_ << " pkts/ms"
+	 << ", srtt " << srtt_ << endl;
+  }
+}
+
+/* Timeout occured */
+void VivaceController::timed_out( void )
+{
+  /* back off and restart the experiments at the lower rate */
+  rate_ = max( params_.min_rate, rate_ / 2 );
+  state_ = State::Probing;
+  probe_pair_++;
+  probes_scheduled_ = 0;
+  have_up_ = have_down_ = false;
+  direction_ = 0;
+  confidence_ = 1;
+  bound_hits_ = 0;
+
+  if ( current() ) {
+    current()->closed = true;
+  }
+
+  if ( debug_ ) {
+    cerr << "Timed out. rate: " << rate_ << " pkts/ms" << endl;
+  }
+}
+
+/* Pace at the current interval's rate */
+float VivaceController::get_interpkt_delay( void )
+{
+  const float rate = current() ? current()->rate : rate_;
+  return 1000 / rate;
+}
+
@@ -0,0 +1,118 @@
+#ifndef VIVACECONTROLLER_HH
+#define VIVACECONTROLLER_HH
+
+#include <cstdint>
+#include <string>
+
+#include "controller.hh"
+#include "ring_buffer.hh"
+
+/* Rate-based online-learning controller after PCC Vivace (Dong et al.,
+   NSDI 2018). The sender paces at a rate that is held fixed for each
+   monitor interval (about one RTT). Once an interval's acks are in, it
+   is scored with the utility
+     u(x) = x^t - b * x * max(0, d(RTT)/dT) - c * x * loss     (x in Mbps)
+   Startup doubles the rate each interval until utility falls. After
+   that, pairs of intervals at x(1 + eps) and x(1 - eps) estimate the
+   utility gradient, and the rate climbs it with a step that grows
+   while the direction holds and is bounded by a dynamic fraction of x
+   (at most half). */
+class VivaceController : public Controller
+{
+public:
+  /* Tunable parameters */
+  struct Params {
+    float exponent {0.9};        /* t: throughput reward exponent */
+    float latency_coeff {900};   /* b: penalty per unit RTT gradient */
+    float loss_coeff {11.35};    /* c: penalty per unit loss rate */
+    float grad_tolerance {0.01}; /* RTT gradients below this count as 0 */
+    float epsilon {0.05};        /* probing rates are x(1 +- epsilon) */
+    float step {1};              /* theta: Mbps of change per unit gradient */
+    float bound {0.05};          /* omega: initial cap on change, fraction of x */
+    float bound_step {0.1};      /* omega grows by this each time it binds */
+    float initial_rate {0.2};    /* pkts/ms */
+    float min_rate {0.01};       /* pkts/ms */
+    float inflight_cap {1};      /* window, in min RTTs at the sending rate */
+
+    /* Set a parameter by name; false if there is no such parameter */
+    bool set( const std::string & name, const float value );
+  };
+
+  enum class State { Startup, Probing };
+
+protected:
+  /* what a monitor interval was for */
+  enum class Purpose : uint8_t { Startup, ProbeUp, ProbeDown, Hold };
+
+  /* one monitor interval: datagrams sent at one rate, and their acks */
+  struct MonitorInterval {
+    Purpose purpose;
+    uint64_t experiment;       /* startup round or probe pair it belongs to */
+    float rate;                /* pkts/ms */
+    uint64_t first_sequence_number, last_sequence_number;
+    uint64_t start_time, end_time;
+    bool closed;               /* no more datagrams will be sent in it */
+    uint64_t sent, acked;
+    /* least-squares fit of RTT against send time */
+    double sum_x, sum_y, sum_xx, sum_xy;
+  };
+
+  Params params_ {};
+  State state_ {State::Startup};
+
+  float rate_ {0.2}; /* base sending rate, pkts/ms */
+  float srtt_ {0};
+  uint64_t min_rtt_ {0};
+
+  SampleRing<MonitorInterval> intervals_ {16}; /* oldest first, keyed by start time */
+  uint64_t largest_acked_ {0};
+
+  /* startup */
+  uint64_t startup_round_ {0};
+  double best_utility_ {0};
+  float best_rate_ {0};
+
+  /* probing and gradient ascent */
+  uint64_t probe_pair_ {0};
+  unsigned int probes_scheduled_ {0};
+  bool have_up_ {false}, have_down_ {false};
+  double utility_up_ {0}, utility_down_ {0};
+  int direction_ {0};
+  unsigned int confidence_ {1};  /* m: consecutive steps one way */
+  unsigned int bound_hits_ {0};
+
+  MonitorInterval * current( void );
+  void start_interval( const uint64_t sequence_number, const uint64_t now );
+  double utility( const MonitorInterval & mi ) const;
+  void interval_done( const MonitorInterval & mi );
+  void check_intervals( const uint64_t now );
+
+public:
+  VivaceController( const bool debug );
+
+  VivaceController( const bool debug,
+      const Params & params );
+
+  /* Timeout occured*/
+  void timed_out( void );
+
+  /* Wait between packets */
+  float get_interpkt_delay( void );
+
+  /* Get current window size, in datagrams */
+  unsigned int window_size( void );
+
+  /* A datagram was sent */
+  void datagram_was_sent( const uint64_t sequence_number,
+			  const uint64_t send_timestamp );
+
+  /* An ack was received */
+  void ack_received( const uint64_t sequence_number_acked,
+		     const uint64_t send_timestamp_acked,
+		     const uint64_t recv_timestamp_acked,
+		     const uint64_t timestamp_ack_received );
+
+  State state( void ) const { return state_; }
+};
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef WINDOWED_FILTER_HH
+#define WINDOWED_FILTER_HH
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+
+#include "ring_buffer.hh"
+
+/* Windowed extremum filters: the best (minimum or maximum) of the
+   samples seen in the last `window` ticks. A tick is whatever the caller
+   passes in: a timestamp for a time-based window, or a running sample
+   (or round-trip) count for a count-based one. Ticks must not decrease. */
+
+/* Exact filter over a monotonic deque. Each sample is pushed and popped
+   at most once, so an update costs amortized O(1) and best() is O(1),
+   independent of the window length and the sample rate. Candidates have
+   distinct ticks, so a window of W ticks never holds more than W + 1 of
+   them; storage for max_window + 1 is preallocated and the window is
+   clamped to max_window. */
+template <typename Value, typename Better>
+class WindowedFilter
+{
+private:
+  /* candidates, oldest first; each is strictly better than all later ones */
+  SampleRing<Value> candidates_;
+  uint64_t max_window_;
+  uint64_t window_;
+
+public:
+  WindowedFilter( const uint64_t window, const uint64_t max_window )
+    : candidates_( max_window + 1 ),
+      max_window_( max_window ),
+      window_( std::min( window, max_window ) )
+  {}
+
+  WindowedFilter( const uint64_t window ) : WindowedFilter( window, window ) {}
+
+  /* Add a sample and expire the ones that fell out of the window */
+  void update( const uint64_t tick, const Value & value )
+  {
+    const Better better {};
+
+    /* a newer sample that is at least as good retires older ones */
+    while ( not candidates_.empty()
+	    and not better( candidates_.back_value(), value ) ) {
+      candidates_.pop_back();
+    }
+
+    /* an equally old but worse sample can never become the best */
+    if ( candidates_.empty() or candidates_.back_time() != tick ) {
+      candidates_.push_back( tick, value );
+    }
+
+    expire( tick );
+  }
+
+  /* Drop samples older than `window` ticks before `tick` */
+  void expire( const uint64_t tick )
+  {
+    if ( tick < window_ ) {
+      return;
+    }
+    while ( not candidates_.empty()
+	    and candidates_.front_time() < tick - window_ ) {
+      candidates_.pop_front();
+    }
+  }
+
+  /* Best sample in the window (only valid when not empty) */
+  const Value & best( void ) const { return candidates_.front_value(); }
+
+  bool empty( void ) const { return candidates_.empty(); }
+
+  /* Change the window length (takes effect at the next update/expire) */
+  void set_window( const uint64_t window ) { window_ = std::min( window, max_window_ ); }
+  uint64_t window( void ) const { return window_; }
+};
+
+/* Approximate filter after Kathleen Nichols' algorithm (as used by BBR
+   and Linux's win_minmax): keeps only the best, second-best and
+   third-best samples from successive quarters of the window, so both
+   update and best() are O(1) with a fixed three-sample footprint. */
+template <typename Value, typename Better>
+class NicholsFilter
+{
+private:
+  struct Sample {
+    uint64_t tick;
+    Value value;
+  };
+
+  Sample samples_[ 3 ];
+  uint64_t window_;
+  bool empty_ {true};
+
+  void reset( const Sample & sample )
+  {
+    samples_[ 0 ] = samples_[ 1 ] = samples_[ 2 ] = sample;
+    empty_ = false;
+  }
+
+public:
+  NicholsFilter( const uint64_t window )
+    : samples_(), window_( window )
+  {}
+
+  /* Add a sample */
+  void update( const uint64_t tick, const Value & value )
+  {
+    const Better better {};
+    const Sample sample { tick, value };
+
+    if ( empty_
+	 or not better( samples_[ 0 ].value, value )
+	 or tick - samples_[ 2 ].tick > window_ ) {
+      reset( sample ); /* new best, or nothing left in the window */
+      return;
+    }
+
+    if ( not better( samples_[ 1 ].value, value ) ) {
+      samples_[ 2 ] = samples_[ 1 ] = sample;
+    } else if ( not better( samples_[ 2 ].value, value ) ) {
+      samples_[ 2 ] = sample;
+    }
+
+    /* age out the best sample, promoting the runners-up */
+    const uint64_t age = tick - samples_[ 0 ].tick;
+    if ( age > window_ ) {
+      samples_[ 0 ] = samples_[ 1 ];
+      samples_[ 1 ] = samples_[ 2 ];
+      samples_[ 2 ] = sample;
+      if ( tick - samples_[ 0 ].tick > window_ ) {
+	samples_[ 0 ] = samples_[ 1 ];
+	samples_[ 1 ] = samples_[ 2 ];
+	samples_[ 2 ] = sample;
+      }
+    } else if ( samples_[ 1 ].tick == samples_[ 0 ].tick and age > window_ / 4 ) {
+      /* refresh the runners-up a quarter of the way through the window */
+      samples_[ 2 ] = samples_[ 1 ] = sample;
+    } else if ( samples_[ 2 ].tick == samples_[ 1 ].tick and age > window_ / 2 ) {
+      samples_[ 2 ] = sample;
+    }
+  }
+
+  /* Best sample in the window (only valid when not empty) */
+  const Value & best( void ) const { return samples_[ 0 ].value; }
+
+  bool empty( void ) const { return empty_; }
+
+  void set_window( const uint64_t window ) { window_ = window; }
+  uint64_t window( void ) const { return window_; }
+};
+
+/* Common instantiations */
+template <typename Value>
+using WindowedMinFilter = WindowedFilter<Value, std::less<Value>>;
+
+template <typename Value>
+using WindowedMaxFilter = WindowedFilter<Value, std::greater<Value>>;
+
+template <typename Value>
+using NicholsMinFilter = NicholsFilter<Value, std::less<Value>>;
+
+template <typename Value>
+using NicholsMaxFilter = NicholsFilter<Value, std::greater<Value>>;
+
+#endif /* WINDOWED_FILTER_HH */
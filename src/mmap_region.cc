@@ -0,0 +1,47 @@
+#include "mmap_region.hh"
+#include "util.hh"
+
+using namespace std;
+
+/* map length bytes of fd (or anonymous memory if fd is -1) */
+MMapRegion::MMapRegion( const size_t length, const int prot, const int flags,
+			const int fd, const off_t offset )
+  : addr_( nullptr ),
+    length_( length )
+{
+  void * const ret = mmap( nullptr, length, prot, flags, fd, offset );
+  if ( ret == MAP_FAILED ) {
+    throw unix_error( "mmap" );
+  }
+
+  addr_ = static_cast<uint8_t *>( ret );
+}
+
+/* move constructor */
+MMapRegion::MMapRegion( MMapRegion && other )
+  : addr_( other.addr_ ),
+    length_( other.length_ )
+{
+  /* mark other region as inactive */
+  other.addr_ = nullptr;
+}
+
+/* destructor */
+MMapRegion::~MMapRegion()
+{
+  if ( not addr_ ) { /* has already been moved away */
+    return;
+  }
+
+  try {
+    SystemCall( "munmap", munmap( addr_, length_ ) );
+  } catch ( const exception & e ) { /* don't throw from destructor */
+    print_exception( e );
+  }
+}
+
+/* flush changes to a file-backed mapping */
+void MMapRegion::sync( void ) const
+{
+  SystemCall( "msync", msync( addr_, length_, MS_SYNC ) );
+}
@@ -0,0 +1,39 @@
+#ifndef MMAP_REGION_HH
+#define MMAP_REGION_HH
+
+#include <cstddef>
+#include <cstdint>
+
+#include <sys/mman.h>
+
+/* a memory-mapped region that is unmapped when the object is destroyed */
+class MMapRegion
+{
+private:
+  uint8_t * addr_;
+  size_t length_;
+
+public:
+  /* map length bytes of fd (or anonymous memory if fd is -1) */
+  MMapRegion( const size_t length, const int prot, const int flags,
+	      const int fd = -1, const off_t offset = 0 );
+
+  /* move constructor */
+  MMapRegion( MMapRegion && other );
+
+  /* destructor */
+  ~MMapRegion();
+
+  /* accessors */
+  uint8_t * addr( void ) const { return addr_; }
+  size_t length( void ) const { return length_; }
+
+  /* flush changes to a file-backed mapping */
+  void sync( void ) const;
+
+  /* forbid copying MMapRegion objects or assigning them */
+  MMapRegion( const MMapRegion & other ) = delete;
+  const MMapRegion & operator=( const MMapRegion & other ) = delete;
+};
+
+#endif /* MMAP_REGION_HH */
@@ -20,6 +20,12 @@ unsigned int Poller::Action::service_count( void ) const
 }
 
 Poller::Result Poller::poll( const int & timeout_ms )
+{
+  return poll( timeout_ms < 0 ? chrono::microseconds( -1 )
+	       : chrono::microseconds( chrono::milliseconds( timeout_ms ) ) );
+}
+
+Poller::Result Poller::poll( const chrono::microseconds & timeout )
 {
   assert( pollfds_.size() == actions_.size() );
 
@@ -42,7 +48,12 @@ Poller::Result Poller::poll( const int & timeout_ms )
     return Result::Type::Exit;
   }
 
-  if ( 0 == SystemCall( "poll", ::poll( &pollfds_[ 0 ], pollfds_.size(), timeout_ms ) ) ) {
+  /* ppoll() rather than poll() so timeouts need not round up to a ms */
+  const timespec timeout_ts { static_cast<time_t>( timeout.count() / 1000000 ),
+			      static_cast<long>( timeout.count() % 1000000 ) * 1000 };
+  if ( 0 == SystemCall( "ppoll", ::ppoll( &pollfds_[ 0 ], pollfds_.size(),
+					  timeout.count() < 0 ? nullptr : &timeout_ts,
+					  nullptr ) ) ) {
     return Result::Type::Timeout;
   }
 
@@ -1,6 +1,7 @@
 #ifndef POLLER_HH
 #define POLLER_HH
 
+#include <chrono>
 #include <functional>
 #include <vector>
 
@@ -55,6 +56,9 @@ public:
   Poller() : actions_(), pollfds_() {}
   void add_action( Action action );
   Result poll( const int & timeout_ms );
+
+  /* same, to the microsecond (negative waits forever) */
+  Result poll( const std::chrono::microseconds & timeout );
 };
 
 namespace PollerShortNames {
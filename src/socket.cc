@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include <sys/socket.h>
 
 #include "socket.hh"
@@ -75,10 +77,39 @@ void Socket::connect( const Address & address )
 				    address.size() ) );
 }
 
+static const ssize_t RECEIVE_MTU = 65536;
+
+/* find the kernel's receive timestamp (if there is one) */
+static uint64_t receive_timestamp( msghdr & header )
+{
+  uint64_t timestamp = -1;
+
+  cmsghdr *ts_hdr = CMSG_FIRSTHDR( &header );
+  while ( ts_hdr ) {
+    if ( ts_hdr->cmsg_level == SOL_SOCKET
+	 and ts_hdr->cmsg_type == SO_TIMESTAMPNS ) {
+      const timespec * const kernel_time = reinterpret_cast<timespec *>( CMSG_DATA( ts_hdr ) );
+      timestamp = timestamp_ms( *kernel_time );
+    }
+    ts_hdr = CMSG_NXTHDR( &header, ts_hdr );
+  }
+
+  return timestamp;
+}
+
+/* make sure we got the whole datagram */
+static void check_flags( const msghdr & header )
+{
+  if ( header.msg_flags & MSG_TRUNC ) {
+    throw runtime_error( "recvfrom (oversized datagram)" );
+  } else if ( header.msg_flags ) {
+    throw runtime_error( "recvfrom (unhandled flag)" );
+  }
+}
+
 /* receive datagram and where it came from */
 UDPSocket::received_datagram UDPSocket::recv( void )
 {
-  static const ssize_t RECEIVE_MTU = 65536;
 
   /* receive source address, timestamp and payload */
   Address::raw datagram_source_address;
@@ -108,34 +139,86 @@ UDPSocket::received_datagram UDPSocket::recv( void )
 
   register_read();
 
-  /* make sure we got the whole datagram */
-  if ( header.msg_flags & MSG_TRUNC ) {
-    throw runtime_error( "recvfrom (oversized datagram)" );
-  } else if ( header.msg_flags ) {
-    throw runtime_error( "recvfrom (unhandled flag)" );
-  }
-
-  uint64_t timestamp = -1;
-
-  /* find the timestamp header (if there is one) */
-  cmsghdr *ts_hdr = CMSG_FIRSTHDR( &header );
-  while ( ts_hdr ) {
-    if ( ts_hdr->cmsg_level == SOL_SOCKET
-	 and ts_hdr->cmsg_type == SO_TIMESTAMPNS ) {
-      const timespec * const kernel_time = reinterpret_cast<timespec *>( CMSG_DATA( ts_hdr ) );
-      timestamp = timestamp_ms( *kernel_time );
-    }
-    ts_hdr = CMSG_NXTHDR( &header, ts_hdr );
-  }
+  check_flags( header );
 
   received_datagram ret = { Address( datagram_source_address,
 				     header.msg_namelen ),
-			    timestamp,
+			    receive_timestamp( header ),
 			    string( msg_payload, recv_len ) };
 
   return ret;
 }
 
+/* a reusable batch for recv_batch() */
+vector<UDPSocket::received_datagram> UDPSocket::make_batch( const size_t payload_size )
+{
+  vector<received_datagram> ret;
+  for ( size_t i = 0; i < MAX_BATCH; i++ ) {
+    ret.push_back( { Address(), uint64_t( -1 ), string() } );
+    ret.back().payload.reserve( payload_size );
+  }
+  return ret;
+}
+
+/* receive a burst of datagrams with one system call */
+size_t UDPSocket::recv_batch( vector<received_datagram> & datagrams,
+			      const size_t max_datagrams )
+{
+  static const size_t CONTROL_SIZE = 256; /* room for the timestamp */
+
+  const size_t count = min( max_datagrams, MAX_BATCH );
+  if ( count == 0 ) {
+    return 0;
+  }
+
+  if ( not batch_buffer_ ) {
+    batch_buffer_.reset( new char[ MAX_BATCH * (RECEIVE_MTU + CONTROL_SIZE) ] );
+  }
+
+  Address::raw source_addresses[ MAX_BATCH ];
+  iovec msg_iovecs[ MAX_BATCH ];
+  mmsghdr headers[ MAX_BATCH ];
+  zero( headers );
+
+  for ( size_t i = 0; i < count; i++ ) {
+    char * const msg_payload = batch_buffer_.get() + i * RECEIVE_MTU;
+    char * const msg_control = batch_buffer_.get() + MAX_BATCH * RECEIVE_MTU + i * CONTROL_SIZE;
+
+    msg_iovecs[ i ].iov_base = msg_payload;
+    msg_iovecs[ i ].iov_len = RECEIVE_MTU;
+
+    msghdr & header = headers[ i ].msg_hdr;
+    header.msg_name = &source_addresses[ i ];
+    header.msg_namelen = sizeof( source_addresses[ i ] );
+    header.msg_iov = &msg_iovecs[ i ];
+    header.msg_iovlen = 1;
+    header.msg_control = msg_control;
+    header.msg_controllen = CONTROL_SIZE;
+  }
+
+  /* block for the first datagram, then take whatever else is queued */
+  const size_t received = SystemCall( "recvmmsg",
+				      recvmmsg( fd_num(), headers, count, MSG_WAITFORONE, nullptr ) );
+
+  register_read();
+
+  while ( datagrams.size() < received ) {
+    datagrams.push_back( { Address(), uint64_t( -1 ), string() } );
+  }
+
+  for ( size_t i = 0; i < received; i++ ) {
+    msghdr & header = headers[ i ].msg_hdr;
+    check_flags( header );
+
+    datagrams[ i ].source_address = Address( source_addresses[ i ], header.msg_namelen );
+    datagrams[ i ].timestamp = receive_timestamp( header );
+    datagrams[ i ].payload.assign( static_cast<const char *>( msg_iovecs[ i ].iov_base ),
+				   headers[ i ].msg_len );
+  }
+
+  return received;
+}
+
 /* send datagram to specified address */
 void UDPSocket::sendto( const Address & destination, const string & payload )
 {
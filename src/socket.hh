@@ -2,6 +2,8 @@
 #define SOCKET_HH
 
 #include <functional>
+#include <memory>
+#include <vector>
 
 #include "address.hh"
 #include "file_descriptor.hh"
@@ -43,6 +45,10 @@ public:
 /* UDP socket */
 class UDPSocket : public Socket
 {
+private:
+  /* payload and control buffers for recv_batch(), allocated on first use */
+  std::unique_ptr<char[]> batch_buffer_ {};
+
 public:
   UDPSocket() : Socket( AF_INET6, SOCK_DGRAM ) {}
 
@@ -52,9 +58,22 @@ public:
     std::string payload;
   };
 
+  /* most datagrams recv_batch() will return at once */
+  static const size_t MAX_BATCH = 16;
+
   /* receive datagram, timestamp, and where it came from */
   received_datagram recv( void );
 
+  /* room for a full batch of datagrams of up to payload_size bytes,
+     so a recv_batch() into it does not allocate, however big the burst */
+  static std::vector<received_datagram> make_batch( const size_t payload_size );
+
+  /* receive up to max_datagrams with one system call (recvmmsg),
+     waiting only for the first; fills the front of `datagrams`,
+     reusing its entries, and returns how many arrived */
+  size_t recv_batch( std::vector<received_datagram> & datagrams,
+		     const size_t max_datagrams = MAX_BATCH );
+
   /* send datagram to specified address */
   void sendto( const Address & peer, const std::string & payload );
 